@@ -13,6 +13,7 @@
 #include "common/HostSys.h"
 
 #include <csignal>
+#include <dlfcn.h>
 #include <cstring>
 #include <cstdlib>
 #include <optional>
@@ -201,6 +202,15 @@ size_t HostSys::GetRuntimeCacheLineSize()
 	return static_cast<size_t>(std::max<s64>(sysctlbyname_T<s64>("hw.cachelinesize").value_or(0), 0));
 }
 
+const void* HostSys::GetModuleBaseAddress(const void* address)
+{
+	Dl_info info;
+	if (dladdr(address, &info) == 0)
+		return nullptr;
+
+	return info.dli_fbase;
+}
+
 static __ri vm_prot_t MachProt(const PageProtectionMode& mode)
 {
 	vm_prot_t machmode = (mode.CanWrite()) ? VM_PROT_WRITE : 0;
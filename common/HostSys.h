@@ -129,6 +129,10 @@ namespace HostSys
 
 	/// Returns the size of a cache line for the current host.
 	size_t GetRuntimeCacheLineSize();
+
+	/// Returns the load address of the module (executable or shared library) which contains the specified
+	/// address, or nullptr if the address does not belong to any loaded image (e.g. heap or anonymous mappings).
+	const void* GetModuleBaseAddress(const void* address);
 } // namespace HostSys
 
 namespace PageFaultHandler
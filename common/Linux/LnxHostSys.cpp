@@ -11,6 +11,7 @@
 #include <cstdio>
 #include <csignal>
 #include <cerrno>
+#include <dlfcn.h>
 #include <fcntl.h>
 #include <mutex>
 #include <sys/mman.h>
@@ -144,6 +145,15 @@ size_t HostSys::GetRuntimePageSize()
 	return (res > 0) ? static_cast<size_t>(res) : 0;
 }
 
+const void* HostSys::GetModuleBaseAddress(const void* address)
+{
+	Dl_info info;
+	if (dladdr(address, &info) == 0)
+		return nullptr;
+
+	return info.dli_fbase;
+}
+
 size_t HostSys::GetRuntimeCacheLineSize()
 {
 #if defined(__FreeBSD__)
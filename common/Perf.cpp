@@ -190,8 +190,18 @@ namespace Perf
 
 	void Group::RegisterPC(const void* ptr, size_t size, u32 pc)
 	{
-		char full_symbol[128];
-		if (HasPrefix())
+		char full_symbol[256];
+		std::string function;
+		u32 offset;
+		if (m_pc_resolver && m_pc_resolver(pc, &function, &offset))
+		{
+			// Keep the PC, functions are often split across many blocks.
+			if (HasPrefix())
+				std::snprintf(full_symbol, std::size(full_symbol), "%s_%s+0x%X_%08X", m_prefix, function.c_str(), offset, pc);
+			else
+				std::snprintf(full_symbol, std::size(full_symbol), "%s+0x%X_%08X", function.c_str(), offset, pc);
+		}
+		else if (HasPrefix())
 			std::snprintf(full_symbol, std::size(full_symbol), "%s_%08X", m_prefix, pc);
 		else
 			std::snprintf(full_symbol, std::size(full_symbol), "%08X", pc);
@@ -5,17 +5,25 @@
 
 #include <vector>
 #include <cstdio>
+#include <string>
 #include "common/Pcsx2Types.h"
 
 namespace Perf
 {
 	class Group
 	{
+	public:
+		/// Looks up the guest function containing pc, so JIT code can be named after it. Must not block.
+		using PCResolver = bool (*)(u32 pc, std::string* function, u32* offset);
+
+	private:
 		const char* m_prefix;
+		PCResolver m_pc_resolver = nullptr;
 
 	public:
 		constexpr Group(const char* prefix) : m_prefix(prefix) {}
 		bool HasPrefix() const { return (m_prefix && m_prefix[0]); }
+		void SetPCResolver(PCResolver resolver) { m_pc_resolver = resolver; }
 
 		void Register(const void* ptr, size_t size, const char* symbol);
 		void RegisterPC(const void* ptr, size_t size, u32 pc);
@@ -61,6 +61,11 @@ void Threading::WorkSema::WaitForWork()
 }
 
 void Threading::WorkSema::WaitForWorkWithSpin()
+{
+	WaitForWorkWithSpin(SPIN_TIME_NS);
+}
+
+void Threading::WorkSema::WaitForWorkWithSpin(u32 spin_ns)
 {
 	s32 value = m_state.load(std::memory_order_relaxed);
 	pxAssert(!IsDead(value));
@@ -77,7 +82,7 @@ void Threading::WorkSema::WaitForWorkWithSpin()
 	u32 waited = 0;
 	while (value < 0)
 	{
-		if (waited > SPIN_TIME_NS)
+		if (waited > spin_ns)
 		{
 			if (!m_state.compare_exchange_weak(value, STATE_SLEEPING, std::memory_order_relaxed))
 				continue;
@@ -108,6 +113,11 @@ bool Threading::WorkSema::WaitForEmpty()
 }
 
 bool Threading::WorkSema::WaitForEmptyWithSpin()
+{
+	return WaitForEmptyWithSpin(SPIN_TIME_NS);
+}
+
+bool Threading::WorkSema::WaitForEmptyWithSpin(u32 spin_ns)
 {
 	s32 value = m_state.load(std::memory_order_acquire);
 	u32 waited = 0;
@@ -115,7 +125,7 @@ bool Threading::WorkSema::WaitForEmptyWithSpin()
 	{
 		if (value < 0)
 			return !IsDead(value); // STATE_SLEEPING or STATE_SPINNING, queue is empty!
-		if (waited > SPIN_TIME_NS && m_state.compare_exchange_weak(value, value | STATE_FLAG_WAITING_EMPTY, std::memory_order_acquire))
+		if (waited > spin_ns && m_state.compare_exchange_weak(value, value | STATE_FLAG_WAITING_EMPTY, std::memory_order_acquire))
 			break;
 		waited += ShortSpin();
 		value = m_state.load(std::memory_order_acquire);
@@ -207,12 +207,16 @@ namespace Threading
 		void WaitForWork();
 		/// Wait for work to be added to the queue, spinning for a bit before sleeping the thread
 		void WaitForWorkWithSpin();
+		/// Same as above, but spinning for approximately spin_ns instead of the default time
+		void WaitForWorkWithSpin(u32 spin_ns);
 		/// Wait for the worker thread to finish processing all entries in the queue or die
 		/// Returns false if the thread is dead
 		bool WaitForEmpty();
 		/// Wait for the worker thread to finish processing all entries in the queue or die, spinning a bit before sleeping the thread
 		/// Returns false if the thread is dead
 		bool WaitForEmptyWithSpin();
+		/// Same as above, but spinning for approximately spin_ns instead of the default time
+		bool WaitForEmptyWithSpin(u32 spin_ns);
 		/// Called by the worker thread to notify others of its death
 		/// Dead threads don't process work, and WaitForEmpty will return instantly even though there may be work in the queue
 		void Kill();
@@ -129,6 +129,19 @@ size_t HostSys::GetRuntimeCacheLineSize()
 	return max_line_size;
 }
 
+const void* HostSys::GetModuleBaseAddress(const void* address)
+{
+	HMODULE module;
+	if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+			static_cast<LPCWSTR>(address), &module))
+	{
+		return nullptr;
+	}
+
+	// HMODULE is the image load address.
+	return module;
+}
+
 #ifdef _M_ARM64
 
 void HostSys::FlushInstructionCache(void* address, u32 size)
@@ -52,6 +52,9 @@ namespace x86Emitter
 	const xImplAVX_ThreeArgYMM xVPANDN = {0x66, 0xDF};
 	const xImplAVX_ThreeArgYMM xVPOR = {0x66, 0xEB};
 	const xImplAVX_ThreeArgYMM xVPXOR = {0x66, 0xEF};
+	const xImplAVX_ThreeArgYMM xVPADDD = {0x66, 0xFE};
+	const xImplAVX_PMove xVPMOVSX = {0x20};
+	const xImplAVX_PMove xVPMOVZX = {0x30};
 	const xImplAVX_CmpInt xVPCMP = {
 		{0x66, 0x74}, // VPCMPEQB
 		{0x66, 0x75}, // VPCMPEQW
@@ -84,6 +87,43 @@ namespace x86Emitter
 		xWrite8(0x77);
 	}
 
+	void xVPBLENDD(const xRegisterSSE& to, const xRegisterSSE& from1, const xRegisterSSE& from2, u8 imm)
+	{
+		xOpWriteC4(0x66, 0x3A, 0x02, to, from1, from2, 0);
+		xWrite8(imm);
+	}
+
+	void xVPERM2I128(const xRegisterSSE& to, const xRegisterSSE& from1, const xRegisterSSE& from2, u8 imm)
+	{
+		pxAssert(to.IsWideSIMD() && from1.IsWideSIMD() && from2.IsWideSIMD());
+		xOpWriteC4(0x66, 0x3A, 0x46, to, from1, from2, 0);
+		xWrite8(imm);
+	}
+
+	void xVINSERTI128(const xRegisterSSE& to, const xRegisterSSE& from1, const xRegisterSSE& from2, u8 imm)
+	{
+		pxAssert(to.IsWideSIMD() && from1.IsWideSIMD() && !from2.IsWideSIMD());
+		xOpWriteC4(0x66, 0x3A, 0x38, to, from1, from2, 0);
+		xWrite8(imm);
+	}
+
+	void xVEXTRACTI128(const xRegisterSSE& to, const xRegisterSSE& from, u8 imm)
+	{
+		pxAssert(!to.IsWideSIMD() && from.IsWideSIMD());
+		xOpWriteC4(0x66, 0x3A, 0x39, from, xRegisterSSE(), to, 0);
+		xWrite8(imm);
+	}
+
+	void xImplAVX_PMove::BD(const xRegisterSSE& to, const xIndirectVoid& from) const
+	{
+		xOpWriteC4(0x66, 0x38, OpcodeBase + 0x01, to, xRegisterSSE(), from, 0);
+	}
+
+	void xImplAVX_PMove::WD(const xRegisterSSE& to, const xIndirectVoid& from) const
+	{
+		xOpWriteC4(0x66, 0x38, OpcodeBase + 0x03, to, xRegisterSSE(), from, 0);
+	}
+
 	void xImplAVX_Move::operator()(const xRegisterSSE& to, const xRegisterSSE& from) const
 	{
 		if (to != from)
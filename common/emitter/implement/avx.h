@@ -31,6 +31,19 @@ namespace x86Emitter
 		void operator()(const xRegisterSSE& to, const xRegisterSSE& from1, const xIndirectVoid& from2) const;
 	};
 
+	struct xImplAVX_PMove
+	{
+		u8 OpcodeBase;
+
+		// [AVX2] Sign/Zero extend packed bytes to doublewords. Reads 4 bytes for an xmm
+		// destination, 8 bytes for a ymm destination.
+		void BD(const xRegisterSSE& to, const xIndirectVoid& from) const;
+
+		// [AVX2] Sign/Zero extend packed words to doublewords. Reads 8 bytes for an xmm
+		// destination, 16 bytes for a ymm destination.
+		void WD(const xRegisterSSE& to, const xIndirectVoid& from) const;
+	};
+
 	struct xImplAVX_ArithFloat
 	{
 		xImplAVX_ThreeArgYMM PS;
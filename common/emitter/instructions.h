@@ -625,10 +625,22 @@ namespace x86Emitter
 	extern const xImplAVX_ThreeArgYMM xVPOR;
 	extern const xImplAVX_ThreeArgYMM xVPXOR;
 	extern const xImplAVX_CmpInt xVPCMP;
+	extern const xImplAVX_ThreeArgYMM xVPADDD;
+	extern const xImplAVX_PMove xVPMOVSX;
+	extern const xImplAVX_PMove xVPMOVZX;
 
 	extern void xVPMOVMSKB(const xRegister32& to, const xRegisterSSE& from);
 	extern void xVMOVMSKPS(const xRegister32& to, const xRegisterSSE& from);
 	extern void xVMOVMSKPD(const xRegister32& to, const xRegisterSSE& from);
 	extern void xVZEROUPPER();
 
+	// [AVX2] Blends doublewords from from2 into from1 where the corresponding imm bit is set.
+	extern void xVPBLENDD(const xRegisterSSE& to, const xRegisterSSE& from1, const xRegisterSSE& from2, u8 imm);
+	// [AVX2] Selects each 128-bit lane of to from the lanes of from1/from2, or zero.
+	extern void xVPERM2I128(const xRegisterSSE& to, const xRegisterSSE& from1, const xRegisterSSE& from2, u8 imm);
+	// [AVX2] Copies from1 to to, replacing the 128-bit lane selected by imm with from2.
+	extern void xVINSERTI128(const xRegisterSSE& to, const xRegisterSSE& from1, const xRegisterSSE& from2, u8 imm);
+	// [AVX2] Extracts the 128-bit lane selected by imm from a ymm register.
+	extern void xVEXTRACTI128(const xRegisterSSE& to, const xRegisterSSE& from, u8 imm);
+
 } // namespace x86Emitter
@@ -143,7 +143,7 @@ namespace x86Emitter
 		pxAssert(prefix == 0 || prefix == 0x66 || prefix == 0xF3 || prefix == 0xF2);
 		pxAssert(mb_prefix == 0x0F || mb_prefix == 0x38 || mb_prefix == 0x3A);
 
-		const xRegisterInt& reg = param1.IsReg() ? param1 : param2;
+		const xRegisterBase& reg = param1.IsReg() ? param1 : param2;
 
 		u8 nR = reg.IsExtended() ? 0x00 : 0x80;
 		u8 nB = param3.IsExtended() ? 0x00 : 0x20;
@@ -152,7 +152,7 @@ namespace x86Emitter
 		u8 W = (w == -1) ? (reg.GetOperandSize() == 8 ? 0x80 : 0) : // autodetect the size
                            0x80 * w; // take directly the W value
 
-		u8 nv = (~param2.GetId() & 0xF) << 3;
+		u8 nv = (param2.IsEmpty() ? 0xF : ((~param2.GetId() & 0xF))) << 3;
 
 		u8 p =
 			prefix == 0xF2 ? 3 :
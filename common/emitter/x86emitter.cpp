@@ -50,6 +50,7 @@
 
 thread_local u8* x86Ptr;
 thread_local XMMSSEType g_xmmtypes[iREGCNT_XMM] = {XMMT_INT};
+thread_local std::vector<u8*>* x86AddressTags = nullptr;
 
 namespace x86Emitter
 {
@@ -1304,6 +1305,8 @@ const xRegister32
 		else
 		{
 			xMOV64(dst, iaddr);
+			if (x86AddressTags && iaddr != (u32)iaddr && iaddr != (s32)iaddr)
+				x86AddressTags->push_back(xGetPtr() - sizeof(u64));
 		}
 	}
 
@@ -7,6 +7,8 @@
 #include "common/Assertions.h"
 #include "common/Pcsx2Defs.h"
 
+#include <vector>
+
 static const uint iREGCNT_XMM = 16;
 static const uint iREGCNT_GPR = 16;
 
@@ -20,6 +22,10 @@ enum XMMSSEType
 extern thread_local u8* x86Ptr;
 extern thread_local XMMSSEType g_xmmtypes[iREGCNT_XMM];
 
+// When set, receives the location of each 64-bit immediate written as a host address (see xLoadFarAddr()),
+// for code which gets relocated later and can't tell addresses from constants by their value.
+extern thread_local std::vector<u8*>* x86AddressTags;
+
 namespace x86Emitter
 {
 	// Win32 requires 32 bytes of shadow stack in the caller's frame.
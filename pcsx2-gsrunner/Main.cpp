@@ -24,6 +24,7 @@
 #include "common/ProgressCallback.h"
 #include "common/SettingsWrapper.h"
 #include "common/StringUtil.h"
+#include "common/Timer.h"
 
 #include "pcsx2/PrecompiledHeader.h"
 
@@ -68,6 +69,7 @@ static std::string s_output_prefix;
 static s32 s_loop_count = 1;
 static std::optional<bool> s_use_window;
 static bool s_no_console = false;
+static double s_run_time_ms = 0.0;
 
 // Owned by the GS thread.
 static u32 s_dump_frame_number = 0;
@@ -277,6 +279,12 @@ void Host::BeginPresentFrame()
 
 		s_total_frames++;
 
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+	else
+	{
+		s_total_frames++;
+
 		std::atomic_thread_fence(std::memory_order_release);
 	}
 }
@@ -445,6 +453,8 @@ static void PrintCommandLineHelp(const char* progname)
 	std::fprintf(stderr, "  -dumpdir <dir>: Frame dump directory (will be dumped as filename_frameN.png).\n");
 	std::fprintf(stderr, "  -loop <count>: Loops dump playback N times. Defaults to 1. 0 will loop infinitely.\n");
 	std::fprintf(stderr, "  -renderer <renderer>: Sets the graphics renderer. Defaults to Auto.\n");
+	std::fprintf(stderr, "  -swthreads <count>: Sets the number of software renderer threads.\n");
+	std::fprintf(stderr, "  -swtiles: Bins software renderer draws into screen tiles instead of splitting them by scanlines.\n");
 	std::fprintf(stderr, "  -window: Forces a window to be displayed.\n");
 	std::fprintf(stderr, "  -surfaceless: Disables showing a window.\n");
 	std::fprintf(stderr, "  -logfile <filename>: Writes emu log to filename.\n");
@@ -543,6 +553,25 @@ bool GSRunner::ParseCommandLineArgs(int argc, char* argv[], VMBootParameters& pa
 				s_settings_interface.SetIntValue("EmuCore/GS", "Renderer", static_cast<int>(type));
 				continue;
 			}
+			else if (CHECK_ARG_PARAM("-swthreads"))
+			{
+				const std::optional<s32> threads = StringUtil::FromChars<s32>(argv[++i]);
+				if (!threads.has_value() || threads.value() < 0)
+				{
+					Console.Error("Invalid software renderer thread count");
+					return false;
+				}
+
+				Console.WriteLn("Using %d software renderer threads.", threads.value());
+				s_settings_interface.SetIntValue("EmuCore/GS", "extrathreads", threads.value());
+				continue;
+			}
+			else if (CHECK_ARG("-swtiles"))
+			{
+				Console.WriteLn("Using tile binned software rasterization.");
+				s_settings_interface.SetBoolValue("EmuCore/GS", "sw_tile_rasterization", true);
+				continue;
+			}
 			else if (CHECK_ARG_PARAM("-renderhacks"))
 			{
 				std::string str(argv[++i]);
@@ -661,6 +690,18 @@ bool GSRunner::ParseCommandLineArgs(int argc, char* argv[], VMBootParameters& pa
 void GSRunner::DumpStats()
 {
 	std::atomic_thread_fence(std::memory_order_acquire);
+
+	if (EmuConfig.GS.Renderer == GSRendererType::SW)
+	{
+		Console.WriteLn(fmt::format("======= SW STATISTICS FOR {} FRAMES ========", s_total_frames));
+		Console.WriteLn(fmt::format("@SWSTAT@ Threads: {} ({})", EmuConfig.GS.SWExtraThreads,
+			EmuConfig.GS.SWTileRasterization ? "tiles" : "scanlines"));
+		Console.WriteLn(fmt::format("@SWSTAT@ Time: {:.2f} ms (avg {:.3f} ms/frame)", s_run_time_ms,
+			s_run_time_ms / std::max<u32>(s_total_frames, 1)));
+		Console.WriteLn("============================================");
+		return;
+	}
+
 	Console.WriteLn(fmt::format("======= HW STATISTICS FOR {} ({}) FRAMES ========", s_total_frames, s_total_drawn_frames));
 	Console.WriteLn(fmt::format("@HWSTAT@ Draw Calls: {} (avg {})", s_total_draws, static_cast<u64>(std::ceil(s_total_draws / static_cast<double>(s_total_drawn_frames)))));
 	Console.WriteLn(fmt::format("@HWSTAT@ Render Passes: {} (avg {})", s_total_render_passes, static_cast<u64>(std::ceil(s_total_render_passes / static_cast<double>(s_total_drawn_frames)))));
@@ -709,8 +750,10 @@ int main(int argc, char* argv[])
 		// run until end
 		GSDumpReplayer::SetLoopCount(s_loop_count);
 		VMManager::SetState(VMState::Running);
+		Common::Timer run_timer;
 		while (VMManager::GetState() == VMState::Running)
 			VMManager::Execute();
+		s_run_time_ms = run_timer.GetTimeMilliseconds();
 		VMManager::Shutdown(false);
 		GSRunner::DumpStats();
 	}
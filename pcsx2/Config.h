@@ -187,6 +187,7 @@ enum class SpeedHack
 	InstantVU1,
 	MTVU,
 	EECycleRate,
+	WaitLoop,
 	MaxCount,
 };
 
@@ -568,11 +569,11 @@ struct Pcsx2Config
 	{
 		BITFIELD32()
 		bool
-			Enabled : 1, // universal toggle for the profiler.
-			RecBlocks_EE : 1, // Enables per-block profiling for the EE recompiler [unimplemented]
-			RecBlocks_IOP : 1, // Enables per-block profiling for the IOP recompiler [unimplemented]
-			RecBlocks_VU0 : 1, // Enables per-block profiling for the VU0 recompiler [unimplemented]
-			RecBlocks_VU1 : 1; // Enables per-block profiling for the VU1 recompiler [unimplemented]
+			Enabled : 1, // universal toggle for the profiler (see HotspotProfiler).
+			RecBlocks_EE : 1, // Enables sampling of EE blocks
+			RecBlocks_IOP : 1, // Enables sampling of IOP blocks
+			RecBlocks_VU0 : 1, // Enables sampling of VU0 microprograms
+			RecBlocks_VU1 : 1; // Enables sampling of VU1 microprograms
 		BITFIELD_END
 
 		// Default is Disabled, with all recs enabled underneath.
@@ -616,6 +617,26 @@ struct Pcsx2Config
 			EnableFastmem : 1;
 		bool
 			PauseOnTLBMiss : 1;
+		bool
+			EnableEECodeCache : 1;
+		bool
+			EnableEESuperblocks : 1;
+		bool
+			EnableEECrossBlockAnalysis : 1;
+		bool
+			EnableEEInterpreterTier : 1;
+		bool
+			EnableCodeEviction : 1;
+		bool
+			EnableEESubPageSMC : 1;
+		bool
+			EnableVUProgramCache : 1;
+		bool
+			EnableVUVexEncoding : 1;
+		bool
+			BenchmarkVUCodegen : 1;
+		bool
+			EnableVIFUnpackCache : 1;
 		BITFIELD_END
 
 		RecompilerOptions();
@@ -723,6 +744,7 @@ struct Pcsx2Config
 					HWSpinCPUForReadbacks : 1,
 					GPUPaletteConversion : 1,
 					AutoFlushSW : 1,
+					SWTileRasterization : 1,
 					PreloadFrameWithGSData : 1,
 					Mipmap : 1,
 					HWMipmap : 1,
@@ -0,0 +1,266 @@
+// SPDX-FileCopyrightText: 2002-2024 PCSX2 Dev Team
+// SPDX-License-Identifier: GPL-3.0+
+
+#include "DebugTools/HotspotProfiler.h"
+#include "DebugTools/SymbolGuardian.h"
+
+#include "Config.h"
+#include "MTVU.h"
+#include "R3000A.h"
+#include "R5900.h"
+#include "VMManager.h"
+#include "VUmicro.h"
+
+#include "common/Console.h"
+#include "common/FileSystem.h"
+#include "common/Path.h"
+#include "common/StringUtil.h"
+#include "common/Threading.h"
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+namespace HotspotProfiler
+{
+	enum Processor : u32
+	{
+		PROC_EE,
+		PROC_IOP,
+		PROC_VU0,
+		PROC_VU1,
+		NUM_PROCESSORS,
+	};
+
+	static constexpr const char* s_processor_names[NUM_PROCESSORS] = {"EE", "IOP", "VU0", "VU1"};
+
+	static constexpr int SAMPLE_INTERVAL_MS = 1;
+	static constexpr u32 REPORT_TOP_FUNCTIONS = 25;
+
+	// Samples are keyed by the block PC in the low word, and the return address register in the high word so
+	// leaf functions can be attributed to their caller. VU samples have no caller.
+	struct ProcessorSamples
+	{
+		std::unordered_map<u64, u32> pcs;
+		u64 active = 0;
+	};
+
+	static Threading::Thread s_thread;
+	static std::atomic_bool s_stop{false};
+	static bool s_enabled[NUM_PROCESSORS] = {};
+
+	// Only touched by the sampling thread while it's running.
+	static ProcessorSamples s_samples[NUM_PROCESSORS];
+	static u64 s_ticks = 0;
+
+	static void SampleThread();
+	static void WriteReports();
+	static std::string GetFunctionName(Processor proc, u32 pc, u32* function_start);
+} // namespace HotspotProfiler
+
+void HotspotProfiler::Start()
+{
+	if (s_thread.Joinable())
+		return;
+
+	s_enabled[PROC_EE] = EmuConfig.Profiler.RecBlocks_EE;
+	s_enabled[PROC_IOP] = EmuConfig.Profiler.RecBlocks_IOP;
+	s_enabled[PROC_VU0] = EmuConfig.Profiler.RecBlocks_VU0;
+	s_enabled[PROC_VU1] = EmuConfig.Profiler.RecBlocks_VU1;
+
+	for (ProcessorSamples& samples : s_samples)
+		samples = {};
+	s_ticks = 0;
+
+	Console.WriteLn("Hotspot profiler: sampling every %d ms.", SAMPLE_INTERVAL_MS);
+	s_stop.store(false, std::memory_order_release);
+	s_thread.Start(&SampleThread);
+}
+
+void HotspotProfiler::Stop()
+{
+	if (!s_thread.Joinable())
+		return;
+
+	s_stop.store(true, std::memory_order_release);
+	s_thread.Join();
+
+	if (s_ticks > 0)
+		WriteReports();
+
+	for (ProcessorSamples& samples : s_samples)
+		samples = {};
+}
+
+bool HotspotProfiler::IsActive()
+{
+	return s_thread.Joinable();
+}
+
+void HotspotProfiler::SampleThread()
+{
+	Threading::SetNameOfCurrentThread("Hotspot Profiler");
+
+	while (!s_stop.load(std::memory_order_acquire))
+	{
+		Threading::Sleep(SAMPLE_INTERVAL_MS);
+
+		if (VMManager::GetState() != VMState::Running)
+			continue;
+
+		// The PCs are read without synchronization, they're only updated at block boundaries, which is what
+		// we want to sample anyway.
+		s_ticks++;
+
+		if (s_enabled[PROC_EE])
+		{
+			s_samples[PROC_EE].pcs[static_cast<u64>(cpuRegs.GPR.n.ra.UL[0]) << 32 | cpuRegs.pc]++;
+			s_samples[PROC_EE].active++;
+		}
+
+		if (s_enabled[PROC_IOP])
+		{
+			s_samples[PROC_IOP].pcs[static_cast<u64>(psxRegs.GPR.n.ra) << 32 | psxRegs.pc]++;
+			s_samples[PROC_IOP].active++;
+		}
+
+		const u32 vpu_stat = VU0.VI[REG_VPU_STAT].UL;
+		if (s_enabled[PROC_VU0] && (vpu_stat & 0x1))
+		{
+			s_samples[PROC_VU0].pcs[VU0.VI[REG_TPC].UL]++;
+			s_samples[PROC_VU0].active++;
+		}
+
+		if (s_enabled[PROC_VU1] && (THREAD_VU1 ? !vu1Thread.IsDone() : (vpu_stat & 0x100) != 0))
+		{
+			s_samples[PROC_VU1].pcs[VU1.VI[REG_TPC].UL]++;
+			s_samples[PROC_VU1].active++;
+		}
+	}
+}
+
+std::string HotspotProfiler::GetFunctionName(Processor proc, u32 pc, u32* function_start)
+{
+	if (proc == PROC_EE || proc == PROC_IOP)
+	{
+		const SymbolGuardian& guardian = (proc == PROC_EE) ? R5900SymbolGuardian : R3000SymbolGuardian;
+		const FunctionInfo info = guardian.FunctionOverlappingAddress(pc);
+		if (!info.name.empty())
+		{
+			*function_start = info.address.value;
+			return info.name;
+		}
+
+		*function_start = pc;
+		return StringUtil::StdStringFromFormat("0x%08X", pc);
+	}
+
+	// VU microprograms don't have symbols, they're identified by their start address.
+	*function_start = pc;
+	return StringUtil::StdStringFromFormat("%s_prog_%04X", s_processor_names[proc], pc);
+}
+
+void HotspotProfiler::WriteReports()
+{
+	struct Function
+	{
+		std::string name;
+		u32 samples = 0;
+	};
+
+	std::string serial = VMManager::GetDiscSerial();
+	if (serial.empty())
+		serial = "unknown";
+
+	const std::string folded_path = Path::Combine(EmuFolders::Logs, fmt::format("hotspots_{}.folded", serial));
+	const std::string report_path = Path::Combine(EmuFolders::Logs, fmt::format("hotspots_{}.txt", serial));
+	auto folded_fp = FileSystem::OpenManagedCFile(folded_path.c_str(), "wb");
+	auto report_fp = FileSystem::OpenManagedCFile(report_path.c_str(), "wb");
+	if (!folded_fp || !report_fp)
+	{
+		Console.Error("Hotspot profiler: Failed to open '%s' for writing.", report_path.c_str());
+		return;
+	}
+
+	std::fprintf(report_fp.get(), "%llu samples at %d ms intervals\n\n", static_cast<unsigned long long>(s_ticks),
+		SAMPLE_INTERVAL_MS);
+	for (u32 proc = 0; proc < NUM_PROCESSORS; proc++)
+	{
+		if (s_enabled[proc])
+		{
+			std::fprintf(report_fp.get(), "%-4s active in %5.1f%% of samples\n", s_processor_names[proc],
+				static_cast<double>(s_samples[proc].active) * 100.0 / static_cast<double>(s_ticks));
+		}
+	}
+
+	for (u32 proc = 0; proc < NUM_PROCESSORS; proc++)
+	{
+		const ProcessorSamples& samples = s_samples[proc];
+		if (samples.active == 0)
+			continue;
+
+		std::unordered_map<u32, std::pair<std::string, u32>> names; // pc -> (function name, function start)
+		const auto lookup = [&names, proc](u32 pc) -> const std::pair<std::string, u32>& {
+			auto it = names.find(pc);
+			if (it == names.end())
+			{
+				u32 start;
+				std::string name = GetFunctionName(static_cast<Processor>(proc), pc, &start);
+				it = names.emplace(pc, std::make_pair(std::move(name), start)).first;
+			}
+			return it->second;
+		};
+
+		std::unordered_map<u32, Function> functions; // function start -> samples
+		std::unordered_map<std::string, u32> stacks;
+		for (const auto& [key, count] : samples.pcs)
+		{
+			const u32 pc = static_cast<u32>(key);
+			const u32 ra = static_cast<u32>(key >> 32);
+			const auto& [name, start] = lookup(pc);
+
+			Function& function = functions[start];
+			if (function.name.empty())
+				function.name = name;
+			function.samples += count;
+
+			// The return address only identifies the caller of leaf functions; in any other function it may point
+			// back into the function itself, after a call it made.
+			std::string stack = s_processor_names[proc];
+			if (ra != 0 && (proc == PROC_EE || proc == PROC_IOP))
+			{
+				const auto& [caller_name, caller_start] = lookup(ra);
+				if (caller_start != start)
+				{
+					stack += ';';
+					stack += caller_name;
+				}
+			}
+			stack += ';';
+			stack += name;
+			stacks[stack] += count;
+		}
+
+		for (const auto& [stack, count] : stacks)
+			std::fprintf(folded_fp.get(), "%s %u\n", stack.c_str(), count);
+
+		std::vector<Function> sorted;
+		sorted.reserve(functions.size());
+		for (auto& [start, function] : functions)
+			sorted.push_back(std::move(function));
+		std::sort(sorted.begin(), sorted.end(), [](const Function& a, const Function& b) { return a.samples > b.samples; });
+
+		std::fprintf(report_fp.get(), "\n%s: %llu samples in %zu functions\n", s_processor_names[proc],
+			static_cast<unsigned long long>(samples.active), sorted.size());
+		for (u32 i = 0; i < std::min<u32>(REPORT_TOP_FUNCTIONS, static_cast<u32>(sorted.size())); i++)
+		{
+			std::fprintf(report_fp.get(), "  %5.1f%% %8u  %s\n",
+				static_cast<double>(sorted[i].samples) * 100.0 / static_cast<double>(samples.active), sorted[i].samples,
+				sorted[i].name.c_str());
+		}
+	}
+
+	Console.WriteLn("Hotspot profiler: Wrote %llu samples to '%s'.", static_cast<unsigned long long>(s_ticks),
+		report_path.c_str());
+}
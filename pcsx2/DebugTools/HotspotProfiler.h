@@ -0,0 +1,26 @@
+// SPDX-FileCopyrightText: 2002-2024 PCSX2 Dev Team
+// SPDX-License-Identifier: GPL-3.0+
+
+#pragma once
+
+#include "common/Pcsx2Types.h"
+
+// --------------------------------------------------------------------------------------
+//  HotspotProfiler
+// --------------------------------------------------------------------------------------
+// Sampling profiler for guest code. A background thread periodically records the PC of the
+// block each processor is running, which is attributed to guest functions using the symbol
+// tables when the profiler is stopped. Results are written to the logs folder as a folded
+// stacks file (for flamegraph.pl and compatible viewers) and a text report of the hottest
+// functions per processor.
+//
+namespace HotspotProfiler
+{
+	/// Starts sampling the processors selected in EmuConfig.Profiler.
+	void Start();
+
+	/// Stops sampling and writes the reports, if any samples were taken.
+	void Stop();
+
+	bool IsActive();
+} // namespace HotspotProfiler
@@ -151,6 +151,25 @@ FunctionInfo SymbolGuardian::FunctionOverlappingAddress(u32 address) const
 	return info;
 }
 
+std::optional<FunctionInfo> SymbolGuardian::TryFunctionOverlappingAddress(u32 address) const
+{
+	std::shared_lock lock(m_big_symbol_lock, std::try_to_lock);
+	if (!lock.owns_lock())
+		return std::nullopt;
+
+	const ccc::Function* function = m_database.functions.symbol_overlapping_address(address);
+	if (!function)
+		return std::nullopt;
+
+	FunctionInfo info;
+	info.handle = function->handle();
+	info.name = function->name();
+	info.address = function->address();
+	info.size = function->size();
+	info.is_no_return = function->is_no_return;
+	return info;
+}
+
 void SymbolGuardian::GenerateFunctionHashes(ccc::SymbolDatabase& database, MemoryReader& reader)
 {
 	for (ccc::Function& function : database.functions)
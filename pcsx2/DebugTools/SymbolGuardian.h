@@ -74,6 +74,10 @@ public:
 	FunctionInfo FunctionStartingAtAddress(u32 address) const;
 	FunctionInfo FunctionOverlappingAddress(u32 address) const;
 
+	// Same as FunctionOverlappingAddress, but gives up instead of waiting if
+	// the database is currently being written to.
+	std::optional<FunctionInfo> TryFunctionOverlappingAddress(u32 address) const;
+
 	// Hash all the functions in the database and store the hashes in the
 	// original hash field of said objects.
 	static void GenerateFunctionHashes(ccc::SymbolDatabase& database, MemoryReader& reader);
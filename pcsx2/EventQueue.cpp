@@ -0,0 +1,43 @@
+// SPDX-FileCopyrightText: 2002-2024 PCSX2 Dev Team
+// SPDX-License-Identifier: GPL-3.0+
+
+#include "EventQueue.h"
+
+#include "common/Console.h"
+
+#include <algorithm>
+
+void EventQueue::UpdateFrameStats()
+{
+	if (m_stats.frame != 0)
+	{
+		m_stats.frames++;
+		m_stats.max_frame_dispatched = std::max(m_stats.max_frame_dispatched, m_stats.frame_dispatched);
+		m_stats.max_frame_overhead_ticks = std::max(m_stats.max_frame_overhead_ticks, m_stats.frame_overhead_ticks);
+	}
+
+	m_stats.frame = g_FrameCount;
+	m_stats.frame_dispatched = 0;
+	m_stats.frame_overhead_ticks = 0;
+}
+
+void EventQueue::LogStats(const char* name)
+{
+	if (m_stats.frames == 0)
+		return;
+
+	const double frames = static_cast<double>(m_stats.frames);
+	DevCon.WriteLn("%s events: %u frames, %.1f event tests/frame, %.1f events dispatched/frame (max %u), %llu stale entries",
+		name, m_stats.frames, static_cast<double>(m_stats.tests) / frames, static_cast<double>(m_stats.dispatched) / frames,
+		m_stats.max_frame_dispatched, static_cast<unsigned long long>(m_stats.stale));
+#ifdef PCSX2_DEVBUILD
+	DevCon.WriteLn("%s events: scheduler overhead %.3f ms/frame (max %.3f)", name,
+		Common::Timer::ConvertValueToMilliseconds(m_stats.overhead_ticks) / frames,
+		Common::Timer::ConvertValueToMilliseconds(m_stats.max_frame_overhead_ticks));
+#endif
+}
+
+void EventQueue::ResetStats()
+{
+	m_stats = {};
+}
@@ -0,0 +1,196 @@
+// SPDX-FileCopyrightText: 2002-2024 PCSX2 Dev Team
+// SPDX-License-Identifier: GPL-3.0+
+
+#pragma once
+
+#include "Counters.h"
+
+#include "common/Pcsx2Defs.h"
+#include "common/Timer.h"
+
+// --------------------------------------------------------------------------------------
+//  EventQueue
+// --------------------------------------------------------------------------------------
+// Min-heap of the cycle events pending on a CPU, so an event test only has to look at the
+// events which are due instead of polling every source. The heap is indexed by event id,
+// rescheduling an event moves it rather than adding a second entry.
+//
+// The CPU's interrupt mask and start/delta cycles remain the authoritative state (they're
+// what gets saved), and some code clears or delays events directly. Entries can therefore
+// be stale, but only ever early: the owner checks each popped entry against its own state,
+// and reschedules it if it isn't actually due yet.
+//
+class EventQueue
+{
+public:
+	static constexpr u32 MAX_EVENTS = 32;
+
+	struct Stats
+	{
+		u32 frames;
+		u32 frame; // g_FrameCount of the current frame
+		u64 tests;
+		u64 dispatched;
+		u64 stale;
+		u32 frame_dispatched;
+		u32 max_frame_dispatched;
+		u64 overhead_ticks;
+		u64 frame_overhead_ticks;
+		u64 max_frame_overhead_ticks;
+	};
+
+	EventQueue() { Clear(); }
+
+	void Clear()
+	{
+		m_size = 0;
+		for (u8& pos : m_pos)
+			pos = NOT_QUEUED;
+	}
+
+	__fi bool IsEmpty() const { return m_size == 0; }
+
+	/// Cycle the earliest event is due at. The queue must not be empty.
+	__fi u32 GetNextDue() const { return m_heap[0].due; }
+
+	/// Returns true if the earliest event is due at the specified cycle.
+	__fi bool HasDue(u32 cycle) const { return m_size > 0 && static_cast<s32>(cycle - m_heap[0].due) >= 0; }
+
+	/// Adds an event, or moves it if it's already queued.
+	void Schedule(u32 id, u32 due)
+	{
+		u32 pos = m_pos[id];
+		if (pos == NOT_QUEUED)
+		{
+			pos = m_size++;
+			m_heap[pos] = {due, id};
+			m_pos[id] = static_cast<u8>(pos);
+			SiftUp(pos);
+		}
+		else
+		{
+			const bool earlier = Before(due, m_heap[pos].due);
+			m_heap[pos].due = due;
+			if (earlier)
+				SiftUp(pos);
+			else
+				SiftDown(pos);
+		}
+	}
+
+	/// Removes the earliest event and returns its id. The queue must not be empty.
+	u32 Pop()
+	{
+		const u32 id = m_heap[0].id;
+		m_pos[id] = NOT_QUEUED;
+		if (--m_size > 0)
+		{
+			m_heap[0] = m_heap[m_size];
+			m_pos[m_heap[0].id] = 0;
+			SiftDown(0);
+		}
+		return id;
+	}
+
+	// Statistics, logged on reset. Counters are cheap enough to always keep, the scheduler's own time is only
+	// measured in dev builds since reading the timer costs about as much as the bookkeeping it measures.
+
+	__fi void AddTest()
+	{
+		if (m_stats.frame != g_FrameCount) [[unlikely]]
+			UpdateFrameStats();
+		m_stats.tests++;
+	}
+
+	__fi void AddDispatched()
+	{
+		m_stats.dispatched++;
+		m_stats.frame_dispatched++;
+	}
+
+	__fi void AddStale() { m_stats.stale++; }
+
+	class ScopedOverhead
+	{
+	public:
+#ifdef PCSX2_DEVBUILD
+		__fi ScopedOverhead(EventQueue& queue)
+			: m_queue(queue)
+			, m_start(Common::Timer::GetCurrentValue())
+		{
+		}
+
+		__fi ~ScopedOverhead()
+		{
+			const u64 ticks = Common::Timer::GetCurrentValue() - m_start;
+			m_queue.m_stats.overhead_ticks += ticks;
+			m_queue.m_stats.frame_overhead_ticks += ticks;
+		}
+
+	private:
+		EventQueue& m_queue;
+		Common::Timer::Value m_start;
+#else
+		__fi ScopedOverhead(EventQueue& queue) {}
+#endif
+	};
+
+	void LogStats(const char* name);
+	void ResetStats();
+
+private:
+	static constexpr u8 NOT_QUEUED = 0xFF;
+
+	struct Entry
+	{
+		u32 due;
+		u32 id;
+	};
+
+	// Cycle counters wrap, pending events are always within 2^31 cycles of each other.
+	static __fi bool Before(u32 a, u32 b) { return static_cast<s32>(a - b) < 0; }
+
+	void SiftUp(u32 pos)
+	{
+		const Entry entry = m_heap[pos];
+		while (pos > 0)
+		{
+			const u32 parent = (pos - 1) / 2;
+			if (!Before(entry.due, m_heap[parent].due))
+				break;
+			m_heap[pos] = m_heap[parent];
+			m_pos[m_heap[pos].id] = static_cast<u8>(pos);
+			pos = parent;
+		}
+		m_heap[pos] = entry;
+		m_pos[entry.id] = static_cast<u8>(pos);
+	}
+
+	void SiftDown(u32 pos)
+	{
+		const Entry entry = m_heap[pos];
+		for (;;)
+		{
+			u32 child = pos * 2 + 1;
+			if (child >= m_size)
+				break;
+			if ((child + 1) < m_size && Before(m_heap[child + 1].due, m_heap[child].due))
+				child++;
+			if (!Before(m_heap[child].due, entry.due))
+				break;
+			m_heap[pos] = m_heap[child];
+			m_pos[m_heap[pos].id] = static_cast<u8>(pos);
+			pos = child;
+		}
+		m_heap[pos] = entry;
+		m_pos[entry.id] = static_cast<u8>(pos);
+	}
+
+	void UpdateFrameStats();
+
+	Entry m_heap[MAX_EVENTS];
+	u8 m_pos[MAX_EVENTS];
+	u32 m_size;
+
+	Stats m_stats = {};
+};
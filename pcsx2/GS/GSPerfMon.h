@@ -27,6 +27,9 @@ public:
 		// Reused counters for HW.
 		TextureCopies = Fillrate,
 		TextureUploads = SyncPoint,
+
+		// Reused counters for SW.
+		TextureDecodePages = Barriers,
 	};
 
 protected:
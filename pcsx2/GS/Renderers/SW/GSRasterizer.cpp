@@ -6,12 +6,14 @@
 #include "GS/Renderers/SW/GSRasterizer.h"
 #include "GS/Renderers/SW/GSDrawScanline.h"
 #include "GS/GSExtra.h"
+#include "GS/GSUtil.h"
 #include "PerformanceMetrics.h"
 #include "VMManager.h"
 
 #include "common/AlignedMalloc.h"
 #include "common/Console.h"
 #include "common/StringUtil.h"
+#include "common/Timer.h"
 
 #define ENABLE_DRAW_STATS 0
 
@@ -33,10 +35,11 @@ static int compute_best_thread_height(int threads)
 		return 4;
 }
 
-GSRasterizer::GSRasterizer(GSDrawScanline* ds, int id, int threads)
+GSRasterizer::GSRasterizer(GSDrawScanline* ds, int id, int threads, bool tiled)
 	: m_ds(ds)
 	, m_id(id)
-	, m_threads(threads)
+	, m_threads(tiled ? 1 : threads)
+	, m_tile_threads(tiled ? threads : 0)
 	, m_scanmsk_value(0)
 {
 	memset(&m_pixels, 0, sizeof(m_pixels));
@@ -52,9 +55,10 @@ GSRasterizer::GSRasterizer(GSDrawScanline* ds, int id, int threads)
 	int rows = (2048 >> m_thread_height) + 16;
 	m_scanline = (u8*)_aligned_malloc(rows, 64);
 
+	// When tiled, every scanline is ours, and tiles are split between threads by clipping to them.
 	for (int i = 0; i < rows; i++)
 	{
-		m_scanline[i] = (i % threads) == id ? 1 : 0;
+		m_scanline[i] = (tiled || (i % threads) == id) ? 1 : 0;
 	}
 }
 
@@ -140,6 +144,39 @@ void GSRasterizer::Draw(GSRasterizerData& data)
 	m_draw_edge = data.draw_edge;
 	GSDrawScanline::BeginDraw(data, m_local);
 
+	m_scanmsk_value = data.scanmsk_value;
+
+	if (m_tile_threads > 0)
+	{
+		DrawTiles(data);
+	}
+	else
+	{
+		SetScissor(data.scissor);
+		DrawPrimitives(data, !data.bbox.eq(data.bbox.rintersect(data.scissor)));
+	}
+
+#if _M_SSE >= 0x501
+	_mm256_zeroupper();
+#endif
+
+	data.pixels = m_pixels.actual;
+
+	m_pixels.sum += m_pixels.actual;
+
+	if constexpr (ENABLE_DRAW_STATS)
+		m_ds->UpdateDrawStats(data.frame, GetCPUTicks() - data.start, m_pixels.actual, m_pixels.total, m_primcount);
+}
+
+void GSRasterizer::SetScissor(const GSVector4i& scissor)
+{
+	m_scissor = scissor;
+	m_fscissor_x = GSVector4(scissor).xzxz();
+	m_fscissor_y = GSVector4(scissor).ywyw();
+}
+
+void GSRasterizer::DrawPrimitives(const GSRasterizerData& data, bool scissor_test)
+{
 	const GSVertexSW* vertex = data.vertex;
 	const GSVertexSW* vertex_end = data.vertex + data.vertex_count;
 
@@ -148,13 +185,6 @@ void GSRasterizer::Draw(GSRasterizerData& data)
 
 	static constexpr u16 tmp_index[] = {0, 1, 2};
 
-	bool scissor_test = !data.bbox.eq(data.bbox.rintersect(data.scissor));
-
-	m_scissor = data.scissor;
-	m_fscissor_x = GSVector4(data.scissor).xzxz();
-	m_fscissor_y = GSVector4(data.scissor).ywyw();
-	m_scanmsk_value = data.scanmsk_value;
-
 	switch (data.primclass)
 	{
 		case GS_POINT_CLASS:
@@ -236,17 +266,81 @@ void GSRasterizer::Draw(GSRasterizerData& data)
 		default:
 			ASSUME(0);
 	}
+}
 
-#if _M_SSE >= 0x501
-	_mm256_zeroupper();
-#endif
+void GSRasterizer::DrawPrimitive(const GSRasterizerData& data, u32 prim)
+{
+	static constexpr u16 tmp_index[] = {0, 1, 2};
 
-	data.pixels = m_pixels.actual;
+	const u32 n = GSUtil::GetClassVertexCount(data.primclass);
 
-	m_pixels.sum += m_pixels.actual;
+	const GSVertexSW* vertex = data.vertex;
+	const u16* index = tmp_index;
 
-	if constexpr (ENABLE_DRAW_STATS)
-		m_ds->UpdateDrawStats(data.frame, GetCPUTicks() - data.start, m_pixels.actual, m_pixels.total, m_primcount);
+	if (data.index != NULL)
+		index = data.index + prim * n;
+	else
+		vertex += prim * n;
+
+	switch (data.primclass)
+	{
+		case GS_POINT_CLASS:
+			DrawPoint<true>(vertex, 1, index, 1);
+			break;
+
+		case GS_LINE_CLASS:
+			DrawLine(vertex, index);
+			break;
+
+		case GS_TRIANGLE_CLASS:
+			DrawTriangle(vertex, index);
+			break;
+
+		case GS_SPRITE_CLASS:
+			DrawSprite(vertex, index);
+			break;
+
+		default:
+			ASSUME(0);
+	}
+}
+
+void GSRasterizer::DrawTiles(const GSRasterizerData& data)
+{
+	// Each tile is drawn by clipping the primitives to it, the scissor test is the same as for the whole draw.
+
+	const GSVector4i& tiles = data.tiles;
+	const int pitch = tiles.width();
+
+	for (int ty = tiles.top; ty < tiles.bottom; ty++)
+	{
+		for (int tx = tiles.left; tx < tiles.right; tx++)
+		{
+			if (GetTileOwner(tx, ty, m_tile_threads) != m_id)
+				continue;
+
+			const int tile = (ty - tiles.top) * pitch + (tx - tiles.left);
+
+			if (data.tile_offsets && data.tile_offsets[tile] == data.tile_offsets[tile + 1])
+				continue;
+
+			const GSVector4i rect(
+				tx << GSRasterizerData::TILE_WIDTH_SHIFT, ty << GSRasterizerData::TILE_HEIGHT_SHIFT,
+				(tx + 1) << GSRasterizerData::TILE_WIDTH_SHIFT, (ty + 1) << GSRasterizerData::TILE_HEIGHT_SHIFT);
+
+			SetScissor(data.scissor.rintersect(rect));
+
+			if (data.tile_offsets)
+			{
+				for (u32 i = data.tile_offsets[tile]; i < data.tile_offsets[tile + 1]; i++)
+					DrawPrimitive(data, data.tile_prims[i]);
+			}
+			else
+			{
+				DrawPrimitives(data, true);
+			}
+		}
+	}
 }
 
 template <bool scissor_test>
@@ -1186,10 +1280,19 @@ void GSSingleRasterizer::PrintStats()
 #endif
 }
 
+bool GSSingleRasterizer::IsTileBinned() const
+{
+	return false;
+}
+
 //
 
-GSRasterizerList::GSRasterizerList(int threads)
+GSRasterizerList::GSRasterizerList(int threads, bool tiled)
+	: m_tiled(tiled)
+	, m_exit(false)
 {
+	const int slots = threads * SLOTS_PER_THREAD;
+
 	m_thread_height = compute_best_thread_height(threads);
 
 	const int rows = (2048 >> m_thread_height) + 16;
@@ -1197,14 +1300,25 @@ GSRasterizerList::GSRasterizerList(int threads)
 
 	for (int i = 0; i < rows; i++)
 	{
-		m_scanline[i] = static_cast<u8>(i % threads);
+		m_scanline[i] = static_cast<u8>(i % slots);
 	}
 
+	if (tiled)
+		m_tile_queued.resize(slots);
+
 	PerformanceMetrics::SetGSSWThreadCount(threads);
 }
 
 GSRasterizerList::~GSRasterizerList()
 {
+	m_exit = true;
+
+	for (const std::unique_ptr<Worker>& worker : m_workers)
+	{
+		worker->sema.NotifyOfWork();
+		worker->thread.join();
+	}
+
 	PerformanceMetrics::SetGSSWThreadCount(0);
 	_aligned_free(m_scanline);
 }
@@ -1227,6 +1341,95 @@ void GSRasterizerList::OnWorkerShutdown(int i)
 {
 }
 
+void GSRasterizerList::WorkerThread(int i, u64 affinity)
+{
+	OnWorkerStartup(i, affinity);
+
+	Worker& worker = *m_workers[i];
+
+	while (true)
+	{
+		worker.sema.WaitForWorkWithSpin();
+		if (m_exit)
+			break;
+
+		// Anything drawn may have left other slots unlocked with work queued, keep going until there's nothing left.
+		while (DrawSlots(i))
+			;
+	}
+
+	OnWorkerShutdown(i);
+}
+
+bool GSRasterizerList::DrawSlots(int i)
+{
+	const int slots = static_cast<int>(m_slots.size());
+	const int home = i * SLOTS_PER_THREAD;
+	bool drawn = false;
+
+	for (int n = 0; n < slots; n++)
+	{
+		Slot& slot = *m_slots[(home + n) % slots];
+
+		if (slot.queue.empty() || slot.busy.load(std::memory_order_relaxed) || slot.busy.exchange(true, std::memory_order_acquire))
+			continue;
+
+		const Common::Timer::Value start = Common::Timer::GetCurrentValue();
+		u32 batches = 0;
+
+		auto draw = [&slot, &batches](GSRingHeap::SharedPtr<GSRasterizerData>& item) {
+			slot.r->Draw(*item.get());
+			batches++;
+		};
+
+		for (;;)
+		{
+			while (slot.queue.consume_one(draw))
+				;
+
+			slot.busy.store(false, std::memory_order_release);
+
+			// Push() only wakes up the slot's own thread when it doesn't see the slot as busy, so anything pushed
+			// after the queue was drained but before busy was cleared has to be picked up here. Pairs with the
+			// fence in Push().
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (slot.queue.empty() || slot.busy.exchange(true, std::memory_order_acquire))
+				break;
+		}
+
+		PerformanceMetrics::AddGSSWThreadWork(i, Common::Timer::GetCurrentValue() - start, batches,
+			(n >= SLOTS_PER_THREAD) ? batches : 0);
+
+		drawn = true;
+	}
+
+	return drawn;
+}
+
+void GSRasterizerList::Push(int slot, const GSRingHeap::SharedPtr<GSRasterizerData>& data)
+{
+	Slot& s = *m_slots[slot];
+
+	// The slot's thread is already behind, so wake the others too, any which are idle will help out.
+	const bool behind = !s.queue.empty();
+
+	while (!s.queue.push(data))
+		std::this_thread::yield();
+
+	// If another thread is still draining the slot it may miss this push, see DrawSlots(), so wake everyone.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (behind || s.busy.load(std::memory_order_relaxed))
+	{
+		for (const std::unique_ptr<Worker>& worker : m_workers)
+			worker->sema.NotifyOfWork();
+	}
+	else
+	{
+		m_workers[slot / SLOTS_PER_THREAD]->sema.NotifyOfWork();
+	}
+}
+
 void GSRasterizerList::Queue(const GSRingHeap::SharedPtr<GSRasterizerData>& data)
 {
 	GSVector4i r = data->bbox.rintersect(data->scissor);
@@ -1240,12 +1443,45 @@ void GSRasterizerList::Queue(const GSRingHeap::SharedPtr<GSRasterizerData>& data
 
 	pxAssert(r.top >= 0 && r.top < 2048 && r.bottom >= 0 && r.bottom < 2048);
 
+	if (m_tiled)
+	{
+		// Only queue to the slots which own a tile with something to draw.
+
+		const GSVector4i& tiles = data->tiles;
+		const int slots = static_cast<int>(m_slots.size());
+		int queued = 0;
+		int tile = 0;
+
+		std::fill(m_tile_queued.begin(), m_tile_queued.end(), 0);
+
+		for (int ty = tiles.top; ty < tiles.bottom; ty++)
+		{
+			for (int tx = tiles.left; tx < tiles.right; tx++, tile++)
+			{
+				if (data->tile_offsets && data->tile_offsets[tile] == data->tile_offsets[tile + 1])
+					continue;
+
+				const int owner = GSRasterizer::GetTileOwner(tx, ty, slots);
+				if (m_tile_queued[owner])
+					continue;
+
+				m_tile_queued[owner] = 1;
+				Push(owner, data);
+
+				if (++queued == slots)
+					return;
+			}
+		}
+
+		return;
+	}
+
 	int top = r.top >> m_thread_height;
-	int bottom = std::min<int>((r.bottom + (1 << m_thread_height) - 1) >> m_thread_height, top + m_workers.size());
+	int bottom = std::min<int>((r.bottom + (1 << m_thread_height) - 1) >> m_thread_height, top + m_slots.size());
 
 	while (top < bottom)
 	{
-		m_workers[m_scanline[top++]]->Push(data);
+		Push(m_scanline[top++], data);
 	}
 }
 
@@ -1253,20 +1489,23 @@ void GSRasterizerList::Sync()
 {
 	if (!IsSynced())
 	{
+		// Only the GS thread queues work, so once a thread has run out it stays idle.
 		for (size_t i = 0; i < m_workers.size(); i++)
 		{
-			m_workers[i]->Wait();
+			m_workers[i]->sema.WaitForEmptyWithSpin();
 		}
 
+		pxAssert(IsSynced());
+
 		g_perfmon.Put(GSPerfMon::SyncPoint, 1);
 	}
 }
 
 bool GSRasterizerList::IsSynced() const
 {
-	for (size_t i = 0; i < m_workers.size(); i++)
+	for (size_t i = 0; i < m_slots.size(); i++)
 	{
-		if (!m_workers[i]->IsEmpty())
+		if (!m_slots[i]->queue.empty())
 		{
 			return false;
 		}
@@ -1279,9 +1518,9 @@ int GSRasterizerList::GetPixels(bool reset)
 {
 	int pixels = 0;
 
-	for (size_t i = 0; i < m_workers.size(); i++)
+	for (size_t i = 0; i < m_slots.size(); i++)
 	{
-		pixels += m_r[i]->GetPixels(reset);
+		pixels += m_slots[i]->r->GetPixels(reset);
 	}
 
 	return pixels;
@@ -1289,29 +1528,40 @@ int GSRasterizerList::GetPixels(bool reset)
 
 std::unique_ptr<IRasterizer> GSRasterizerList::Create(int threads)
 {
-	threads = std::max<int>(threads, 0);
+	// Slots are numbered with a byte.
+	threads = std::clamp<int>(threads, 0, 255 / SLOTS_PER_THREAD);
 
 	if (threads == 0)
 	{
 		return std::make_unique<GSSingleRasterizer>();
 	}
 
-	std::unique_ptr<GSRasterizerList> rl(new GSRasterizerList(threads));
+	const bool tiled = GSConfig.SWTileRasterization;
+	std::unique_ptr<GSRasterizerList> rl(new GSRasterizerList(threads, tiled));
+	if (tiled)
+		INFO_LOG("Using tile binned rasterization on {} SW threads", threads);
 
 	const std::vector<u32>& procs = VMManager::Internal::GetSoftwareRendererProcessorList();
 	const bool pin = (EmuConfig.EnableThreadPinning && static_cast<size_t>(threads) <= procs.size());
 	if (EmuConfig.EnableThreadPinning && !pin)
 		WARNING_LOG("Not pinning SW threads, we need {} processors, but only have {}", threads, procs.size());
 
+	const int slots = threads * SLOTS_PER_THREAD;
+	for (int i = 0; i < slots; i++)
+	{
+		std::unique_ptr<Slot> slot = std::make_unique<Slot>();
+		slot->r = std::unique_ptr<GSRasterizer>(new GSRasterizer(&rl->m_ds, i, slots, tiled));
+		rl->m_slots.push_back(std::move(slot));
+	}
+
+	// Threads look at all the workers, so they're only started once everything is created.
+	for (int i = 0; i < threads; i++)
+		rl->m_workers.push_back(std::make_unique<Worker>());
+
 	for (int i = 0; i < threads; i++)
 	{
 		const u64 affinity = pin ? (static_cast<u64>(1u) << procs[i]) : 0;
-		rl->m_r.push_back(std::unique_ptr<GSRasterizer>(new GSRasterizer(&rl->m_ds, i, threads)));
-		auto& r = *rl->m_r[i];
-		rl->m_workers.push_back(std::unique_ptr<GSWorker>(new GSWorker(
-			[i, affinity]() { GSRasterizerList::OnWorkerStartup(i, affinity); },
-			[&r](GSRingHeap::SharedPtr<GSRasterizerData>& item) { r.Draw(*item.get()); },
-			[i]() { GSRasterizerList::OnWorkerShutdown(i); })));
+		rl->m_workers[i]->thread = std::thread(&GSRasterizerList::WorkerThread, rl.get(), i, affinity);
 	}
 
 	return rl;
@@ -1320,3 +1570,8 @@ std::unique_ptr<IRasterizer> GSRasterizerList::Create(int threads)
 void GSRasterizerList::PrintStats()
 {
 }
+
+bool GSRasterizerList::IsTileBinned() const
+{
+	return m_tiled;
+}
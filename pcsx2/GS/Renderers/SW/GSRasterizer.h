@@ -7,10 +7,15 @@
 #include "GS/Renderers/SW/GSDrawScanline.h"
 #include "GS/GSAlignedClass.h"
 #include "GS/GSPerfMon.h"
-#include "GS/GSJobQueue.h"
 #include "GS/GSRingHeap.h"
 #include "GS/MultiISA.h"
 
+#include "common/boost_spsc_queue.hpp"
+#include "common/Threading.h"
+
+#include <atomic>
+#include <thread>
+
 MULTI_ISA_UNSHARED_START
 
 class GSDrawScanline;
@@ -20,8 +25,13 @@ class alignas(32) GSRasterizerData : public GSAlignedClass<32>
 	static int s_counter;
 
 public:
+	// Screen tiles of the tile binned rasterizer, each covers one 32-bit frame buffer page.
+	static constexpr int TILE_WIDTH_SHIFT = 6;
+	static constexpr int TILE_HEIGHT_SHIFT = 5;
+
 	GSVector4i scissor;
 	GSVector4i bbox;
+	GSVector4i tiles; // bbox and scissor intersection, in tiles
 	GS_PRIM_CLASS primclass;
 	u8* buff;
 	GSVertexSW* vertex;
@@ -34,6 +44,11 @@ public:
 	int counter;
 	u8 scanmsk_value;
 
+	// Primitives overlapping each tile, tile_prims[tile_offsets[i]] up to tile_prims[tile_offsets[i + 1]] for tile i.
+	// When the draw hasn't been binned, the tiles are still split between threads, but every primitive is drawn in each.
+	u32* tile_offsets;
+	u32* tile_prims;
+
 	GSScanlineGlobalData global;
 
 	GSDrawScanline::SetupPrimPtr setup_prim;
@@ -43,6 +58,7 @@ public:
 	GSRasterizerData()
 		: scissor(GSVector4i::zero())
 		, bbox(GSVector4i::zero())
+		, tiles(GSVector4i::zero())
 		, primclass(GS_INVALID_CLASS)
 		, buff(nullptr)
 		, vertex(NULL)
@@ -53,6 +69,8 @@ public:
 		, start(0)
 		, pixels(0)
 		, scanmsk_value(0)
+		, tile_offsets(nullptr)
+		, tile_prims(nullptr)
 	{
 		counter = s_counter++;
 	}
@@ -61,6 +79,10 @@ public:
 	{
 		if (buff != NULL)
 			GSRingHeap::free(buff);
+		if (tile_offsets != nullptr)
+			GSRingHeap::free(tile_offsets);
+		if (tile_prims != nullptr)
+			GSRingHeap::free(tile_prims);
 	}
 };
 
@@ -71,6 +93,7 @@ protected:
 	int m_id;
 	int m_threads;
 	int m_thread_height;
+	int m_tile_threads;
 	u8* m_scanline;
 	u8 m_scanmsk_value;
 	GSVector4i m_scissor;
@@ -88,6 +111,11 @@ protected:
 
 	__forceinline bool HasEdge() const { return (m_draw_edge != nullptr); }
 
+	void SetScissor(const GSVector4i& scissor);
+	void DrawPrimitives(const GSRasterizerData& data, bool scissor_test);
+	void DrawPrimitive(const GSRasterizerData& data, u32 prim);
+	void DrawTiles(const GSRasterizerData& data);
+
 	template <bool scissor_test>
 	void DrawPoint(const GSVertexSW* vertex, int vertex_count, const u16* index, int index_count);
 	void DrawLine(const GSVertexSW* vertex, const u16* index);
@@ -109,9 +137,12 @@ protected:
 	__forceinline void DrawEdge(int pixels, int left, int top, const GSVertexSW& scan);
 
 public:
-	GSRasterizer(GSDrawScanline* ds, int id, int threads);
+	GSRasterizer(GSDrawScanline* ds, int id, int threads, bool tiled = false);
 	~GSRasterizer();
 
+	/// Thread drawing the specified tile in tile binned mode.
+	static __forceinline int GetTileOwner(int tx, int ty, int threads) { return (tx + ty) % threads; }
+
 	__forceinline bool IsOneOfMyScanlines(int top) const;
 	__forceinline bool IsOneOfMyScanlines(int top, int bottom) const;
 	__forceinline int FindMyNextScanline(int top) const;
@@ -130,6 +161,9 @@ public:
 	virtual bool IsSynced() const = 0;
 	virtual int GetPixels(bool reset = true) = 0;
 	virtual void PrintStats() = 0;
+
+	/// Returns true if draws have to be binned into tiles before they're queued.
+	virtual bool IsTileBinned() const = 0;
 };
 
 class GSSingleRasterizer final : public IRasterizer
@@ -143,6 +177,7 @@ public:
 	bool IsSynced() const override;
 	int GetPixels(bool reset = true) override;
 	void PrintStats() override;
+	bool IsTileBinned() const override;
 
 	void Draw(GSRasterizerData& data);
 
@@ -154,17 +189,42 @@ private:
 class GSRasterizerList final : public IRasterizer
 {
 protected:
-	using GSWorker = GSJobQueue<GSRingHeap::SharedPtr<GSRasterizerData>, 65536>;
+	// Scanline bands (or tiles) are split between slots, each of which is only drawn by one thread at a time, which
+	// keeps the draws to any pixel in order. Threads start with their own slots, and then steal from any other slot
+	// which has work queued but isn't being drawn, so a draw landing mostly in one thread's bands doesn't leave the
+	// others waiting for Sync().
+	static constexpr int SLOTS_PER_THREAD = 2;
+	static constexpr int SLOT_QUEUE_SIZE = 32768;
+
+	struct Slot
+	{
+		ringbuffer_base<GSRingHeap::SharedPtr<GSRasterizerData>, SLOT_QUEUE_SIZE> queue;
+		std::atomic<bool> busy{false};
+		std::unique_ptr<GSRasterizer> r;
+	};
+
+	struct Worker
+	{
+		std::thread thread;
+		Threading::WorkSema sema;
+	};
 
 	GSDrawScanline m_ds;
 
-	// Worker threads depend on the rasterizers, so don't change the order.
-	std::vector<std::unique_ptr<GSRasterizer>> m_r;
-	std::vector<std::unique_ptr<GSWorker>> m_workers;
+	// Worker threads depend on the slots, so don't change the order.
+	std::vector<std::unique_ptr<Slot>> m_slots;
+	std::vector<std::unique_ptr<Worker>> m_workers;
 	u8* m_scanline;
 	int m_thread_height;
+	bool m_tiled;
+	bool m_exit;
+	std::vector<u8> m_tile_queued;
+
+	GSRasterizerList(int threads, bool tiled);
 
-	GSRasterizerList(int threads);
+	void Push(int slot, const GSRingHeap::SharedPtr<GSRasterizerData>& data);
+	void WorkerThread(int i, u64 affinity);
+	bool DrawSlots(int i);
 
 	static void OnWorkerStartup(int i, u64 affinity);
 	static void OnWorkerShutdown(int i);
@@ -181,6 +241,7 @@ public:
 	bool IsSynced() const override;
 	int GetPixels(bool reset) override;
 	void PrintStats() override;
+	bool IsTileBinned() const override;
 };
 
 MULTI_ISA_UNSHARED_END
@@ -6,7 +6,13 @@
 #include "GS/GSPng.h"
 #include "GS/GSUtil.h"
 
+#include "common/Console.h"
 #include "common/StringUtil.h"
+#include "common/Timer.h"
+
+#include "fmt/core.h"
+
+#include <bit>
 
 MULTI_ISA_UNSHARED_IMPL;
 
@@ -26,7 +32,7 @@ GSRendererSW::GSRendererSW(int threads)
 {
 	m_nativeres = true; // ignore ini, sw is always native
 
-	m_tc = std::make_unique<GSTextureCacheSW>();
+	m_tc = std::make_unique<GSTextureCacheSW>(threads);
 	m_rl = GSRasterizerList::Create(threads);
 
 	m_output = (u8*)_aligned_malloc(1024 * 1024 * sizeof(u32), VECTOR_ALIGNMENT);
@@ -47,6 +53,9 @@ void GSRendererSW::Reset(bool hardware_reset)
 {
 	Sync(-1);
 
+	LogStallStats();
+	m_tc->LogStats();
+
 	m_tc->RemoveAll();
 
 	GSRenderer::Reset(hardware_reset);
@@ -54,6 +63,10 @@ void GSRendererSW::Reset(bool hardware_reset)
 
 void GSRendererSW::Destroy()
 {
+	LogStallStats();
+	if (m_tc)
+		m_tc->LogStats();
+
 	// Need to destroy worker queue first to stop any pending thread work
 	m_rl.reset();
 	m_tc.reset();
@@ -372,6 +385,11 @@ void GSRendererSW::Draw()
 		return;
 	}
 
+	if (m_rl->IsTileBinned())
+	{
+		BinPrimitives(sd, r);
+	}
+
 	if constexpr (LOG && false)
 	{
 		int n = GSUtil::GetVertexCount(PRIM->PRIM);
@@ -413,18 +431,22 @@ void GSRendererSW::Draw()
 		zb_pages = &_zb_pages;
 	}
 
-	// check if there is an overlap between this and previous targets
+	// check if there is an overlap between this and previous targets, if so wait for the draws using the pages to finish
+
+	u32 conflicts[16];
 
-	if (CheckTargetPages(fb_pages, zb_pages, r))
+	if (CheckTargetPages(fb_pages, zb_pages, r, conflicts))
 	{
-		sd->m_syncpoint = SharedData::SyncTarget;
+		WaitForPages(conflicts, true, StallTarget);
 	}
 
-	// check if the texture is not part of a target currently in use
+	// check if the texture is not part of a target currently in use, the whole texture can be updated so wait
+	// for anything reading it as well
 
 	if (CheckSourcePages(sd))
 	{
-		sd->m_syncpoint = SharedData::SyncSource;
+		for (size_t i = 0; sd->m_tex[i].t != NULL; i++)
+			WaitForPages(sd->m_tex[i].t->m_pages, true, StallSource);
 	}
 
 	// addref source and target pages
@@ -524,24 +546,96 @@ void GSRendererSW::Draw()
 	*/
 }
 
-void GSRendererSW::Queue(GSRingHeap::SharedPtr<GSRasterizerData>& item)
+void GSRendererSW::BinPrimitives(SharedData* sd, const GSVector4i& r)
 {
-	SharedData* sd = (SharedData*)item.get();
+	constexpr int tw = GSRasterizerData::TILE_WIDTH_SHIFT;
+	constexpr int th = GSRasterizerData::TILE_HEIGHT_SHIFT;
+
+	if (r.rempty())
+		return;
+
+	const GSVector4i tiles(r.left >> tw, r.top >> th, ((r.right - 1) >> tw) + 1, ((r.bottom - 1) >> th) + 1);
+	sd->tiles = tiles;
 
-	if (sd->m_syncpoint == SharedData::SyncSource)
+	const int pitch = tiles.width();
+	const int count = pitch * tiles.height();
+	const u32 n = GSUtil::GetClassVertexCount(sd->primclass);
+	const u32 prims = static_cast<u32>(sd->index_count) / n;
+
+	// Nothing to sort with a single primitive or tile, whoever owns a tile draws everything.
+	if (count <= 1 || prims <= 1)
+		return;
+
+	const GSVector4 fr(r);
+
+	// Tiles a primitive overlaps, relative to the draw's tiles. Bounds get a pixel of slack for rounding,
+	// drawing a primitive in a tile it doesn't actually touch only costs time.
+	const auto get_prim_tiles = [sd, n, &fr, &tiles](u32 prim) {
+		const u16* RESTRICT index = sd->index + prim * n;
+		GSVector4 pmin = sd->vertex[index[0]].p;
+		GSVector4 pmax = pmin;
+		for (u32 i = 1; i < n; i++)
+		{
+			pmin = pmin.min(sd->vertex[index[i]].p);
+			pmax = pmax.max(sd->vertex[index[i]].p);
+		}
+
+		const GSVector4 b = (pmin.xyxy(pmax).floor() + GSVector4(-1.0f, -1.0f, 2.0f, 2.0f)).max(fr.xyxy()).min(fr.zwzw());
+		const GSVector4i pr(b);
+		if (pr.rempty())
+			return GSVector4i::zero();
+
+		return GSVector4i(pr.left >> tw, pr.top >> th, ((pr.right - 1) >> tw) + 1, ((pr.bottom - 1) >> th) + 1) - tiles.xyxy();
+	};
+
+	// Counting sort: count the primitives in each tile, turn the counts into the end of each tile's list,
+	// then fill the lists back to front so every tile keeps the primitives in draw order.
+
+	u32* offsets = static_cast<u32*>(m_vertex_heap.alloc(sizeof(u32) * (count + 1), 64));
+	std::memset(offsets, 0, sizeof(u32) * (count + 1));
+
+	for (u32 prim = 0; prim < prims; prim++)
 	{
-		Sync(4);
+		const GSVector4i pt = get_prim_tiles(prim);
+		for (int y = pt.top; y < pt.bottom; y++)
+		{
+			for (int x = pt.left; x < pt.right; x++)
+				offsets[y * pitch + x]++;
+		}
 	}
 
-	// update previously invalidated parts
+	u32 total = 0;
+	for (int i = 0; i < count; i++)
+	{
+		total += offsets[i];
+		offsets[i] = total;
+	}
+	offsets[count] = total;
 
-	sd->UpdateSource();
+	u32* tile_prims = static_cast<u32*>(m_vertex_heap.alloc(sizeof(u32) * std::max<u32>(total, 1), 64));
 
-	if (sd->m_syncpoint == SharedData::SyncTarget)
+	for (u32 prim = prims; prim-- > 0;)
 	{
-		Sync(5);
+		const GSVector4i pt = get_prim_tiles(prim);
+		for (int y = pt.top; y < pt.bottom; y++)
+		{
+			for (int x = pt.left; x < pt.right; x++)
+				tile_prims[--offsets[y * pitch + x]] = prim;
+		}
 	}
 
+	sd->tile_offsets = offsets;
+	sd->tile_prims = tile_prims;
+}
+
+void GSRendererSW::Queue(GSRingHeap::SharedPtr<GSRasterizerData>& item)
+{
+	SharedData* sd = (SharedData*)item.get();
+
+	// update previously invalidated parts
+
+	sd->UpdateSource();
+
 	if constexpr (LOG)
 	{
 		GSScanlineGlobalData& gd = ((SharedData*)item.get())->global;
@@ -577,7 +671,15 @@ void GSRendererSW::Sync(int reason)
 
 	u64 t = LOG ? GetCPUTicks() : 0;
 
-	m_rl->Sync();
+	if (!m_rl->IsSynced())
+	{
+		const Common::Timer::Value start = Common::Timer::GetCurrentValue();
+
+		m_rl->Sync();
+
+		m_stalls.count[StallSync]++;
+		m_stalls.ticks[StallSync] += Common::Timer::GetCurrentValue() - start;
+	}
 
 	if constexpr (LOG && false)
 	{
@@ -611,6 +713,100 @@ void GSRendererSW::Sync(int reason)
 	g_perfmon.Put(GSPerfMon::Fillrate, pixels);
 }
 
+void GSRendererSW::WaitForPages(const GSOffset::PageLooper& pages, bool textures, StallReason reason)
+{
+	// Page use counts only drop when a draw is completely done, so this only waits for the queued draws
+	// which actually conflict, and everything else keeps going.
+
+	Common::Timer::Value start = 0;
+
+	pages.loopPages([this, textures, &start](u32 page) { WaitForPage(page, textures, start); });
+
+	if (start != 0)
+	{
+		m_stalls.count[reason]++;
+		m_stalls.ticks[reason] += Common::Timer::GetCurrentValue() - start;
+	}
+}
+
+void GSRendererSW::WaitForPages(const u32* pages, bool textures, StallReason reason)
+{
+	Common::Timer::Value start = 0;
+
+	for (u32 row = 0; row < 16; row++)
+	{
+		for (u32 mask = pages[row]; mask != 0; mask &= mask - 1)
+			WaitForPage((row << 5) | std::countr_zero(mask), textures, start);
+	}
+
+	if (start != 0)
+	{
+		m_stalls.count[reason]++;
+		m_stalls.ticks[reason] += Common::Timer::GetCurrentValue() - start;
+	}
+}
+
+void GSRendererSW::WaitForPage(u32 page, bool textures, u64& start)
+{
+	const auto in_use = [this, page, textures]() {
+		return (m_fzb_pages[page].load(std::memory_order_acquire) != 0 ||
+				(textures && m_tex_pages[page].load(std::memory_order_acquire) != 0));
+	};
+
+	// Spin for a bit like WorkSema does, then sleep until a draw releases its pages.
+	u32 waited = 0;
+	while (in_use())
+	{
+		if (start == 0)
+			start = Common::Timer::GetCurrentValue();
+
+		if (waited < SPIN_TIME_NS)
+		{
+			waited += ShortSpin();
+			continue;
+		}
+
+		m_page_waiting.store(true, std::memory_order_seq_cst);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (!in_use())
+		{
+			// If a worker took the flag in the meantime it has posted, which has to be consumed.
+			if (!m_page_waiting.exchange(false, std::memory_order_acq_rel))
+				m_page_released.Wait();
+			break;
+		}
+
+		m_page_released.Wait();
+	}
+}
+
+void GSRendererSW::LogStallStats()
+{
+	static constexpr const char* names[StallReasonCount] = {"target", "texture", "transfer write", "transfer read", "full sync"};
+
+	u64 total = 0;
+	for (u64 count : m_stalls.count)
+		total += count;
+
+	if (total > 0)
+	{
+		std::string str;
+		for (int i = 0; i < StallReasonCount; i++)
+		{
+			if (m_stalls.count[i] == 0)
+				continue;
+
+			str += fmt::format("{}{} {} ({:.2f} ms)", str.empty() ? "" : ", ", m_stalls.count[i], names[i],
+				Common::Timer::ConvertValueToMilliseconds(m_stalls.ticks[i]));
+		}
+
+		Console.WriteLn("GS SW: Waited for queued draws %llu times: %s.", static_cast<unsigned long long>(total), str.c_str());
+	}
+
+	m_stalls = {};
+}
+
 void GSRendererSW::InvalidateVideoMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r)
 {
 	if constexpr (LOG)
@@ -626,15 +822,7 @@ void GSRendererSW::InvalidateVideoMem(const GIFRegBITBLTBUF& BITBLTBUF, const GS
 
 	if (!m_rl->IsSynced())
 	{
-		pages.loopPagesWithBreak([this](u32 page)
-		{
-			if (m_fzb_pages[page] | m_tex_pages[page])
-			{
-				Sync(6);
-				return false;
-			}
-			return true;
-		});
+		WaitForPages(pages, true, StallTransferWrite);
 	}
 
 	m_tc->InvalidatePages(pages, off.psm()); // if texture update runs on a thread and Sync(5) happens then this must come later
@@ -653,15 +841,7 @@ void GSRendererSW::InvalidateLocalMem(const GIFRegBITBLTBUF& BITBLTBUF, const GS
 		GSOffset off = m_mem.GetOffset(BITBLTBUF.SBP, BITBLTBUF.SBW, BITBLTBUF.SPSM);
 		GSOffset::PageLooper pages = off.pageLooperForRect(r);
 
-		pages.loopPagesWithBreak([this](u32 page)
-		{
-			if (m_fzb_pages[page])
-			{
-				Sync(7);
-				return false;
-			}
-			return true;
-		});
+		WaitForPages(pages, false, StallTransferRead);
 	}
 }
 
@@ -711,9 +891,14 @@ void GSRendererSW::ReleasePages(const GSOffset::PageLooper& pages, const int typ
 				break;
 		}
 	});
+
+	// Wake up the GS thread if it's waiting in WaitForPage(), pairs with the fence there.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_page_waiting.load(std::memory_order_relaxed) && m_page_waiting.exchange(false, std::memory_order_acq_rel))
+		m_page_released.Post();
 }
 
-bool GSRendererSW::CheckTargetPages(const GSOffset::PageLooper* fb_pages, const GSOffset::PageLooper* zb_pages, const GSVector4i& r)
+bool GSRendererSW::CheckTargetPages(const GSOffset::PageLooper* fb_pages, const GSOffset::PageLooper* zb_pages, const GSVector4i& r, u32* conflicts)
 {
 	const bool synced = m_rl->IsSynced();
 
@@ -737,6 +922,8 @@ bool GSRendererSW::CheckTargetPages(const GSOffset::PageLooper* fb_pages, const
 
 	bool res = false;
 
+	memset(conflicts, 0, sizeof(m_fzb_cur_pages));
+
 	if (m_fzb != m_context->offset.fzb4)
 	{
 		// targets changed, check everything
@@ -782,6 +969,8 @@ bool GSRendererSW::CheckTargetPages(const GSOffset::PageLooper* fb_pages, const
 					fflush(s_fp);
 				}
 
+				memcpy(conflicts, m_fzb_cur_pages, sizeof(m_fzb_cur_pages));
+
 				res = true;
 			}
 
@@ -806,7 +995,7 @@ bool GSRendererSW::CheckTargetPages(const GSOffset::PageLooper* fb_pages, const
 
 			u32 used = 0;
 
-			fb_pages->loopPages([this, &used](u32 i)
+			const auto checkNewPage = [this, &used, conflicts](u32 i)
 			{
 				u32 row = i >> 5;
 				u32 col = 1 << (i & 31);
@@ -815,22 +1004,16 @@ bool GSRendererSW::CheckTargetPages(const GSOffset::PageLooper* fb_pages, const
 				{
 					m_fzb_cur_pages[row] |= col;
 
-					used |= m_fzb_pages[i];
+					if (m_fzb_pages[i])
+					{
+						conflicts[row] |= col;
+						used = 1;
+					}
 				}
-			});
-
-			zb_pages->loopPages([this, &used](u32 i)
-			{
-				u32 row = i >> 5;
-				u32 col = 1 << (i & 31);
+			};
 
-				if ((m_fzb_cur_pages[row] & col) == 0)
-				{
-					m_fzb_cur_pages[row] |= col;
-
-					used |= m_fzb_pages[i];
-				}
-			});
+			fb_pages->loopPages(checkNewPage);
+			zb_pages->loopPages(checkNewPage);
 
 			if (!synced)
 			{
@@ -852,9 +1035,9 @@ bool GSRendererSW::CheckTargetPages(const GSOffset::PageLooper* fb_pages, const
 			// chross-check frame and z-buffer pages, they cannot overlap with eachother and with previous batches in queue,
 			// have to be careful when the two buffers are mutually enabled/disabled and alternating (Bully FBP/ZBP = 0x2300)
 
-			if (fb && !res)
+			if (fb)
 			{
-				fb_pages->loopPagesWithBreak([this, &res](u32 page)
+				fb_pages->loopPages([this, &res, conflicts](u32 page)
 				{
 					if (m_fzb_pages[page] & 0xffff0000)
 					{
@@ -864,17 +1047,15 @@ bool GSRendererSW::CheckTargetPages(const GSOffset::PageLooper* fb_pages, const
 							fflush(s_fp);
 						}
 
+						conflicts[page >> 5] |= 1 << (page & 31);
 						res = true;
-						return false;
 					}
-
-					return true;
 				});
 			}
 
-			if (zb && !res)
+			if (zb)
 			{
-				zb_pages->loopPagesWithBreak([this, &res](u32 page)
+				zb_pages->loopPages([this, &res, conflicts](u32 page)
 				{
 					if (m_fzb_pages[page] & 0x0000ffff)
 					{
@@ -884,11 +1065,9 @@ bool GSRendererSW::CheckTargetPages(const GSOffset::PageLooper* fb_pages, const
 							fflush(s_fp);
 						}
 
+						conflicts[page >> 5] |= 1 << (page & 31);
 						res = true;
-						return false;
 					}
-
-					return true;
 				});
 			}
 		}
@@ -1427,7 +1606,6 @@ GSRendererSW::SharedData::SharedData()
 	: m_fpsm(0)
 	, m_zpsm(0)
 	, m_using_pages(false)
-	, m_syncpoint(SyncNone)
 {
 	m_tex[0].t = NULL;
 
@@ -1534,7 +1712,7 @@ void GSRendererSW::SharedData::UpdateSource()
 {
 	for (size_t i = 0; m_tex[i].t; i++)
 	{
-		if (m_tex[i].t->Update(m_tex[i].r))
+		if (m_tex[i].t->Update(m_tex[i].r, GSRendererSW::GetInstance()->m_tc.get()))
 		{
 			global.tex[i] = m_tex[i].t->m_buff;
 		}
@@ -28,12 +28,6 @@ public:
 		int m_zpsm;
 		bool m_using_pages;
 		TextureLevel m_tex[7 + 1]; // NULL terminated
-		enum
-		{
-			SyncNone,
-			SyncSource,
-			SyncTarget
-		} m_syncpoint;
 
 	public:
 		SharedData();
@@ -47,6 +41,23 @@ public:
 	};
 
 protected:
+	// Reasons for the GS thread having to wait on queued draws.
+	enum StallReason
+	{
+		StallTarget, // target pages are in use by queued draws as something else
+		StallSource, // texture pages are being drawn to
+		StallTransferWrite, // transfer to pages in use
+		StallTransferRead, // transfer or readback from pages being drawn to
+		StallSync, // full sync, for output, dumps and resets
+		StallReasonCount
+	};
+
+	struct StallStats
+	{
+		u64 count[StallReasonCount];
+		u64 ticks[StallReasonCount];
+	};
+
 	std::unique_ptr<IRasterizer> m_rl;
 	std::unique_ptr<GSTextureCacheSW> m_tc;
 	GSRingHeap m_vertex_heap;
@@ -57,8 +68,11 @@ protected:
 	u32 m_fzb_cur_pages[16];
 	std::atomic<u32> m_fzb_pages[512]; // u16 frame/zbuf pages interleaved
 	std::atomic<u16> m_tex_pages[512];
+	std::atomic<bool> m_page_waiting{false};
+	Threading::KernelSemaphore m_page_released;
 	GIFRegDIMX m_last_dimx = {};
 	GSVector4i m_dimx[8] = {};
+	StallStats m_stalls = {};
 
 	void Reset(bool hardware_reset) override;
 	void VSync(u32 field, bool registers_written, bool idle_frame) override;
@@ -66,15 +80,24 @@ protected:
 	GSTexture* GetFeedbackOutput(float& scale) override;
 
 	void Draw() override;
+	void BinPrimitives(SharedData* sd, const GSVector4i& r);
 	void Queue(GSRingHeap::SharedPtr<GSRasterizerData>& item);
 	void Sync(int reason);
+	/// Waits for the queued draws using the pages to finish, not just until they have been picked up by the workers.
+	/// Target use always blocks, \p textures also blocks on draws sampling the pages.
+	void WaitForPages(const GSOffset::PageLooper& pages, bool textures, StallReason reason);
+	void WaitForPages(const u32* pages, bool textures, StallReason reason);
+	void WaitForPage(u32 page, bool textures, u64& start);
+	void LogStallStats();
 	void InvalidateVideoMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r) override;
 	void InvalidateLocalMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r, bool clut = false) override;
 
 	void UsePages(const GSOffset::PageLooper& pages, const int type);
 	void ReleasePages(const GSOffset::PageLooper& pages, const int type);
 
-	bool CheckTargetPages(const GSOffset::PageLooper* fb_pages, const GSOffset::PageLooper* zb_pages, const GSVector4i& r);
+	/// Returns true if the target pages are in use by queued draws in a way which requires waiting for them, and the
+	/// conflicting pages in a 512 bit mask.
+	bool CheckTargetPages(const GSOffset::PageLooper* fb_pages, const GSOffset::PageLooper* zb_pages, const GSVector4i& r, u32* conflicts);
 	bool CheckSourcePages(SharedData* sd);
 
 	bool GetScanlineGlobalData(SharedData* data);
@@ -7,10 +7,31 @@
 #include "GS/GSPng.h"
 #include "GS/GSUtil.h"
 
-GSTextureCacheSW::GSTextureCacheSW() = default;
+#include "common/Console.h"
+#include "common/StringUtil.h"
+
+#include <bit>
+
+GSTextureCacheSW::GSTextureCacheSW(int threads)
+{
+	// The GS thread decodes too, and is otherwise just waiting.
+	for (int i = 0; i < threads; i++)
+		m_decode_workers.push_back(std::make_unique<DecodeWorker>());
+
+	for (int i = 0; i < threads; i++)
+		m_decode_workers[i]->thread = std::thread(&GSTextureCacheSW::DecodeWorkerThread, this, i);
+}
 
 GSTextureCacheSW::~GSTextureCacheSW()
 {
+	m_decode_exit = true;
+
+	for (const std::unique_ptr<DecodeWorker>& worker : m_decode_workers)
+	{
+		worker->sema.NotifyOfWork();
+		worker->thread.join();
+	}
+
 	RemoveAll();
 }
 
@@ -99,6 +120,96 @@ void GSTextureCacheSW::RemoveAll()
 	}
 }
 
+void GSTextureCacheSW::Decode(GSLocalMemory::readTextureBlock rtxbP, int pitch, const GIFRegTEXA& TEXA, u32 pages)
+{
+	const u32 count = static_cast<u32>(m_decode_blocks.size());
+
+	m_decode_stats.pages += pages;
+	m_decode_stats.updates++;
+	g_perfmon.Put(GSPerfMon::TextureDecodePages, pages);
+
+	if (m_decode_workers.empty() || count < MIN_THREADED_DECODE_BLOCKS)
+	{
+		const GSLocalMemory& mem = g_gs_renderer->m_mem;
+
+		for (const DecodeBlock& b : m_decode_blocks)
+			rtxbP(mem, b.block, b.dst, pitch, TEXA);
+
+		return;
+	}
+
+	m_decode_stats.threaded_pages += pages;
+	m_decode_stats.threaded_updates++;
+
+	m_decode_rtxbP = rtxbP;
+	m_decode_pitch = pitch;
+	m_decode_TEXA = &TEXA;
+	m_decode_next.store(0, std::memory_order_relaxed);
+
+	// Don't wake up more helpers than there are chunks to go around.
+	const u32 chunks = (count + DECODE_CHUNK_BLOCKS - 1) / DECODE_CHUNK_BLOCKS;
+	const u32 helpers = std::min<u32>(static_cast<u32>(m_decode_workers.size()), chunks - 1);
+
+	for (u32 i = 0; i < helpers; i++)
+		m_decode_workers[i]->sema.NotifyOfWork();
+
+	DecodeChunks();
+
+	// The texture has to be complete before the draw is queued.
+	for (u32 i = 0; i < helpers; i++)
+		m_decode_workers[i]->sema.WaitForEmptyWithSpin();
+}
+
+void GSTextureCacheSW::DecodeChunks()
+{
+	const GSLocalMemory& mem = g_gs_renderer->m_mem;
+	const GSLocalMemory::readTextureBlock rtxbP = m_decode_rtxbP;
+	const int pitch = m_decode_pitch;
+	const GIFRegTEXA& TEXA = *m_decode_TEXA;
+	const u32 count = static_cast<u32>(m_decode_blocks.size());
+
+	for (;;)
+	{
+		const u32 start = m_decode_next.fetch_add(DECODE_CHUNK_BLOCKS, std::memory_order_relaxed);
+		if (start >= count)
+			break;
+
+		const u32 end = std::min(start + DECODE_CHUNK_BLOCKS, count);
+		for (u32 i = start; i < end; i++)
+			rtxbP(mem, m_decode_blocks[i].block, m_decode_blocks[i].dst, pitch, TEXA);
+	}
+}
+
+void GSTextureCacheSW::DecodeWorkerThread(int i)
+{
+	Threading::SetNameOfCurrentThread(StringUtil::StdStringFromFormat("GS-SW-TEX-%d", i).c_str());
+
+	DecodeWorker& worker = *m_decode_workers[i];
+
+	while (true)
+	{
+		worker.sema.WaitForWorkWithSpin();
+		if (m_decode_exit)
+			break;
+
+		DecodeChunks();
+	}
+}
+
+void GSTextureCacheSW::LogStats()
+{
+	const DecodeStats& stats = m_decode_stats;
+	if (stats.updates > 0)
+	{
+		Console.WriteLn("GS SW: Decoded %llu texture pages in %llu updates, %llu pages in %llu updates on %zu helper threads.",
+			static_cast<unsigned long long>(stats.pages), static_cast<unsigned long long>(stats.updates),
+			static_cast<unsigned long long>(stats.threaded_pages), static_cast<unsigned long long>(stats.threaded_updates),
+			m_decode_workers.size());
+	}
+
+	m_decode_stats = {};
+}
+
 void GSTextureCacheSW::IncAge()
 {
 	for (auto i = m_textures.begin(); i != m_textures.end();)
@@ -197,7 +308,7 @@ void GSTextureCacheSW::Texture::Reset(u32 tw0, const GIFRegTEX0& TEX0, const GIF
 	}
 }
 
-bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect)
+bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect, GSTextureCacheSW* tc)
 {
 	if (m_complete)
 	{
@@ -244,6 +355,13 @@ bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect)
 
 	GSLocalMemory::readTextureBlock rtxbP = psm.rtxbP;
 
+	// With a cache, find the invalid blocks first, then decode them, potentially in parallel.
+	// Without one (HW renderer software textures) decode them as they're found.
+	if (tc)
+		tc->m_decode_blocks.clear();
+
+	u32 pages[MAX_PAGES / 32] = {};
+
 	u32 pitch = (1 << m_tw) << shift;
 
 	u8* dst = (u8*)m_buff + pitch * r.top;
@@ -272,7 +390,12 @@ bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect)
 				{
 					m_valid[row] |= col;
 
-					rtxbP(mem, block, &dst[bn.blkX() << shift], pitch, m_TEXA);
+					if (tc)
+						tc->m_decode_blocks.push_back({block, &dst[bn.blkX() << shift]});
+					else
+						rtxbP(mem, block, &dst[bn.blkX() << shift], pitch, m_TEXA);
+
+					pages[block >> 10] |= 1u << ((block >> 5) & 31);
 
 					blocks++;
 				}
@@ -294,7 +417,12 @@ bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect)
 				{
 					m_valid[row] |= col;
 
-					rtxbP(mem, block, &dst[bn.blkX() << shift], pitch, m_TEXA);
+					if (tc)
+						tc->m_decode_blocks.push_back({block, &dst[bn.blkX() << shift]});
+					else
+						rtxbP(mem, block, &dst[bn.blkX() << shift], pitch, m_TEXA);
+
+					pages[block >> 10] |= 1u << ((block >> 5) & 31);
 
 					blocks++;
 				}
@@ -304,6 +432,15 @@ bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect)
 
 	if (blocks > 0)
 	{
+		if (tc)
+		{
+			u32 page_count = 0;
+			for (u32 mask : pages)
+				page_count += std::popcount(mask);
+
+			tc->Decode(rtxbP, pitch, m_TEXA, page_count);
+		}
+
 		g_perfmon.Put(GSPerfMon::Unswizzle, bs.x * bs.y * blocks << shift);
 	}
 
@@ -5,6 +5,11 @@
 
 #include "GS/Renderers/Common/GSRenderer.h"
 #include "GS/Renderers/Common/GSFastList.h"
+
+#include "common/Threading.h"
+
+#include <atomic>
+#include <thread>
 #include <unordered_set>
 
 class GSTextureCacheSW
@@ -36,16 +41,57 @@ public:
 
 		void Reset(u32 tw0, const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA);
 
-		bool Update(const GSVector4i& r);
+		/// Decodes the invalid blocks in r, on tc's helper threads if given.
+		bool Update(const GSVector4i& r, GSTextureCacheSW* tc = nullptr);
 		bool Save(const std::string& fn) const;
 	};
 
 protected:
+	// Smaller updates aren't worth waking up the helper threads for.
+	static constexpr u32 MIN_THREADED_DECODE_BLOCKS = 4 * 32;
+
+	// Helpers claim a page worth of blocks at a time.
+	static constexpr u32 DECODE_CHUNK_BLOCKS = 32;
+
+	struct DecodeBlock
+	{
+		u32 block;
+		u8* dst;
+	};
+
+	struct DecodeWorker
+	{
+		std::thread thread;
+		Threading::WorkSema sema;
+	};
+
+	struct DecodeStats
+	{
+		u64 pages;
+		u64 threaded_pages;
+		u64 updates;
+		u64 threaded_updates;
+	};
+
 	std::unordered_set<Texture*> m_textures;
 	std::array<FastList<Texture*>, MAX_PAGES> m_map;
 
+	std::vector<std::unique_ptr<DecodeWorker>> m_decode_workers;
+	std::vector<DecodeBlock> m_decode_blocks;
+	GSLocalMemory::readTextureBlock m_decode_rtxbP = nullptr;
+	int m_decode_pitch = 0;
+	const GIFRegTEXA* m_decode_TEXA = nullptr;
+	std::atomic<u32> m_decode_next{0};
+	bool m_decode_exit = false;
+	DecodeStats m_decode_stats = {};
+
+	/// Decodes the queued blocks, on the helper threads as well if there are enough of them.
+	void Decode(GSLocalMemory::readTextureBlock rtxbP, int pitch, const GIFRegTEXA& TEXA, u32 pages);
+	void DecodeChunks();
+	void DecodeWorkerThread(int i);
+
 public:
-	GSTextureCacheSW();
+	GSTextureCacheSW(int threads);
 	virtual ~GSTextureCacheSW();
 
 	Texture* Lookup(const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA, u32 tw0 = 0);
@@ -54,4 +100,6 @@ public:
 
 	void RemoveAll();
 	void IncAge();
+
+	void LogStats();
 };
@@ -253,12 +253,27 @@ __ri void ImGuiManager::DrawPerformanceOverlay(float& position_y, float scale, f
 				DRAW_LINE(fixed_font, text.c_str(), IM_COL32(255, 255, 255, 255));
 			}
 
+			for (u32 vu = 0; vu < 2; vu++)
+			{
+				const u32 resets = PerformanceMetrics::GetVUCacheResets(vu);
+				const u32 evictions = PerformanceMetrics::GetVUCacheEvictions(vu);
+				if (resets == 0 && evictions == 0)
+					continue;
+
+				text.clear();
+				text.append_format("VU{} Cache: {} resets, {} evictions ({} programs)", vu, resets, evictions,
+					PerformanceMetrics::GetVUCacheEvictedPrograms(vu));
+				DRAW_LINE(fixed_font, text.c_str(), IM_COL32(255, 255, 255, 255));
+			}
+
 			const u32 gs_sw_threads = PerformanceMetrics::GetGSSWThreadCount();
 			for (u32 i = 0; i < gs_sw_threads; i++)
 			{
 				text.clear();
 				text.append_format("SW-{}: ", i);
 				FormatProcessorStat(text, PerformanceMetrics::GetGSSWThreadUsage(i), PerformanceMetrics::GetGSSWThreadAverageTime(i));
+				text.append_format(" | {:.0f}% busy, {:.0f}% stolen", PerformanceMetrics::GetGSSWThreadBusy(i),
+					PerformanceMetrics::GetGSSWThreadStolen(i));
 				DRAW_LINE(fixed_font, text.c_str(), IM_COL32(255, 255, 255, 255));
 			}
 
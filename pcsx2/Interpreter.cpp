@@ -24,6 +24,10 @@ static bool intExitExecution = false;
 static fastjmp_buf intJmpBuf;
 static u32 intLastBranchTo;
 
+// Set while interpreting for the recompiler, and once a taken branch has charged the cycles of the run.
+static bool intForRecompiler = false;
+static bool intBranchUpdatedCycles = false;
+
 static void intEventTest();
 
 void intUpdateCPUCycles()
@@ -263,6 +267,7 @@ static void doBranch( u32 target )
 {
 	_doBranch_shared( target );
 	intUpdateCPUCycles();
+	intBranchUpdatedCycles = true;
 	intEventTest();
 }
 
@@ -271,9 +276,10 @@ void intDoBranch(u32 target)
 	//Console.WriteLn("Interpreter Branch ");
 	_doBranch_shared( target );
 
-	if( Cpu == &intCpu )
+	if( Cpu == &intCpu || intForRecompiler )
 	{
 		intUpdateCPUCycles();
+		intBranchUpdatedCycles = true;
 		intEventTest();
 	}
 }
@@ -657,6 +663,49 @@ static void intStep()
 	execI();
 }
 
+// Interprets code on behalf of the recompiler, for blocks it hasn't compiled yet. Runs until a branch is taken
+// (or an exception is raised), or max_insts instructions have been executed.
+u32 intExecuteForRecompiler(u32 max_insts)
+{
+	// Static, since locals aren't preserved when an instruction is cancelled.
+	static u32 executed;
+	executed = 0;
+	intForRecompiler = true;
+
+	// Cancelled instructions come back here, with the pc already past them.
+	fastjmp_set(&intJmpBuf);
+
+	while (executed < max_insts)
+	{
+		const u32 pc = cpuRegs.pc;
+		intBranchUpdatedCycles = false;
+		execI();
+		executed++;
+
+		if (cpuRegs.pc != pc + 4)
+			break;
+	}
+
+	// Taken branches have already charged the cycles, anything else (likely branches which weren't taken,
+	// exceptions, cancels, or running out of instructions) hasn't.
+	if (!intBranchUpdatedCycles)
+		intUpdateCPUCycles();
+
+	intForRecompiler = false;
+	return executed;
+}
+
+void intCancelForRecompiler()
+{
+	fastjmp_jmp(&intJmpBuf, 0);
+}
+
+void intAbortForRecompiler()
+{
+	intForRecompiler = false;
+	intBranchUpdatedCycles = false;
+}
+
 static void intClear(u32 Addr, u32 Size)
 {
 }
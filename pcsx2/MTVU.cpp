@@ -2,11 +2,14 @@
 // SPDX-License-Identifier: GPL-3.0+
 
 #include "Common.h"
+#include "Counters.h"
 #include "Gif_Unit.h"
 #include "MTVU.h"
 #include "VMManager.h"
 #include "Vif_Dynarec.h"
 
+#include "common/Timer.h"
+
 #include <thread>
 
 VU_Thread vu1Thread;
@@ -14,9 +17,28 @@ VU_Thread vu1Thread;
 #define MTVU_ALWAYS_KICK 0
 #define MTVU_SYNC_MODE 0
 
+// Longest either thread spins waiting for the other before going to sleep
+static constexpr u32 MTVU_MAX_SPIN_NS = 50000;
+
+// Bounds for batching writes before waking the VU thread (in words)
+static constexpr u32 MTVU_MIN_KICK_BATCH = _1kb / sizeof(u32);
+static constexpr u32 MTVU_MAX_KICK_BATCH = _256kb / sizeof(u32);
+
 // Rounds up a size in bytes for size in u32's
 static __fi u32 size_u32(u32 x) { return (x + 3) >> 2; }
 
+// Spinning before sleeping saves the wakeup latency when the other thread is about to be done, but wastes
+// CPU time when it isn't. Spin for about twice the recent average wait, unless waits are long enough that
+// the wakeup latency doesn't matter.
+static u32 UpdateSpinTime(u32* wait_avg_ns, u64 wait_ticks)
+{
+	const u64 wait_ns = std::min<u64>(static_cast<u64>(Common::Timer::ConvertValueToNanoseconds(wait_ticks)), 100000000);
+	*wait_avg_ns = static_cast<u32>((static_cast<u64>(*wait_avg_ns) * 7 + wait_ns) / 8);
+	if (*wait_avg_ns > MTVU_MAX_SPIN_NS * 4)
+		return 0;
+	return std::min(*wait_avg_ns * 2, MTVU_MAX_SPIN_NS);
+}
+
 enum MTVU_EVENT
 {
 	MTVU_VU_EXECUTE,     // Execute VU program
@@ -113,11 +135,21 @@ void VU_Thread::Close()
 
 void VU_Thread::Reset()
 {
+	LogStats();
+
 	vuCycleIdx = 0;
 	m_ato_write_pos = 0;
 	m_write_pos = 0;
 	m_ato_read_pos = 0;
 	m_read_pos = 0;
+	m_pending_kick = 0;
+	m_kick_batch = MTVU_MIN_KICK_BATCH * 4;
+	m_ee_spin_ns = 0;
+	m_ee_wait_avg_ns = 0;
+	m_vu_spin_ns = 0;
+	m_vu_wait_avg_ns = 0;
+	m_vu_idle_ticks.store(0, std::memory_order_relaxed);
+	std::memset(&m_stats, 0, sizeof(m_stats));
 	std::memset(&vif, 0, sizeof(vif));
 	std::memset(&vifRegs, 0, sizeof(vifRegs));
 	for (size_t i = 0; i < 4; ++i)
@@ -131,7 +163,12 @@ void VU_Thread::ExecuteRingBuffer()
 
 	for (;;)
 	{
-		semaEvent.WaitForWork();
+		const u64 wait_start = Common::Timer::GetCurrentValue();
+		semaEvent.WaitForWorkWithSpin(m_vu_spin_ns);
+		const u64 wait_ticks = Common::Timer::GetCurrentValue() - wait_start;
+		m_vu_idle_ticks.store(m_vu_idle_ticks.load(std::memory_order_relaxed) + wait_ticks, std::memory_order_relaxed);
+		m_vu_spin_ns = UpdateSpinTime(&m_vu_wait_avg_ns, wait_ticks);
+
 		if (m_shutdown_flag.load(std::memory_order_acquire))
 			break;
 
@@ -211,6 +248,7 @@ void VU_Thread::ExecuteRingBuffer()
 // Should only be called by ReserveSpace()
 __ri void VU_Thread::WaitOnSize(s32 size)
 {
+	u64 wait_start = 0;
 	for (;;)
 	{
 		s32 readPos = GetReadPos();
@@ -223,6 +261,8 @@ __ri void VU_Thread::WaitOnSize(s32 size)
 		// Note: a wait lock instead of a yield also helps to avoid the bug.
 		if (readPos > m_write_pos + size + _4kb)
 			break; // Enough free front space
+		if (wait_start == 0)
+			wait_start = Common::Timer::GetCurrentValue();
 		{          // Let MTVU run to free up buffer space
 			KickStart();
 			// Locking might trigger a full flush of the ring buffer. Yield
@@ -232,6 +272,9 @@ __ri void VU_Thread::WaitOnSize(s32 size)
 			std::this_thread::yield();
 		}
 	}
+
+	if (wait_start != 0)
+		AddEEStall(Common::Timer::GetCurrentValue() - wait_start);
 }
 
 // Makes sure theres enough room in the ring buffer
@@ -277,6 +320,11 @@ __fi void VU_Thread::CommitWritePos()
 {
 	m_ato_write_pos.store(m_write_pos, std::memory_order_release);
 
+	const u32 occupancy = static_cast<u32>(m_write_pos - m_ato_read_pos.load(std::memory_order_relaxed)) & (buffer_size - 1);
+	m_stats.commits++;
+	m_stats.occupancy_sum += occupancy;
+	m_stats.max_occupancy = std::max(m_stats.max_occupancy, occupancy);
+
 	if (MTVU_ALWAYS_KICK)
 		KickStart();
 	if (MTVU_SYNC_MODE)
@@ -424,9 +472,68 @@ void VU_Thread::Get_MTVUChanges()
 
 void VU_Thread::KickStart()
 {
+	m_pending_kick = 0;
+	m_stats.kicks++;
 	semaEvent.NotifyOfWork();
 }
 
+// Data and register writes are only of use to the VU thread once it runs a program, so rather than waking
+// it for each of them, they're batched until the next ExecuteVU() or WaitVU(), or until there's enough to
+// be worth starting on. The batch size grows while that works out, and shrinks when the EE ends up waiting
+// for work the VU thread could have done in the meantime.
+__fi void VU_Thread::CommitBatched()
+{
+	const u32 size = static_cast<u32>(m_write_pos - m_ato_write_pos.load(std::memory_order_relaxed)) & (buffer_size - 1);
+	CommitWritePos();
+	m_pending_kick += size;
+	if (m_pending_kick >= m_kick_batch)
+		KickStart();
+}
+
+void VU_Thread::UpdateFrameStats()
+{
+	if (m_stats.frame == g_FrameCount)
+		return;
+
+	const u64 vu_idle = m_vu_idle_ticks.load(std::memory_order_relaxed);
+	if (m_stats.frame != 0)
+	{
+		m_stats.frames++;
+		m_stats.max_frame_ee_stall_ticks = std::max(m_stats.max_frame_ee_stall_ticks, m_stats.frame_ee_stall_ticks);
+		m_stats.max_frame_vu_idle_ticks = std::max(m_stats.max_frame_vu_idle_ticks, vu_idle - m_stats.frame_vu_idle_start);
+		m_stats.vu_idle_ticks += vu_idle - m_stats.frame_vu_idle_start;
+	}
+
+	m_stats.frame = g_FrameCount;
+	m_stats.frame_ee_stall_ticks = 0;
+	m_stats.frame_vu_idle_start = vu_idle;
+}
+
+__fi void VU_Thread::AddEEStall(u64 ticks)
+{
+	m_stats.ee_stall_ticks += ticks;
+	m_stats.frame_ee_stall_ticks += ticks;
+}
+
+void VU_Thread::LogStats()
+{
+	if (m_stats.frames == 0)
+		return;
+
+	const double frames = static_cast<double>(m_stats.frames);
+	DevCon.WriteLn("MTVU: %u frames, EE stalled %.3f ms/frame (max %.3f), VU idle %.3f ms/frame (max %.3f)",
+		m_stats.frames, Common::Timer::ConvertValueToMilliseconds(m_stats.ee_stall_ticks) / frames,
+		Common::Timer::ConvertValueToMilliseconds(m_stats.max_frame_ee_stall_ticks),
+		Common::Timer::ConvertValueToMilliseconds(m_stats.vu_idle_ticks) / frames,
+		Common::Timer::ConvertValueToMilliseconds(m_stats.max_frame_vu_idle_ticks));
+	DevCon.WriteLn("MTVU: ring %.2f%% full on average (max %.2f%%), %llu commits, %llu kicks (%llu late), "
+				   "batch %u words, spin EE %u ns / VU %u ns",
+		m_stats.commits ? (static_cast<double>(m_stats.occupancy_sum) / m_stats.commits) * 100.0 / buffer_size : 0.0,
+		static_cast<double>(m_stats.max_occupancy) * 100.0 / buffer_size, static_cast<unsigned long long>(m_stats.commits),
+		static_cast<unsigned long long>(m_stats.kicks), static_cast<unsigned long long>(m_stats.late_kicks),
+		m_kick_batch, m_ee_spin_ns, m_vu_spin_ns);
+}
+
 bool VU_Thread::IsDone()
 {
 	return GetReadPos() == GetWritePos();
@@ -435,7 +542,24 @@ bool VU_Thread::IsDone()
 void VU_Thread::WaitVU()
 {
 	MTVU_LOG("MTVU - WaitVU!");
-	semaEvent.WaitForEmpty();
+	if (m_pending_kick > 0)
+	{
+		m_stats.late_kicks++;
+		m_kick_batch = std::max(m_kick_batch / 2, MTVU_MIN_KICK_BATCH);
+		KickStart();
+	}
+
+	if (IsDone())
+	{
+		semaEvent.WaitForEmpty();
+		return;
+	}
+
+	const u64 wait_start = Common::Timer::GetCurrentValue();
+	semaEvent.WaitForEmptyWithSpin(m_ee_spin_ns);
+	const u64 wait_ticks = Common::Timer::GetCurrentValue() - wait_start;
+	AddEEStall(wait_ticks);
+	m_ee_spin_ns = UpdateSpinTime(&m_ee_wait_avg_ns, wait_ticks);
 }
 
 void VU_Thread::ExecuteVU(u32 vu_addr, u32 vif_top, u32 vif_itop, u32 fbrst)
@@ -450,7 +574,10 @@ void VU_Thread::ExecuteVU(u32 vu_addr, u32 vif_top, u32 vif_itop, u32 fbrst)
 	Write(fbrst);
 	CommitWritePos();
 	gifUnit.TransferGSPacketData(GIF_TRANS_MTVU, NULL, 0);
+	if (m_pending_kick > 0)
+		m_kick_batch = std::min(m_kick_batch + MTVU_MIN_KICK_BATCH, MTVU_MAX_KICK_BATCH);
 	KickStart();
+	UpdateFrameStats();
 	u32 cycles = std::max(Get_vuCycles(), 4u);
 	u32 skip_cycles = std::min(cycles, 3000u);
 	cpuRegs.cycle += skip_cycles * EmuConfig.Speedhacks.EECycleSkip;
@@ -474,8 +601,7 @@ void VU_Thread::VifUnpack(vifStruct& _vif, VIFregisters& _vifRegs, const u8* dat
 	WriteRegs(&_vifRegs);
 	Write(size);
 	Write(data, size);
-	CommitWritePos();
-	KickStart();
+	CommitBatched();
 }
 
 void VU_Thread::WriteMicroMem(u32 vu_micro_addr, const void* data, u32 size)
@@ -486,8 +612,7 @@ void VU_Thread::WriteMicroMem(u32 vu_micro_addr, const void* data, u32 size)
 	Write(vu_micro_addr);
 	Write(size);
 	Write(data, size);
-	CommitWritePos();
-	KickStart();
+	CommitBatched();
 }
 
 void VU_Thread::WriteDataMem(u32 vu_data_addr, const void* data, u32 size)
@@ -498,8 +623,7 @@ void VU_Thread::WriteDataMem(u32 vu_data_addr, const void* data, u32 size)
 	Write(vu_data_addr);
 	Write(size);
 	Write(data, size);
-	CommitWritePos();
-	KickStart();
+	CommitBatched();
 }
 
 void VU_Thread::WriteVIRegs(REG_VI* viRegs)
@@ -508,8 +632,7 @@ void VU_Thread::WriteVIRegs(REG_VI* viRegs)
 	ReserveSpace(1 + size_u32(32));
 	Write(MTVU_VU_WRITE_VIREGS);
 	Write(viRegs, size_u32(32));
-	CommitWritePos();
-	KickStart();
+	CommitBatched();
 }
 
 void VU_Thread::WriteVFRegs(VECTOR* vfRegs)
@@ -518,8 +641,7 @@ void VU_Thread::WriteVFRegs(VECTOR* vfRegs)
 	ReserveSpace(1 + size_u32(32*4));
 	Write(MTVU_VU_WRITE_VFREGS);
 	Write(vfRegs, size_u32(32*4));
-	CommitWritePos();
-	KickStart();
+	CommitBatched();
 }
 
 void VU_Thread::WriteCol(vifStruct& _vif)
@@ -528,8 +650,7 @@ void VU_Thread::WriteCol(vifStruct& _vif)
 	ReserveSpace(1 + size_u32(sizeof(_vif.MaskCol)));
 	Write(MTVU_VIF_WRITE_COL);
 	Write(&_vif.MaskCol, sizeof(_vif.MaskCol));
-	CommitWritePos();
-	KickStart();
+	CommitBatched();
 }
 
 void VU_Thread::WriteRow(vifStruct& _vif)
@@ -538,6 +659,5 @@ void VU_Thread::WriteRow(vifStruct& _vif)
 	ReserveSpace(1 + size_u32(sizeof(_vif.MaskRow)));
 	Write(MTVU_VIF_WRITE_ROW);
 	Write(&_vif.MaskRow, sizeof(_vif.MaskRow));
-	CommitWritePos();
-	KickStart();
+	CommitBatched();
 }
@@ -24,10 +24,36 @@ class VU_Thread final {
 	alignas(__cachelinesize) std::atomic<int> m_ato_read_pos; // Only modified by VU thread
 	alignas(__cachelinesize) std::atomic<int> m_ato_write_pos;    // Only modified by EE thread
 	alignas(__cachelinesize) int  m_read_pos; // temporary read pos (local to the VU thread)
-	int  m_write_pos; // temporary write pos (local to the EE thread)
+	u32  m_vu_spin_ns; // how long the VU thread spins for work before sleeping (local to the VU thread)
+	u32  m_vu_wait_avg_ns; // moving average of the VU thread's waits for work (local to the VU thread)
+	std::atomic<u64> m_vu_idle_ticks; // total time the VU thread spent waiting for work
+	alignas(__cachelinesize) int  m_write_pos; // temporary write pos (local to the EE thread)
+	u32  m_pending_kick; // words committed since the VU thread was last kicked (local to the EE thread)
+	u32  m_kick_batch; // words to batch up before kicking the VU thread (local to the EE thread)
+	u32  m_ee_spin_ns; // how long WaitVU spins before sleeping (local to the EE thread)
+	u32  m_ee_wait_avg_ns; // moving average of WaitVU's waits (local to the EE thread)
 	Threading::WorkSema semaEvent;
 	std::atomic_bool m_shutdown_flag{false};
 
+	// Per-frame statistics, updated by the EE thread and logged on reset
+	struct Stats
+	{
+		u32 frames;
+		u32 frame; // g_FrameCount of the current frame
+		u64 ee_stall_ticks; // EE waiting on the VU thread, in WaitVU or for ring space
+		u64 max_frame_ee_stall_ticks;
+		u64 frame_ee_stall_ticks;
+		u64 vu_idle_ticks;
+		u64 max_frame_vu_idle_ticks;
+		u64 frame_vu_idle_start;
+		u64 commits;
+		u64 kicks;
+		u64 late_kicks; // batched work which had to be kicked by WaitVU
+		u64 occupancy_sum; // ring words in use, sampled on each commit
+		u32 max_occupancy;
+	};
+	Stats m_stats;
+
 	Threading::Thread m_thread;
 
 public:
@@ -101,6 +127,11 @@ private:
 	void WaitOnSize(s32 size);
 	void ReserveSpace(s32 size);
 
+	void CommitBatched();
+	void UpdateFrameStats();
+	void AddEEStall(u64 ticks);
+	void LogStats();
+
 	s32 GetReadPos();
 	s32 GetWritePos();
 
@@ -323,6 +323,7 @@ static constexpr const char* s_speed_hack_names[] = {
 	"instantVU1",
 	"mtvu",
 	"eeCycleRate",
+	"waitLoop",
 };
 
 const char* Pcsx2Config::SpeedhackOptions::GetSpeedHackName(SpeedHack id)
@@ -360,6 +361,9 @@ void Pcsx2Config::SpeedhackOptions::Set(SpeedHack id, int value)
 		case SpeedHack::EECycleRate:
 			EECycleRate = static_cast<int>(std::clamp<int>(value, MIN_EE_CYCLE_RATE, MAX_EE_CYCLE_RATE));
 			break;
+		case SpeedHack::WaitLoop:
+			WaitLoop = (value != 0);
+			break;
 			jNO_DEFAULT
 	}
 }
@@ -453,6 +457,16 @@ Pcsx2Config::RecompilerOptions::RecompilerOptions()
 	EnableVU1 = true;
 	EnableFastmem = true;
 	PauseOnTLBMiss = false;
+	EnableEECodeCache = false;
+	EnableEESuperblocks = false;
+	EnableEECrossBlockAnalysis = false;
+	EnableEEInterpreterTier = false;
+	EnableCodeEviction = false;
+	EnableEESubPageSMC = false;
+	EnableVUProgramCache = false;
+	EnableVUVexEncoding = true;
+	BenchmarkVUCodegen = false;
+	EnableVIFUnpackCache = false;
 
 	// vu and fpu clamping default to standard overflow.
 	vu0Overflow = true;
@@ -531,6 +545,16 @@ void Pcsx2Config::RecompilerOptions::LoadSave(SettingsWrapper& wrap)
 	SettingsWrapBitBool(EnableVU1);
 	SettingsWrapBitBool(EnableFastmem);
 	SettingsWrapBitBool(PauseOnTLBMiss);
+	SettingsWrapBitBool(EnableEECodeCache);
+	SettingsWrapBitBool(EnableEESuperblocks);
+	SettingsWrapBitBool(EnableEECrossBlockAnalysis);
+	SettingsWrapBitBool(EnableEEInterpreterTier);
+	SettingsWrapBitBool(EnableCodeEviction);
+	SettingsWrapBitBool(EnableEESubPageSMC);
+	SettingsWrapBitBool(EnableVUProgramCache);
+	SettingsWrapBitBool(EnableVUVexEncoding);
+	SettingsWrapBitBool(BenchmarkVUCodegen);
+	SettingsWrapBitBool(EnableVIFUnpackCache);
 
 	SettingsWrapBitBool(vu0Overflow);
 	SettingsWrapBitBool(vu0ExtraOverflow);
@@ -732,6 +756,7 @@ Pcsx2Config::GSOptions::GSOptions()
 	HWSpinCPUForReadbacks = false;
 	GPUPaletteConversion = false;
 	AutoFlushSW = true;
+	SWTileRasterization = false;
 	PreloadFrameWithGSData = false;
 	Mipmap = true;
 	HWMipmap = true;
@@ -942,6 +967,7 @@ void Pcsx2Config::GSOptions::LoadSave(SettingsWrapper& wrap)
 	SettingsWrapBitBool(HWSpinCPUForReadbacks);
 	SettingsWrapBitBoolEx(GPUPaletteConversion, "paltex");
 	SettingsWrapBitBoolEx(AutoFlushSW, "autoflush_sw");
+	SettingsWrapBitBoolEx(SWTileRasterization, "sw_tile_rasterization");
 	SettingsWrapBitBoolEx(PreloadFrameWithGSData, "preload_frame_with_gs_data");
 	SettingsWrapBitBoolEx(Mipmap, "mipmap");
 	SettingsWrapBitBoolEx(ManualUserHacks, "UserHacks");
@@ -1,6 +1,7 @@
 // SPDX-FileCopyrightText: 2002-2024 PCSX2 Dev Team
 // SPDX-License-Identifier: GPL-3.0+
 
+#include <atomic>
 #include <chrono>
 #include <vector>
 
@@ -63,6 +64,17 @@ struct GSSWThreadStats
 	u64 last_cpu_time = 0;
 	double usage = 0.0;
 	double time = 0.0;
+
+	// updated by the SW thread
+	std::atomic<u64> work_ticks{0};
+	std::atomic<u32> batches{0};
+	std::atomic<u32> stolen{0};
+
+	u64 last_work_ticks = 0;
+	u32 last_batches = 0;
+	u32 last_stolen = 0;
+	double busy = 0.0;
+	double stolen_pct = 0.0;
 };
 std::vector<GSSWThreadStats> s_gs_sw_threads;
 
@@ -71,6 +83,11 @@ static float s_accumulated_gpu_time = 0.0f;
 static float s_gpu_usage = 0.0f;
 static u32 s_presents_since_last_update = 0;
 
+// updated by the EE or VU thread, read by the GS thread
+static std::atomic<u32> s_vu_cache_resets[2] = {};
+static std::atomic<u32> s_vu_cache_evictions[2] = {};
+static std::atomic<u32> s_vu_cache_evicted_programs[2] = {};
+
 void PerformanceMetrics::Clear()
 {
 	Reset();
@@ -98,6 +115,13 @@ void PerformanceMetrics::Clear()
 
 	s_frame_time_history.fill(0.0f);
 	s_frame_time_history_pos = 0;
+
+	for (u32 vu = 0; vu < 2; vu++)
+	{
+		s_vu_cache_resets[vu].store(0, std::memory_order_relaxed);
+		s_vu_cache_evictions[vu].store(0, std::memory_order_relaxed);
+		s_vu_cache_evicted_programs[vu].store(0, std::memory_order_relaxed);
+	}
 }
 
 void PerformanceMetrics::Reset()
@@ -123,7 +147,12 @@ void PerformanceMetrics::Reset()
 	s_last_capture_time = GSCapture::IsCapturing() ? GSCapture::GetEncoderThreadHandle().GetCPUTime() : 0;
 
 	for (GSSWThreadStats& stat : s_gs_sw_threads)
+	{
 		stat.last_cpu_time = stat.handle.GetCPUTime();
+		stat.last_work_ticks = stat.work_ticks.load(std::memory_order_relaxed);
+		stat.last_batches = stat.batches.load(std::memory_order_relaxed);
+		stat.last_stolen = stat.stolen.load(std::memory_order_relaxed);
+	}
 }
 
 void PerformanceMetrics::Update(bool gs_register_write, bool fb_blit, bool is_skipping_present)
@@ -219,6 +248,17 @@ void PerformanceMetrics::Update(bool gs_register_write, bool fb_blit, bool is_sk
 		thread.last_cpu_time = time;
 		thread.usage = static_cast<double>(delta) * pct_divider;
 		thread.time = static_cast<double>(delta) * time_divider;
+
+		// Time spent drawing against the wall clock, unlike usage this doesn't include spinning while waiting for work.
+		const u64 work_ticks = thread.work_ticks.load(std::memory_order_relaxed);
+		const u32 batches = thread.batches.load(std::memory_order_relaxed);
+		const u32 stolen = thread.stolen.load(std::memory_order_relaxed);
+		const u32 batches_delta = batches - thread.last_batches;
+		thread.busy = std::min(static_cast<double>(work_ticks - thread.last_work_ticks) * 100.0 / static_cast<double>(ticks_diff), 100.0);
+		thread.stolen_pct = batches_delta ? (static_cast<double>(stolen - thread.last_stolen) * 100.0 / static_cast<double>(batches_delta)) : 0.0;
+		thread.last_work_ticks = work_ticks;
+		thread.last_batches = batches;
+		thread.last_stolen = stolen;
 	}
 
 	s_frames_since_last_update = 0;
@@ -242,8 +282,8 @@ void PerformanceMetrics::SetCPUThread(Threading::ThreadHandle thread)
 
 void PerformanceMetrics::SetGSSWThreadCount(u32 count)
 {
-	s_gs_sw_threads.clear();
-	s_gs_sw_threads.resize(count);
+	// Stats hold atomics, so can't be moved by resize().
+	s_gs_sw_threads = std::vector<GSSWThreadStats>(count);
 }
 
 void PerformanceMetrics::SetGSSWThread(u32 index, Threading::ThreadHandle thread)
@@ -252,6 +292,15 @@ void PerformanceMetrics::SetGSSWThread(u32 index, Threading::ThreadHandle thread
 	s_gs_sw_threads[index].handle = std::move(thread);
 }
 
+void PerformanceMetrics::AddGSSWThreadWork(u32 index, u64 ticks, u32 batches, u32 stolen)
+{
+	GSSWThreadStats& thread = s_gs_sw_threads[index];
+	thread.work_ticks.fetch_add(ticks, std::memory_order_relaxed);
+	thread.batches.fetch_add(batches, std::memory_order_relaxed);
+	if (stolen > 0)
+		thread.stolen.fetch_add(stolen, std::memory_order_relaxed);
+}
+
 u64 PerformanceMetrics::GetFrameNumber()
 {
 	return s_frame_number;
@@ -352,6 +401,16 @@ double PerformanceMetrics::GetGSSWThreadAverageTime(u32 index)
 	return s_gs_sw_threads[index].time;
 }
 
+double PerformanceMetrics::GetGSSWThreadBusy(u32 index)
+{
+	return s_gs_sw_threads[index].busy;
+}
+
+double PerformanceMetrics::GetGSSWThreadStolen(u32 index)
+{
+	return s_gs_sw_threads[index].stolen_pct;
+}
+
 float PerformanceMetrics::GetGPUUsage()
 {
 	return s_gpu_usage;
@@ -371,3 +430,29 @@ u32 PerformanceMetrics::GetFrameTimeHistoryPos()
 {
 	return s_frame_time_history_pos;
 }
+
+void PerformanceMetrics::AddVUCacheReset(u32 vu)
+{
+	s_vu_cache_resets[vu].fetch_add(1, std::memory_order_relaxed);
+}
+
+void PerformanceMetrics::AddVUCacheEviction(u32 vu, u32 programs)
+{
+	s_vu_cache_evictions[vu].fetch_add(1, std::memory_order_relaxed);
+	s_vu_cache_evicted_programs[vu].fetch_add(programs, std::memory_order_relaxed);
+}
+
+u32 PerformanceMetrics::GetVUCacheResets(u32 vu)
+{
+	return s_vu_cache_resets[vu].load(std::memory_order_relaxed);
+}
+
+u32 PerformanceMetrics::GetVUCacheEvictions(u32 vu)
+{
+	return s_vu_cache_evictions[vu].load(std::memory_order_relaxed);
+}
+
+u32 PerformanceMetrics::GetVUCacheEvictedPrograms(u32 vu)
+{
+	return s_vu_cache_evicted_programs[vu].load(std::memory_order_relaxed);
+}
@@ -30,6 +30,9 @@ namespace PerformanceMetrics
 	void SetGSSWThreadCount(u32 count);
 	void SetGSSWThread(u32 index, Threading::ThreadHandle thread);
 
+	/// Called by GS software threads after drawing a set of batches, some of which may have been stolen from other threads.
+	void AddGSSWThreadWork(u32 index, u64 ticks, u32 batches, u32 stolen);
+
 	u64 GetFrameNumber();
 
 	InternalFPSMethod GetInternalFPSMethod();
@@ -54,10 +57,19 @@ namespace PerformanceMetrics
 	u32 GetGSSWThreadCount();
 	double GetGSSWThreadUsage(u32 index);
 	double GetGSSWThreadAverageTime(u32 index);
+	double GetGSSWThreadBusy(u32 index);
+	double GetGSSWThreadStolen(u32 index);
 
 	float GetGPUUsage();
 	float GetGPUAverageTime();
 
+	/// microVU program cache events, counted over the whole session.
+	void AddVUCacheReset(u32 vu);
+	void AddVUCacheEviction(u32 vu, u32 programs);
+	u32 GetVUCacheResets(u32 vu);
+	u32 GetVUCacheEvictions(u32 vu);
+	u32 GetVUCacheEvictedPrograms(u32 vu);
+
 	const FrameTimeHistory& GetFrameTimeHistory();
 	u32 GetFrameTimeHistoryPos();
 } // namespace PerformanceMetrics
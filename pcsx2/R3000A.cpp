@@ -3,6 +3,7 @@
 
 #include "R3000A.h"
 #include "Common.h"
+#include "EventQueue.h"
 
 #include "SIO/Sio0.h"
 #include "Sif.h"
@@ -32,6 +33,9 @@ static constexpr uint iopWaitCycles = 384; // Keep inline with EE wait cycle max
 
 bool iopEventTestIsActive = false;
 
+// Pending cycle events of the IOP's devices, see _psxTestInterrupts().
+static EventQueue s_iop_events;
+
 alignas(16) psxRegisters psxRegs;
 
 void psxReset()
@@ -47,6 +51,10 @@ void psxReset()
 	psxRegs.iopCycleEECarry = 0;
 	psxRegs.iopNextEventCycle = psxRegs.cycle + 4;
 
+	s_iop_events.LogStats("IOP");
+	s_iop_events.ResetStats();
+	s_iop_events.Clear();
+
 	psxHwReset();
 	PSXCLK = 36864000;
 	ioman::reset();
@@ -134,6 +142,7 @@ __fi void PSX_INT( IopEventId n, s32 ecycle )
 
 	psxRegs.sCycle[n] = psxRegs.cycle;
 	psxRegs.eCycle[n] = ecycle;
+	s_iop_events.Schedule(n, psxRegs.cycle + ecycle);
 
 	psxSetNextBranchDelta(ecycle);
 	const float mutiplier = static_cast<float>(PS2CLK) / static_cast<float>(PSXCLK);
@@ -147,61 +156,108 @@ __fi void PSX_INT( IopEventId n, s32 ecycle )
 	}
 }
 
-static __fi void IopTestEvent( IopEventId n, void (*callback)() )
+// Events which are due in the same event test are dispatched in this order.
+struct IopEventHandler
 {
-	if( !(psxRegs.interrupt & (1 << n)) ) return;
+	IopEventId id;
+	void (*callback)();
+};
+
+static constexpr IopEventHandler s_iop_event_handlers[] = {
+	{IopEvt_SIF0, sif0Interrupt},
+	{IopEvt_SIF1, sif1Interrupt},
+	{IopEvt_SIF2, sif2Interrupt},
+	{IopEvt_SIO, []() { g_Sio0.Interrupt(Sio0Interrupt::TEST_EVENT); }},
+	{IopEvt_CdvdSectorReady, cdvdSectorReady},
+	{IopEvt_CdvdRead, cdvdReadInterrupt},
+	{IopEvt_Cdvd, cdvdActionInterrupt},
+	{IopEvt_Dma11, psxDMA11Interrupt}, // SIO2
+	{IopEvt_Dma12, psxDMA12Interrupt}, // SIO2
+	{IopEvt_Cdrom, cdrInterrupt},
+	{IopEvt_CdromRead, cdrReadInterrupt},
+	{IopEvt_DEV9, dev9Interrupt},
+	{IopEvt_USB, usbInterrupt},
+};
+
+void psxRescheduleEvents()
+{
+	s_iop_events.Clear();
 
-	if( psxTestCycle( psxRegs.sCycle[n], psxRegs.eCycle[n] ) )
+	for (const IopEventHandler& handler : s_iop_event_handlers)
 	{
-		psxRegs.interrupt &= ~(1 << n);
-		callback();
+		const IopEventId n = handler.id;
+		if (psxRegs.interrupt & (1u << n))
+			s_iop_events.Schedule(n, psxRegs.sCycle[n] + psxRegs.eCycle[n]);
 	}
-	else
-		psxSetNextBranch( psxRegs.sCycle[n], psxRegs.eCycle[n] );
 }
 
-static __fi void Sio0TestEvent(IopEventId n)
+// Removes the events which are due from the queue, and returns their mask.
+static __fi u32 psxPopDueEvents()
 {
-	if (!(psxRegs.interrupt & (1 << n)))
-	{
-		return;
-	}
+	EventQueue::ScopedOverhead overhead(s_iop_events);
 
-	if (psxTestCycle(psxRegs.sCycle[n], psxRegs.eCycle[n]))
+	u32 due = 0;
+	while (s_iop_events.HasDue(psxRegs.cycle))
 	{
-		psxRegs.interrupt &= ~(1 << n);
-		g_Sio0.Interrupt(Sio0Interrupt::TEST_EVENT);
-	}
-	else
-	{
-		psxSetNextBranch(psxRegs.sCycle[n], psxRegs.eCycle[n]);
+		const u32 n = s_iop_events.Pop();
+		if (!(psxRegs.interrupt & (1u << n)))
+		{
+			// Cleared directly by the device.
+			s_iop_events.AddStale();
+			continue;
+		}
+
+		if (!psxTestCycle(psxRegs.sCycle[n], psxRegs.eCycle[n]))
+		{
+			s_iop_events.Schedule(n, psxRegs.sCycle[n] + psxRegs.eCycle[n]);
+			s_iop_events.AddStale();
+			continue;
+		}
+
+		due |= 1u << n;
 	}
+
+	return due;
 }
 
 static __fi void _psxTestInterrupts()
 {
-	IopTestEvent(IopEvt_SIF0,		sif0Interrupt);	// SIF0
-	IopTestEvent(IopEvt_SIF1,		sif1Interrupt);	// SIF1
-	IopTestEvent(IopEvt_SIF2,		sif2Interrupt);	// SIF2
-	Sio0TestEvent(IopEvt_SIO);
-	IopTestEvent(IopEvt_CdvdSectorReady, cdvdSectorReady);
-	IopTestEvent(IopEvt_CdvdRead,	cdvdReadInterrupt);
-
-	// Profile-guided Optimization (sorta)
-	// The following ints are rarely called.  Encasing them in a conditional
-	// as follows helps speed up most games.
-
-	if( psxRegs.interrupt & ((1 << IopEvt_Cdvd) | (1 << IopEvt_Dma11) | (1 << IopEvt_Dma12)
-		| (1 << IopEvt_Cdrom) | (1 << IopEvt_CdromRead) | (1 << IopEvt_DEV9) | (1 << IopEvt_USB)))
+	s_iop_events.AddTest();
+
+	u32 due = psxPopDueEvents();
+	for (const IopEventHandler& handler : s_iop_event_handlers)
+	{
+		const IopEventId n = handler.id;
+		if (!(due & (1u << n)))
+			continue;
+		due &= ~(1u << n);
+
+		// An earlier handler may have stopped or restarted this event.
+		if (!(psxRegs.interrupt & (1u << n)))
+			continue;
+		if (!psxTestCycle(psxRegs.sCycle[n], psxRegs.eCycle[n]))
+		{
+			s_iop_events.Schedule(n, psxRegs.sCycle[n] + psxRegs.eCycle[n]);
+			continue;
+		}
+
+		psxRegs.interrupt &= ~(1 << n);
+		handler.callback();
+		s_iop_events.AddDispatched();
+
+		// Events raised by the handler which are already due run in this pass if they come later in the order.
+		due |= psxPopDueEvents();
+	}
+
+	// Events raised for slots which were already passed have been popped, put them back for the next test.
+	for (u32 n = 0; due != 0; n++, due >>= 1)
 	{
-		IopTestEvent(IopEvt_Cdvd,		cdvdActionInterrupt);
-		IopTestEvent(IopEvt_Dma11,		psxDMA11Interrupt);	// SIO2
-		IopTestEvent(IopEvt_Dma12,		psxDMA12Interrupt);	// SIO2
-		IopTestEvent(IopEvt_Cdrom,		cdrInterrupt);
-		IopTestEvent(IopEvt_CdromRead,	cdrReadInterrupt);
-		IopTestEvent(IopEvt_DEV9,		dev9Interrupt);
-		IopTestEvent(IopEvt_USB,		usbInterrupt);
+		if ((due & 1) && (psxRegs.interrupt & (1u << n)))
+			s_iop_events.Schedule(n, psxRegs.sCycle[n] + psxRegs.eCycle[n]);
 	}
+
+	if (!s_iop_events.IsEmpty())
+		psxSetNextBranch(s_iop_events.GetNextDue(), 0);
 }
 
 __ri void iopEventTest()
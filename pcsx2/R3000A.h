@@ -195,6 +195,7 @@ extern R3000Acpu psxRec;
 
 extern void psxReset();
 extern void psxException(u32 code, u32 step);
+extern void psxRescheduleEvents();
 extern void iopEventTest();
 
 int psxIsBreakpointNeeded(u32 addr);
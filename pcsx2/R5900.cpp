@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: GPL-3.0+
 
 #include "Common.h"
+#include "EventQueue.h"
 
 #include "common/StringUtil.h"
 #include "ps2/BiosTools.h"
@@ -45,6 +46,9 @@ static constexpr uint eeWaitCycles = 3072;
 bool eeEventTestIsActive = false;
 EE_intProcessStatus eeRunInterruptScan = INT_NOT_RUNNING;
 
+// Pending cycle events (DMA and other 'pcsx2 interrupts'), see _cpuTestInterrupts().
+static EventQueue s_ee_events;
+
 u32 g_eeloadMain = 0, g_eeloadExec = 0, g_osdsys_str = 0;
 
 /* I don't know how much space for args there is in the memory block used for args in full boot mode,
@@ -74,6 +78,10 @@ void cpuReset()
 	EEsCycle = 0;
 	EEoCycle = cpuRegs.cycle;
 
+	s_ee_events.LogStats("EE");
+	s_ee_events.ResetStats();
+	s_ee_events.Clear();
+
 	psxReset();
 	pgifInit();
 
@@ -242,17 +250,89 @@ __fi void cpuClearInt( uint i )
 	cpuRegs.dmastall &= ~(1 << i);
 }
 
-static __fi void TESTINT( u8 n, void (*callback)() )
+/* These are 'pcsx2 interrupts', they handle asynchronous stuff
+   that depends on the cycle timings. Events which are due in the same
+   event test are dispatched in this order. */
+struct EEEventHandler
+{
+	EE_EventType id;
+	void (*callback)();
+};
+
+static constexpr EEEventHandler s_ee_event_handlers[] = {
+	{VU_MTVU_BUSY, MTVUInterrupt},
+	{DMAC_VIF1, vif1Interrupt},
+	{DMAC_GIF, gifInterrupt},
+	{DMAC_SIF0, EEsif0Interrupt},
+	{DMAC_SIF1, EEsif1Interrupt},
+	{DMAC_VIF0, vif0Interrupt},
+	{DMAC_FROM_IPU, ipu0Interrupt},
+	{DMAC_TO_IPU, ipu1Interrupt},
+	{IPU_PROCESS, ipuCMDProcess},
+	{DMAC_FROM_SPR, SPRFROMinterrupt},
+	{DMAC_TO_SPR, SPRTOinterrupt},
+	{DMAC_MFIFO_VIF, vifMFIFOInterrupt},
+	{DMAC_MFIFO_GIF, gifMFIFOInterrupt},
+	{VIF_VU0_FINISH, vif0VUFinish},
+	{VIF_VU1_FINISH, vif1VUFinish},
+};
+
+static constexpr u32 GetEEEventMask()
+{
+	u32 mask = 0;
+	for (const EEEventHandler& handler : s_ee_event_handlers)
+		mask |= 1u << handler.id;
+	return mask;
+}
+
+// Only events with a handler are queued, the other interrupt bits are just flags.
+static constexpr u32 EE_QUEUED_EVENTS = GetEEEventMask();
+
+void cpuRescheduleEvents()
 {
-	if( !(cpuRegs.interrupt & (1 << n)) ) return;
+	s_ee_events.Clear();
 
-	if(CHECK_INSTANTDMAHACK || cpuTestCycle( cpuRegs.sCycle[n], cpuRegs.eCycle[n] ) )
+	const u32 pending = cpuRegs.interrupt & EE_QUEUED_EVENTS;
+	for (u32 n = 0; n < 32; n++)
 	{
-		cpuClearInt( n );
-		callback();
+		if (pending & (1u << n))
+			s_ee_events.Schedule(n, cpuRegs.sCycle[n] + cpuRegs.eCycle[n]);
 	}
-	else
-		cpuSetNextEvent( cpuRegs.sCycle[n], cpuRegs.eCycle[n] );
+}
+
+// Removes the events which are due from the queue, and returns their mask.
+static __fi u32 cpuPopDueEvents()
+{
+	EventQueue::ScopedOverhead overhead(s_ee_events);
+
+	// Every pending DMA runs straight away, regardless of its timing (see _cpuEventTest_Shared).
+	// The queue entries of the events this dispatches are dropped once they come up.
+	if (CHECK_INSTANTDMAHACK)
+		return cpuRegs.interrupt & EE_QUEUED_EVENTS;
+
+	u32 due = 0;
+	while (s_ee_events.HasDue(cpuRegs.cycle))
+	{
+		const u32 n = s_ee_events.Pop();
+		if (!(cpuRegs.interrupt & (1u << n)))
+		{
+			// Cleared without going through cpuClearInt().
+			s_ee_events.AddStale();
+			continue;
+		}
+
+		if (!cpuTestCycle(cpuRegs.sCycle[n], cpuRegs.eCycle[n]))
+		{
+			// Delayed by writing eCycle directly.
+			s_ee_events.Schedule(n, cpuRegs.sCycle[n] + cpuRegs.eCycle[n]);
+			s_ee_events.AddStale();
+			continue;
+		}
+
+		due |= 1u << n;
+	}
+
+	return due;
 }
 
 // [TODO] move this function to Dmac.cpp, and remove most of the DMAC-related headers from
@@ -266,39 +346,37 @@ static __fi bool _cpuTestInterrupts()
 		return false;
 	}
 
+	s_ee_events.AddTest();
 	eeRunInterruptScan = INT_RUNNING;
 
+	// Due events which haven't been dispatched yet. This carries over between passes, since handlers can raise
+	// events for slots earlier in the order, which have been popped from the queue but can't run until the next pass.
+	u32 due = 0;
 	while (eeRunInterruptScan == INT_RUNNING)
 	{
-		/* These are 'pcsx2 interrupts', they handle asynchronous stuff
-		   that depends on the cycle timings */
-		TESTINT(VU_MTVU_BUSY, MTVUInterrupt);
-		TESTINT(DMAC_VIF1, vif1Interrupt);
-		TESTINT(DMAC_GIF, gifInterrupt);
-		TESTINT(DMAC_SIF0, EEsif0Interrupt);
-		TESTINT(DMAC_SIF1, EEsif1Interrupt);
-		// Profile-guided Optimization (sorta)
-		// The following ints are rarely called.  Encasing them in a conditional
-		// as follows helps speed up most games.
-
-		if (cpuRegs.interrupt & ((1 << DMAC_VIF0) | (1 << DMAC_FROM_IPU) | (1 << DMAC_TO_IPU)
-			| (1 << DMAC_FROM_SPR) | (1 << DMAC_TO_SPR) | (1 << DMAC_MFIFO_VIF) | (1 << DMAC_MFIFO_GIF)
-			| (1 << VIF_VU0_FINISH) | (1 << VIF_VU1_FINISH) | (1 << IPU_PROCESS)))
+		due |= cpuPopDueEvents();
+		for (const EEEventHandler& handler : s_ee_event_handlers)
 		{
-			TESTINT(DMAC_VIF0, vif0Interrupt);
-
-			TESTINT(DMAC_FROM_IPU, ipu0Interrupt);
-			TESTINT(DMAC_TO_IPU, ipu1Interrupt);
-			TESTINT(IPU_PROCESS, ipuCMDProcess);
-
-			TESTINT(DMAC_FROM_SPR, SPRFROMinterrupt);
-			TESTINT(DMAC_TO_SPR, SPRTOinterrupt);
+			const EE_EventType n = handler.id;
+			if (!(due & (1u << n)))
+				continue;
+			due &= ~(1u << n);
+
+			// An earlier handler may have stopped or restarted this event.
+			if (!(cpuRegs.interrupt & (1u << n)))
+				continue;
+			if (!CHECK_INSTANTDMAHACK && !cpuTestCycle(cpuRegs.sCycle[n], cpuRegs.eCycle[n]))
+			{
+				s_ee_events.Schedule(n, cpuRegs.sCycle[n] + cpuRegs.eCycle[n]);
+				continue;
+			}
 
-			TESTINT(DMAC_MFIFO_VIF, vifMFIFOInterrupt);
-			TESTINT(DMAC_MFIFO_GIF, gifMFIFOInterrupt);
+			cpuClearInt(n);
+			handler.callback();
+			s_ee_events.AddDispatched();
 
-			TESTINT(VIF_VU0_FINISH, vif0VUFinish);
-			TESTINT(VIF_VU1_FINISH, vif1VUFinish);
+			// Events raised by the handler which are already due run in this pass if they come later in the order.
+			due |= cpuPopDueEvents();
 		}
 
 		if (eeRunInterruptScan == INT_REQ_LOOP)
@@ -309,6 +387,16 @@ static __fi bool _cpuTestInterrupts()
 
 	eeRunInterruptScan = INT_NOT_RUNNING;
 
+	// Put the events whose slot was already passed back in the queue, they're still due for the next test.
+	for (u32 n = 0; due != 0; n++, due >>= 1)
+	{
+		if ((due & 1) && (cpuRegs.interrupt & (1u << n)))
+			s_ee_events.Schedule(n, cpuRegs.sCycle[n] + cpuRegs.eCycle[n]);
+	}
+
+	if (!s_ee_events.IsEmpty())
+		cpuSetNextEvent(s_ee_events.GetNextDue(), 0);
+
 	if ((cpuRegs.interrupt & 0x1FFFF) & ~cpuRegs.dmastall)
 		return true;
 	else
@@ -528,6 +616,8 @@ __fi void CPU_INT( EE_EventType n, s32 ecycle)
 		cpuRegs.interrupt |= 1 << n;
 		cpuRegs.sCycle[n] = cpuRegs.cycle;
 		cpuRegs.eCycle[n] = 0;
+		if (EE_QUEUED_EVENTS & (1u << n))
+			s_ee_events.Schedule(n, cpuRegs.cycle);
 		return;
 	}
 
@@ -540,6 +630,8 @@ __fi void CPU_INT( EE_EventType n, s32 ecycle)
 	cpuRegs.interrupt |= 1 << n;
 	cpuRegs.sCycle[n] = cpuRegs.cycle;
 	cpuRegs.eCycle[n] = ecycle;
+	if (EE_QUEUED_EVENTS & (1u << n))
+		s_ee_events.Schedule(n, cpuRegs.cycle + ecycle);
 
 	// Interrupt is happening soon: make sure both EE and IOP are aware.
 
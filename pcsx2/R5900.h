@@ -289,6 +289,12 @@ void intSetBranch();
 // parts of the Recs (namely COP0's branch codes and stuff).
 void intDoBranch(u32 target);
 
+// Runs code through the interpreter for the recompiler, until a branch is taken or max_insts have been run.
+u32 intExecuteForRecompiler(u32 max_insts);
+void intCancelForRecompiler();
+// Leaves recompiler mode, for when the recompiler jumps out of intExecuteForRecompiler() instead of it returning.
+void intAbortForRecompiler();
+
 // modules loaded at hardcoded addresses by the kernel
 const u32 EEKERNEL_START	= 0;
 const u32 EENULL_START		= 0x81FC0;
@@ -401,6 +407,7 @@ extern void cpuTlbMissR(u32 addr, u32 bd);
 extern void cpuTlbMissW(u32 addr, u32 bd);
 extern void cpuTestHwInts();
 extern void cpuClearInt(uint n);
+extern void cpuRescheduleEvents();
 extern void GoemonPreloadTlb();
 extern void GoemonUnloadTlb(u32 key);
 
@@ -187,6 +187,13 @@ bool SaveStateBase::FreezeInternals(Error* error)
 	Freeze(AllowParams1);	//OSDConfig written (Fast Boot)
 	Freeze(AllowParams2);
 
+	// The EE and IOP event queues are derived from the interrupt masks and cycles above.
+	if (IsLoading())
+	{
+		cpuRescheduleEvents();
+		psxRescheduleEvents();
+	}
+
 	// Third Block - Cycle Timers and Events
 	// -------------------------------------
 	if (!FreezeTag("Cycles"))
@@ -8,6 +8,7 @@
 #include "Counters.h"
 #include "DEV9/DEV9.h"
 #include "DebugTools/DebugInterface.h"
+#include "DebugTools/HotspotProfiler.h"
 #include "DebugTools/SymbolImporter.h"
 #include "Elfheader.h"
 #include "FW.h"
@@ -1578,6 +1579,10 @@ bool VMManager::Initialize(VMBootParameters boot_params)
 	}
 
 	PerformanceMetrics::Clear();
+
+	if (EmuConfig.Profiler.Enabled)
+		HotspotProfiler::Start();
+
 	return true;
 }
 
@@ -1594,6 +1599,9 @@ void VMManager::Shutdown(bool save_resume_state)
 		vu1Thread.WaitVU();
 	MTGS::WaitGS();
 
+	// write out the profile before the disc serial is cleared
+	HotspotProfiler::Stop();
+
 	if (!GSDumpReplayer::IsReplayingDump() && save_resume_state)
 	{
 		std::string resume_file_name(GetCurrentSaveStateFileName(-1));
@@ -2844,6 +2852,13 @@ void VMManager::CheckForCPUConfigChanges(const Pcsx2Config& old_config)
 	if (EmuConfig.Cpu.Recompiler.EnableFastmem != old_config.Cpu.Recompiler.EnableFastmem)
 		vtlb_ResetFastmem();
 
+	if (EmuConfig.Profiler != old_config.Profiler)
+	{
+		HotspotProfiler::Stop();
+		if (EmuConfig.Profiler.Enabled)
+			HotspotProfiler::Start();
+	}
+
 	// did we toggle recompilers?
 	if (EmuConfig.Cpu.CpusChanged(old_config.Cpu))
 	{
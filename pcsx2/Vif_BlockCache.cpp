@@ -0,0 +1,166 @@
+// SPDX-FileCopyrightText: 2002-2024 PCSX2 Dev Team
+// SPDX-License-Identifier: GPL-3.0+
+
+#include "Common.h"
+#include "Vif_BlockCache.h"
+#include "Vif_Dynarec.h"
+
+#include "common/Console.h"
+#include "common/FileSystem.h"
+#include "common/Path.h"
+#include "common/Timer.h"
+
+#include "fmt/core.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace VifBlockCache
+{
+	static constexpr u32 CACHE_SIGNATURE = 0x42464956; // VIFB
+	static constexpr u32 CACHE_VERSION = 1;
+
+	// Far more than any game uses, but keeps a corrupted file from precompiling forever.
+	static constexpr u32 MAX_KEYS = 0x4000;
+
+	struct CacheHeader
+	{
+		u32 signature;
+		u32 version;
+		u32 num_keys;
+		u32 pad;
+	};
+
+	struct Stats
+	{
+		u32 loaded;
+		u32 precompiled;
+		u32 recorded;
+		u64 precompile_ticks;
+	};
+
+	struct State
+	{
+		std::string path;
+		std::vector<Key> keys;
+		bool dirty = false;
+		Stats stats = {};
+	};
+
+	static bool LoadFile(State& state);
+	static bool SaveFile(const State& state);
+
+	// VIF1 is unpacked on the MTVU thread when it's enabled, so each VIF has its own state and only touches that.
+	static State s_state[2];
+} // namespace VifBlockCache
+
+void VifBlockCache::Open(u32 idx, const std::string& serial, u32 crc)
+{
+	State& state = s_state[idx];
+	std::string path = Path::Combine(EmuFolders::Cache, fmt::format("vif{}_{}_{:08X}.bin", idx, Path::SanitizeFileName(serial), crc));
+	if (path == state.path)
+		return;
+
+	Close(idx);
+
+	state.path = std::move(path);
+	if (!LoadFile(state))
+		state.keys.clear();
+	state.stats.loaded = static_cast<u32>(state.keys.size());
+
+	Console.WriteLn("VIF%u unpack cache: %zu variants loaded from '%s'.", idx, state.keys.size(),
+		Path::GetFileName(state.path).data());
+}
+
+void VifBlockCache::Close(u32 idx)
+{
+	State& state = s_state[idx];
+	if (state.path.empty())
+		return;
+
+	if (state.dirty && !SaveFile(state))
+		Console.Error("VIF%u unpack cache: Failed to write '%s'.", idx, state.path.c_str());
+
+	const Stats& stats = state.stats;
+	if (stats.loaded > 0 || stats.recorded > 0)
+	{
+		Console.WriteLn("VIF%u unpack cache: %zu variants, %u loaded, %u precompiled in %.2f ms, %u new.", idx,
+			state.keys.size(), stats.loaded, stats.precompiled, Common::Timer::ConvertValueToMilliseconds(stats.precompile_ticks),
+			stats.recorded);
+	}
+
+	state = {};
+}
+
+bool VifBlockCache::IsOpen(u32 idx)
+{
+	return !s_state[idx].path.empty();
+}
+
+const std::vector<VifBlockCache::Key>& VifBlockCache::GetKeys(u32 idx)
+{
+	return s_state[idx].keys;
+}
+
+void VifBlockCache::Record(u32 idx, const nVifBlock& block)
+{
+	State& state = s_state[idx];
+	if (state.path.empty() || state.keys.size() >= MAX_KEYS)
+		return;
+
+	// Only called when a block is compiled, which is rare enough for a linear search.
+	const Key key = {block.hash_key, block.key0, block.key1};
+	if (std::any_of(state.keys.begin(), state.keys.end(), [&key](const Key& k) {
+			return k.hash_key == key.hash_key && k.key0 == key.key0 && k.key1 == key.key1;
+		}))
+	{
+		return;
+	}
+
+	state.keys.push_back(key);
+	state.stats.recorded++;
+	state.dirty = true;
+}
+
+void VifBlockCache::AddPrecompiled(u32 idx, u32 blocks, u64 ticks)
+{
+	Stats& stats = s_state[idx].stats;
+	stats.precompiled += blocks;
+	stats.precompile_ticks += ticks;
+}
+
+bool VifBlockCache::LoadFile(State& state)
+{
+	std::optional<std::vector<u8>> data = FileSystem::ReadBinaryFile(state.path.c_str());
+	if (!data.has_value())
+		return false;
+
+	CacheHeader header;
+	if (data->size() < sizeof(header))
+		return false;
+	std::memcpy(&header, data->data(), sizeof(header));
+
+	if (header.signature != CACHE_SIGNATURE || header.version != CACHE_VERSION || header.num_keys > MAX_KEYS ||
+		data->size() != sizeof(header) + header.num_keys * sizeof(Key))
+	{
+		Console.Warning("VIF unpack cache: '%s' is stale or corrupted, discarding.", Path::GetFileName(state.path).data());
+		return false;
+	}
+
+	state.keys.resize(header.num_keys);
+	std::memcpy(state.keys.data(), data->data() + sizeof(header), header.num_keys * sizeof(Key));
+	return true;
+}
+
+bool VifBlockCache::SaveFile(const State& state)
+{
+	CacheHeader header = {};
+	header.signature = CACHE_SIGNATURE;
+	header.version = CACHE_VERSION;
+	header.num_keys = static_cast<u32>(state.keys.size());
+
+	std::vector<u8> data(sizeof(header) + state.keys.size() * sizeof(Key));
+	std::memcpy(data.data(), &header, sizeof(header));
+	std::memcpy(data.data() + sizeof(header), state.keys.data(), state.keys.size() * sizeof(Key));
+	return FileSystem::WriteBinaryFile(state.path.c_str(), data.data(), data.size());
+}
@@ -0,0 +1,47 @@
+// SPDX-FileCopyrightText: 2002-2024 PCSX2 Dev Team
+// SPDX-License-Identifier: GPL-3.0+
+
+#pragma once
+
+#include "common/Pcsx2Types.h"
+
+#include <string>
+#include <vector>
+
+union nVifBlock;
+
+// --------------------------------------------------------------------------------------
+//  VifBlockCache
+// --------------------------------------------------------------------------------------
+// Persistent, per-game list of the unpack variants (format, mask, mode, cycle and alignment)
+// each VIF has compiled. The keys fully describe the generated code, so only they are stored,
+// and every variant a game has used before is compiled when the VIF is reset rather than the
+// first time it shows up mid-frame.
+//
+namespace VifBlockCache
+{
+	struct Key
+	{
+		u32 hash_key; // [usn*1:mask*1:upk*4:num*8]
+		u32 key0; // mask
+		u32 key1; // [wl*8:cl*8:aligned*8:mode*8]
+	};
+
+	/// Opens (or keeps open) the cache of the specified VIF for a game. Any previously open
+	/// cache for a different game is written back first.
+	void Open(u32 idx, const std::string& serial, u32 crc);
+
+	/// Writes the cache back to disk if it has changed, logs statistics, and releases it.
+	void Close(u32 idx);
+
+	bool IsOpen(u32 idx);
+
+	/// Variants to precompile, in the order they were first seen.
+	const std::vector<Key>& GetKeys(u32 idx);
+
+	/// Adds the key of a block which was compiled this session, if it isn't known already.
+	void Record(u32 idx, const nVifBlock& block);
+
+	/// Statistics, reported when the cache is closed.
+	void AddPrecompiled(u32 idx, u32 blocks, u64 ticks);
+} // namespace VifBlockCache
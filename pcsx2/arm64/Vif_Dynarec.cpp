@@ -4,10 +4,13 @@
 #include "arm64/Vif_UnpackNEON.h"
 #include "arm64/AsmHelpers.h"
 #include "MTVU.h"
+#include "VMManager.h"
+#include "Vif_BlockCache.h"
 
 #include "common/Assertions.h"
 #include "common/Perf.h"
 #include "common/StringUtil.h"
+#include "common/Timer.h"
 
 namespace a64 = vixl::aarch64;
 
@@ -170,7 +173,9 @@ static void maskedVecWrite(const a64::VRegister& reg, const a64::MemOperand& add
 	}
 }
 
-void dVifReset(int idx)
+_vifT static void dVifPrecompile();
+
+static void dVifResetCode(int idx)
 {
 	nVif[idx].vifBlocks.reset();
 
@@ -180,8 +185,29 @@ void dVifReset(int idx)
 	nVif[idx].recEndPtr = nVif[idx].recWritePtr + (size - _256kb);
 }
 
+void dVifReset(int idx)
+{
+	dVifResetCode(idx);
+
+	const std::string serial = VMManager::GetDiscSerial();
+	const u32 crc = VMManager::GetCurrentCRC();
+	if (EmuConfig.Cpu.Recompiler.EnableVIFUnpackCache && !serial.empty() && crc != 0)
+	{
+		VifBlockCache::Open(idx, serial, crc);
+		if (idx)
+			dVifPrecompile<1>();
+		else
+			dVifPrecompile<0>();
+	}
+	else
+	{
+		VifBlockCache::Close(idx);
+	}
+}
+
 void dVifRelease(int idx)
 {
+	VifBlockCache::Close(idx);
 	nVif[idx].vifBlocks.clear();
 }
 
@@ -480,7 +506,7 @@ _vifT __fi nVifBlock* dVifCompile(nVifBlock& block, bool isFill)
 	{
 		DevCon.WriteLn("nVif Recompiler Cache Reset! [0x%016" PRIXPTR " > 0x%016" PRIXPTR "]",
 			v.recWritePtr, v.recEndPtr);
-		dVifReset(idx);
+		dVifResetCode(idx);
 	}
 
 	// Compile the block now
@@ -489,6 +515,7 @@ _vifT __fi nVifBlock* dVifCompile(nVifBlock& block, bool isFill)
 	block.startPtr = (uptr)armStartBlock();
 	block.length = dVifComputeLength(block.cl, block.wl, block.num, isFill);
 	v.vifBlocks.add(block);
+	VifBlockCache::Record(idx, block);
 
 	VifUnpackNEON_Dynarec(v, block).CompileRoutine();
 
@@ -498,6 +525,36 @@ _vifT __fi nVifBlock* dVifCompile(nVifBlock& block, bool isFill)
 	return &block;
 }
 
+// Compiles the variants the game has used in previous sessions, so they don't have to be compiled mid-frame.
+_vifT static void dVifPrecompile()
+{
+	nVifStruct& v = nVif[idx];
+
+	// Leave at least half of the buffer for variants which haven't been seen before.
+	const u8* limit = v.recWritePtr + (v.recEndPtr - v.recWritePtr) / 2;
+
+	const Common::Timer::Value start = Common::Timer::GetCurrentValue();
+	u32 count = 0;
+	for (const VifBlockCache::Key& key : VifBlockCache::GetKeys(idx))
+	{
+		if (v.recWritePtr >= limit)
+			break;
+
+		nVifBlock block = {};
+		block.hash_key = static_cast<u16>(key.hash_key);
+		block.key0 = key.key0;
+		block.key1 = key.key1;
+		if (v.vifBlocks.find(block))
+			continue;
+
+		const uint wl = block.wl ? block.wl : 256;
+		dVifCompile<idx>(block, block.cl < wl);
+		count++;
+	}
+
+	VifBlockCache::AddPrecompiled(idx, count, Common::Timer::GetCurrentValue() - start);
+}
+
 _vifT __fi void dVifUnpack(const u8* data, bool isFill)
 {
 	nVifStruct& v = nVif[idx];
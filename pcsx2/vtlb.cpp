@@ -62,20 +62,6 @@ struct FastmemVirtualMapping
 	u32 size;
 };
 
-struct LoadstoreBackpatchInfo
-{
-	u32 guest_pc;
-	u32 gpr_bitmask;
-	u32 fpr_bitmask;
-	u8 code_size;
-	u8 address_register;
-	u8 data_register;
-	u8 size_in_bits;
-	bool is_signed;
-	bool is_load;
-	bool is_fpr;
-};
-
 static constexpr size_t FASTMEM_AREA_SIZE = 0x100000000ULL;
 static constexpr u32 FASTMEM_PAGE_COUNT = FASTMEM_AREA_SIZE / VTLB_PAGE_SIZE;
 static constexpr u32 NO_FASTMEM_MAPPING = 0xFFFFFFFFu;
@@ -1125,6 +1111,17 @@ void vtlb_ClearLoadStoreInfo()
 	s_fastmem_faulting_pcs.clear();
 }
 
+void vtlb_RemoveLoadStoreInfo(uptr code_start, uptr code_end)
+{
+	for (auto iter = s_fastmem_backpatch_info.begin(); iter != s_fastmem_backpatch_info.end();)
+	{
+		if (iter->first >= code_start && iter->first < code_end)
+			iter = s_fastmem_backpatch_info.erase(iter);
+		else
+			++iter;
+	}
+}
+
 void vtlb_AddLoadStoreInfo(uptr code_address, u32 code_size, u32 guest_pc, u32 gpr_bitmask, u32 fpr_bitmask, u8 address_register, u8 data_register, u8 size_in_bits, bool is_signed, bool is_load, bool is_fpr)
 {
 	pxAssert(code_size < std::numeric_limits<u8>::max());
@@ -1137,6 +1134,16 @@ void vtlb_AddLoadStoreInfo(uptr code_address, u32 code_size, u32 guest_pc, u32 g
 	s_fastmem_backpatch_info.emplace(code_address, info);
 }
 
+bool vtlb_GetLoadStoreInfo(uptr code_address, LoadstoreBackpatchInfo* info)
+{
+	auto iter = s_fastmem_backpatch_info.find(code_address);
+	if (iter == s_fastmem_backpatch_info.end())
+		return false;
+
+	*info = iter->second;
+	return true;
+}
+
 bool vtlb_BackpatchLoadStore(uptr code_address, uptr fault_address)
 {
 	uptr fastmem_start = (uptr)vtlbdata.fastmem_base;
@@ -1517,7 +1524,13 @@ static __fi void mmap_ClearCpuBlock(uint offset)
 	HostSys::MemProtect(&eeMem->Main[rampage << __pageshift], __pagesize, PageAccess_ReadWrite());
 	vtlb_UpdateFastmemProtection(rampage << __pageshift, __pagesize, PageAccess_ReadWrite());
 	m_PageProtectInfo[rampage].Mode = ProtMode_Manual;
-	Cpu->Clear(m_PageProtectInfo[rampage].ReverseRamMap, __pagesize);
+
+	// With sub-page tracking, only the blocks in the 256 byte chunk being written are cleared. The recompiler
+	// puts integrity checks in front of the rest of the page's blocks, since the page is writable from now on.
+	if (EmuConfig.Cpu.Recompiler.EnableEESubPageSMC)
+		Cpu->Clear(m_PageProtectInfo[rampage].ReverseRamMap + (offset & __pagemask & ~0xffu), 0x100 / 4);
+	else
+		Cpu->Clear(m_PageProtectInfo[rampage].ReverseRamMap, __pagesize);
 }
 
 PageFaultHandler::HandlerResult PageFaultHandler::HandlePageFault(void* exception_pc, void* fault_address, bool is_write)
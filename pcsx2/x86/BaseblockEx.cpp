@@ -3,11 +3,14 @@
 
 #include "BaseblockEx.h"
 
+#include <algorithm>
+#include <iterator>
+
 BASEBLOCKEX* BaseBlocks::New(u32 startpc, uptr fnptr)
 {
-	std::pair<linkiter_t, linkiter_t> range = links.equal_range(startpc);
-	for (linkiter_t i = range.first; i != range.second; ++i)
-		*(u32*)i->second = fnptr - (i->second + 4);
+	links.ForEach(startpc, [fnptr](uptr jumpptr) {
+		*(u32*)jumpptr = fnptr - (jumpptr + 4);
+	});
 
 	return blocks.insert(startpc, fnptr);
 }
@@ -57,12 +60,176 @@ BASEBLOCKEX* BaseBlocks::GetByX86(uptr ip)
 }
 #endif
 
-void BaseBlocks::Link(u32 pc, s32* jumpptr)
+const BASEBLOCKEX* BaseBlocks::Link(u32 pc, s32* jumpptr)
 {
 	BASEBLOCKEX* targetblock = Get(pc);
-	if (targetblock && targetblock->startpc == pc)
+	if (targetblock && targetblock->startpc != pc)
+		targetblock = nullptr;
+
+	if (targetblock)
 		*jumpptr = (s32)(targetblock->fnptr - (sptr)(jumpptr + 1));
 	else
 		*jumpptr = (s32)(recompiler - (sptr)(jumpptr + 1));
-	links.insert(std::pair<u32, uptr>(pc, (uptr)jumpptr));
+	links.Add(pc, (uptr)jumpptr);
+	return targetblock;
+}
+
+void BaseBlockLinks::Add(u32 pc, uptr jumpptr)
+{
+	// Keep the load factor at or below 50%, probe sequences stay short with linear probing.
+	if ((m_used_buckets + 1) * 2 > m_buckets.size())
+		Rehash(m_buckets.empty() ? INITIAL_BUCKETS : static_cast<u32>(m_buckets.size() * 2));
+
+	const u32 mask = static_cast<u32>(m_buckets.size() - 1);
+	u32 idx = BucketIndex(pc);
+	while (m_buckets[idx].head != INVALID_INDEX && m_buckets[idx].pc != pc)
+		idx = (idx + 1) & mask;
+
+	Bucket& bucket = m_buckets[idx];
+	if (bucket.head == INVALID_INDEX)
+	{
+		bucket.pc = pc;
+		m_used_buckets++;
+	}
+
+	m_nodes.push_back({jumpptr, bucket.head});
+	bucket.head = static_cast<u32>(m_nodes.size() - 1);
+}
+
+void BaseBlockLinks::Clear()
+{
+	// Keep the storage around, it'll be needed again once the game gets going.
+	std::fill(m_buckets.begin(), m_buckets.end(), Bucket{0, INVALID_INDEX});
+	m_nodes.clear();
+	m_used_buckets = 0;
+}
+
+void BaseBlockLinks::RemoveJumpsIn(uptr start, uptr end)
+{
+	// Rare enough (only when code is evicted) that rebuilding the whole table is fine.
+	std::vector<std::pair<u32, uptr>> kept;
+	kept.reserve(m_nodes.size());
+	for (const Bucket& bucket : m_buckets)
+	{
+		if (bucket.head == INVALID_INDEX)
+			continue;
+
+		for (u32 idx = bucket.head; idx != INVALID_INDEX; idx = m_nodes[idx].next)
+		{
+			if (m_nodes[idx].jumpptr < start || m_nodes[idx].jumpptr >= end)
+				kept.emplace_back(bucket.pc, m_nodes[idx].jumpptr);
+		}
+	}
+
+	if (kept.size() == m_nodes.size())
+		return;
+
+	Clear();
+
+	// Lists are walked newest first, so add them back in reverse to keep the order.
+	for (auto it = kept.rbegin(); it != kept.rend(); ++it)
+		Add(it->first, it->second);
+}
+
+void BaseBlockLinks::Rehash(u32 new_size)
+{
+	pxAssert((new_size & (new_size - 1)) == 0);
+
+	std::vector<Bucket> old_buckets(new_size, Bucket{0, INVALID_INDEX});
+	old_buckets.swap(m_buckets);
+
+	// Node lists are untouched, only the heads need to move.
+	const u32 mask = new_size - 1;
+	for (const Bucket& bucket : old_buckets)
+	{
+		if (bucket.head == INVALID_INDEX)
+			continue;
+
+		u32 idx = BucketIndex(bucket.pc);
+		while (m_buckets[idx].head != INVALID_INDEX)
+			idx = (idx + 1) & mask;
+
+		m_buckets[idx] = bucket;
+	}
+}
+
+void RecCodeRegions::Reset(u8* start, u8* end, u32 max_block_size)
+{
+	pxAssert(end > start && static_cast<u32>(end - start) / NUM_REGIONS > max_block_size);
+
+	m_start = start;
+	m_region_size = static_cast<u32>(end - start) / NUM_REGIONS;
+	m_max_block_size = max_block_size;
+	m_current = 0;
+	m_limit = m_start + m_region_size - m_max_block_size;
+	std::fill(std::begin(m_used), std::end(m_used), 0u);
+	std::fill(std::begin(m_referenced), std::end(m_referenced), false);
+	m_evicted_pcs.clear();
+	m_stats = {};
+}
+
+u8* RecCodeRegions::Advance(const u8* ptr, u8** evict_start, u8** evict_end)
+{
+	m_used[m_current] = static_cast<u32>(std::min<uptr>(ptr - (m_start + m_current * m_region_size), m_region_size));
+	m_referenced[m_current] = true;
+
+	// The region we just filled is referenced, so this always finds one within two laps.
+	u32 next = m_current;
+	for (;;)
+	{
+		next = (next + 1) % NUM_REGIONS;
+		if (!m_referenced[next])
+			break;
+
+		m_referenced[next] = false;
+	}
+
+	u8* region_start = m_start + next * m_region_size;
+	*evict_start = region_start;
+	*evict_end = region_start + m_used[next];
+	if (m_used[next] > 0)
+		m_stats.evictions++;
+
+	m_current = next;
+	m_used[next] = 0;
+	m_limit = region_start + m_region_size - m_max_block_size;
+	return region_start;
+}
+
+void RecCodeRegions::Touch(uptr code)
+{
+	if (code < reinterpret_cast<uptr>(m_start))
+		return;
+
+	const uptr region = (code - reinterpret_cast<uptr>(m_start)) / m_region_size;
+	if (region < NUM_REGIONS)
+		m_referenced[region] = true;
+}
+
+void RecCodeRegions::NoteEvicted(u32 startpc, u32 x86size)
+{
+	m_evicted_pcs.insert(startpc);
+	m_stats.evicted_blocks++;
+	m_stats.evicted_bytes += x86size;
+}
+
+void RecCodeRegions::NoteCompiled(u32 startpc, u32 x86size)
+{
+	if (m_evicted_pcs.empty() || m_evicted_pcs.erase(startpc) == 0)
+		return;
+
+	m_stats.recompiled_blocks++;
+	m_stats.recompiled_bytes += x86size;
+}
+
+float RecCodeRegions::GetFullness(const u8* ptr) const
+{
+	u64 used = std::min<uptr>(ptr - (m_start + m_current * m_region_size), m_region_size);
+	for (u32 i = 0; i < NUM_REGIONS; i++)
+	{
+		if (i != m_current)
+			used += m_used[i];
+	}
+
+	return static_cast<float>(used) / static_cast<float>(static_cast<u64>(m_region_size) * NUM_REGIONS);
 }
@@ -4,7 +4,8 @@
 #pragma once
 
 #include <cstring>
-#include <map>
+#include <unordered_set>
+#include <vector>
 
 #include "common/Assertions.h"
 
@@ -136,15 +137,101 @@ public:
 
 		_Size -= range;
 	}
+
+	template <typename F>
+	__fi void erase_if(F pred)
+	{
+		s32 out = 0;
+		for (s32 i = 0; i < _Size; i++)
+		{
+			if (pred(blocks[i]))
+				continue;
+
+			if (out != i)
+				blocks[out] = blocks[i];
+			out++;
+		}
+
+		_Size = out;
+	}
+};
+
+// Jumps from recompiled code to the start of a block, indexed by the target pc.
+// The links for each target form a list threaded through a single node array, and the list
+// heads live in an open-addressed hash table, so neither linking nor invalidating a block
+// has to chase heap-allocated tree nodes. Links are only dropped when the table is cleared.
+class BaseBlockLinks
+{
+	static constexpr u32 INVALID_INDEX = 0xFFFFFFFFu;
+	static constexpr u32 INITIAL_BUCKETS = 0x4000;
+
+	struct Bucket
+	{
+		u32 pc;
+		u32 head; // index of the most recently added node, or INVALID_INDEX if the bucket is free
+	};
+
+	struct Node
+	{
+		uptr jumpptr;
+		u32 next;
+	};
+
+	std::vector<Bucket> m_buckets;
+	std::vector<Node> m_nodes;
+	u32 m_used_buckets = 0;
+
+	__fi u32 BucketIndex(u32 pc) const
+	{
+		// Block addresses are word-aligned and clustered, so spread them out before masking.
+		const u32 hash = (pc >> 2) * 0x9E3779B1u;
+		return (hash ^ (hash >> 15)) & static_cast<u32>(m_buckets.size() - 1);
+	}
+
+	__fi const Bucket* Find(u32 pc) const
+	{
+		if (m_buckets.empty())
+			return nullptr;
+
+		const u32 mask = static_cast<u32>(m_buckets.size() - 1);
+		for (u32 idx = BucketIndex(pc);; idx = (idx + 1) & mask)
+		{
+			const Bucket& bucket = m_buckets[idx];
+			if (bucket.head == INVALID_INDEX)
+				return nullptr;
+			if (bucket.pc == pc)
+				return &bucket;
+		}
+	}
+
+	void Rehash(u32 new_size);
+
+public:
+	void Add(u32 pc, uptr jumpptr);
+	void Clear();
+
+	/// Forgets every link whose jump lies in [start, end), e.g. because that code is being reused.
+	void RemoveJumpsIn(uptr start, uptr end);
+
+	/// Calls func(jumpptr) for every link to pc.
+	template <typename F>
+	__fi void ForEach(u32 pc, F func) const
+	{
+		const Bucket* bucket = Find(pc);
+		if (!bucket)
+			return;
+
+		for (u32 idx = bucket->head; idx != INVALID_INDEX; idx = m_nodes[idx].next)
+			func(m_nodes[idx].jumpptr);
+	}
+
+	__fi size_t size() const { return m_nodes.size(); }
 };
 
 class BaseBlocks
 {
 protected:
-	typedef std::multimap<u32, uptr>::iterator linkiter_t;
-
-	// switch to a hash map later?
-	std::multimap<u32, uptr> links;
+	BaseBlockLinks links;
 	uptr recompiler;
 	BaseBlockArray blocks;
 
@@ -196,10 +283,9 @@ public:
 		{
 			pxAssert(idx <= last);
 
-			//u32 startpc = blocks[idx].startpc;
-			std::pair<linkiter_t, linkiter_t> range = links.equal_range(blocks[idx].startpc);
-			for (linkiter_t i = range.first; i != range.second; ++i)
-				*(u32*)i->second = recompiler - (i->second + 4);
+			links.ForEach(blocks[idx].startpc, [recompiler = recompiler](uptr jumpptr) {
+				*(u32*)jumpptr = recompiler - (jumpptr + 4);
+			});
 
 			if (IsDevBuild)
 			{
@@ -217,15 +303,104 @@ public:
 		blocks.erase(first, last + 1);
 	}
 
-	void Link(u32 pc, s32* jumpptr);
+	/// Removes every block whose code lies in [start, end), so the memory can be reused. Jumps to the removed
+	/// blocks go back to the recompiler, and jumps from them are forgotten. on_remove is called for each block
+	/// before it goes. Returns the number of blocks removed.
+	template <typename F>
+	u32 RemoveCodeRange(uptr start, uptr end, F on_remove)
+	{
+		u32 count = 0;
+		blocks.erase_if([&](const BASEBLOCKEX& block) {
+			if (block.fnptr < start || block.fnptr >= end)
+				return false;
+
+			links.ForEach(block.startpc, [recompiler = recompiler](uptr jumpptr) {
+				*(u32*)jumpptr = recompiler - (jumpptr + 4);
+			});
+
+			on_remove(block);
+			count++;
+			return true;
+		});
+
+		links.RemoveJumpsIn(start, end);
+		return count;
+	}
+
+	/// Points the block, and every jump to it, at fnptr.
+	__fi void Retarget(BASEBLOCKEX* block, uptr fnptr)
+	{
+		links.ForEach(block->startpc, [fnptr](uptr jumpptr) {
+			*(u32*)jumpptr = fnptr - (jumpptr + 4);
+		});
+		block->fnptr = fnptr;
+	}
+
+	/// Returns the block the jump was linked to, if it's already been compiled.
+	const BASEBLOCKEX* Link(u32 pc, s32* jumpptr);
 
 	__fi void Reset()
 	{
 		blocks.clear();
-		links.clear();
+		links.Clear();
 	}
 };
 
+// Splits a recompiler's code buffer into regions which are filled one after the other. Once they've all been
+// used, a cold region is evicted and filled again, instead of throwing away all of the recompiled code.
+// Regions are picked with the clock algorithm: regions holding blocks which newly compiled code links to are
+// marked as referenced, and get skipped once.
+class RecCodeRegions
+{
+public:
+	static constexpr u32 NUM_REGIONS = 8;
+
+	struct Stats
+	{
+		u64 evictions;
+		u64 evicted_blocks;
+		u64 evicted_bytes;
+		u64 recompiled_blocks; // blocks compiled again after being evicted
+		u64 recompiled_bytes;
+	};
+
+	/// Blocks of up to max_block_size bytes are placed in [start, end).
+	void Reset(u8* start, u8* end, u32 max_block_size);
+
+	/// Returns true if a block compiled at ptr might not fit in the current region.
+	__fi bool IsFull(const u8* ptr) const { return ptr >= m_limit; }
+
+	/// Moves on to another region, and returns where to compile next. Any code left in [evict_start, evict_end)
+	/// has to be evicted first, the range is empty if the region hasn't been used yet.
+	u8* Advance(const u8* ptr, u8** evict_start, u8** evict_end);
+
+	/// Marks the region holding code as recently used.
+	void Touch(uptr code);
+	__fi void TouchRegion(u32 region) { m_referenced[region] = true; }
+
+	/// Index of the region code is currently being placed in.
+	__fi u32 GetCurrentRegion() const { return m_current; }
+
+	void NoteEvicted(u32 startpc, u32 x86size);
+	void NoteCompiled(u32 startpc, u32 x86size);
+
+	/// Returns how much of the buffer holds code, from 0 to 1.
+	float GetFullness(const u8* ptr) const;
+
+	__fi const Stats& GetStats() const { return m_stats; }
+
+private:
+	u8* m_start = nullptr;
+	u8* m_limit = nullptr;
+	u32 m_region_size = 0;
+	u32 m_max_block_size = 0;
+	u32 m_current = 0;
+	u32 m_used[NUM_REGIONS] = {};
+	bool m_referenced[NUM_REGIONS] = {};
+	std::unordered_set<u32> m_evicted_pcs;
+	Stats m_stats = {};
+};
+
 #define PC_GETBLOCK_(x, reclut) ((BASEBLOCK*)(reclut[((u32)(x)) >> 16] + (x) * (sizeof(BASEBLOCK) / 4)))
 
 /**
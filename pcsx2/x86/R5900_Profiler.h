@@ -2,8 +2,11 @@
 // SPDX-License-Identifier: GPL-3.0+
 
 #pragma once
+#include "common/Console.h"
 #include "common/Pcsx2Defs.h"
 
+#include <unordered_map>
+
 // Keep my nice alignment please!
 #define MOVZ MOVZtemp
 #define MOVN MOVNtemp
@@ -410,7 +413,119 @@ struct eeProfiler
 };
 #endif
 
+// Execution profile of a block compiled in the profiling tier of superblock mode (see
+// EnableEESuperblocks). The recompiled code updates the counters directly, so the layout
+// of the first four fields is fixed.
+struct eeBlockProfile
+{
+	u32 countdown; // decremented on every entry, the block is promoted when it hits zero
+	u32 fallthrough; // exits to endpc
+	u32 taken; // exits anywhere else through an immediate branch
+	u32 startpc;
+	u32 endpc;
+	bool promoted;
+};
+
+struct eeBlockProfiler
+{
+	static constexpr u32 MAX_PROFILED_BLOCKS = 0x4000;
+	static constexpr u32 PROMOTE_THRESHOLD = 2048;
+
+	// A branch is compiled inline when its fall-through side is at least this many times
+	// more likely than the taken side.
+	static constexpr u32 FALLTHROUGH_BIAS = 8;
+
+	eeBlockProfile blocks[MAX_PROFILED_BLOCKS];
+	std::unordered_map<u32, u32> lookup; // startpc -> index into blocks
+	u32 used = 0;
+
+	u32 promotions = 0;
+	u32 superblocks = 0;
+	u32 merged_branches = 0;
+
+	void Reset()
+	{
+		lookup.clear();
+		used = 0;
+		promotions = 0;
+		superblocks = 0;
+		merged_branches = 0;
+	}
+
+	/// Returns the profile for a block starting at startpc, keeping the counts of any previous
+	/// compilation of the same block. Returns nullptr once the table is full.
+	eeBlockProfile* Allocate(u32 startpc, u32 endpc)
+	{
+		eeBlockProfile* prof;
+		if (const auto it = lookup.find(startpc); it != lookup.end())
+		{
+			prof = &blocks[it->second];
+		}
+		else
+		{
+			if (used == MAX_PROFILED_BLOCKS)
+				return nullptr;
+
+			prof = &blocks[used];
+			lookup.emplace(startpc, used++);
+			prof->countdown = PROMOTE_THRESHOLD;
+			prof->fallthrough = 0;
+			prof->taken = 0;
+			prof->startpc = startpc;
+			prof->endpc = endpc;
+			prof->promoted = false;
+		}
+
+		// Counts from a block with a different shape aren't useful.
+		if (prof->endpc != endpc)
+		{
+			prof->fallthrough = 0;
+			prof->taken = 0;
+			prof->endpc = endpc;
+		}
+
+		return prof;
+	}
+
+	const eeBlockProfile* Find(u32 startpc) const
+	{
+		const auto it = lookup.find(startpc);
+		return (it != lookup.end()) ? &blocks[it->second] : nullptr;
+	}
+
+	void Promote(u32 index)
+	{
+		blocks[index].promoted = true;
+		promotions++;
+	}
+
+	bool IsPromoted(u32 startpc) const
+	{
+		const eeBlockProfile* prof = Find(startpc);
+		return prof && prof->promoted;
+	}
+
+	/// Whether a superblock should keep going through the fall-through side of the branch
+	/// which ends the block at startpc, i.e. at endpc - 8.
+	bool IsFallthroughHot(u32 startpc, u32 endpc) const
+	{
+		const eeBlockProfile* prof = Find(startpc);
+		return prof && prof->endpc == endpc && prof->fallthrough > 0 &&
+			   prof->fallthrough >= static_cast<u64>(prof->taken) * FALLTHROUGH_BIAS;
+	}
+
+	void Print()
+	{
+		if (promotions == 0)
+			return;
+
+		DevCon.WriteLn("EE superblocks: %u blocks profiled, %u promoted, %u superblocks with %u merged branches",
+			used, promotions, superblocks, merged_branches);
+	}
+};
+
 namespace EE
 {
 	extern eeProfiler Profiler;
+	extern eeBlockProfiler BlockProfiler;
 }
@@ -2,12 +2,22 @@
 // SPDX-License-Identifier: GPL-3.0+
 
 #include "Vif_UnpackSSE.h"
+#include "Vif_BlockCache.h"
 #include "MTVU.h"
+#include "VMManager.h"
 #include "common/Perf.h"
 #include "common/StringUtil.h"
+#include "common/Timer.h"
+#include "cpuinfo.h"
 #include "fmt/core.h"
 
-void dVifReset(int idx)
+// Minimum number of vectors before unpacks are expanded two at a time with AVX2; smaller
+// blocks aren't worth the vzeroupper transitions.
+static constexpr uint AVX2_MIN_VECTORS = 8;
+
+_vifT static void dVifPrecompile();
+
+static void dVifResetCode(int idx)
 {
 	nVif[idx].vifBlocks.reset();
 
@@ -17,8 +27,29 @@ void dVifReset(int idx)
 	nVif[idx].recEndPtr = nVif[idx].recWritePtr + (size - _256kb);
 }
 
+void dVifReset(int idx)
+{
+	dVifResetCode(idx);
+
+	const std::string serial = VMManager::GetDiscSerial();
+	const u32 crc = VMManager::GetCurrentCRC();
+	if (EmuConfig.Cpu.Recompiler.EnableVIFUnpackCache && !serial.empty() && crc != 0)
+	{
+		VifBlockCache::Open(idx, serial, crc);
+		if (idx)
+			dVifPrecompile<1>();
+		else
+			dVifPrecompile<0>();
+	}
+	else
+	{
+		VifBlockCache::Close(idx);
+	}
+}
+
 void dVifRelease(int idx)
 {
+	VifBlockCache::Close(idx);
 	nVif[idx].vifBlocks.clear();
 }
 
@@ -32,7 +63,10 @@ VifUnpackSSE_Dynarec::VifUnpackSSE_Dynarec(const nVifStruct& vif_, const nVifBlo
 	doMask    = (vB.upkType>>4) & 1;
 	doMode    = vB.mode & 3;
 	IsAligned = vB.aligned;
+	useAVX2   = cpuinfo_has_x86_avx2();
 	vCL       = 0;
+	inAVX     = false;
+	rowYMM    = false;
 }
 
 __fi void makeMergeMask(u32& x)
@@ -143,6 +177,167 @@ void VifUnpackSSE_Dynarec::writeBackRow() const
 	VIF_LOG("nVif: writing back row reg! [doMode = %d]", doMode);
 }
 
+// Lanes of a vector which are written with data, the row, the column, or not at all, for
+// a given cycle. Lane x is bit 0, as used by vpblendd.
+struct VifLaneMasks
+{
+	u8 data;
+	u8 row;
+	u8 col;
+	u8 prot;
+};
+
+static VifLaneMasks GetLaneMasks(u32 mask, bool doMask, int cc)
+{
+	VifLaneMasks lanes = {};
+	if (!doMask)
+	{
+		lanes.data = 0xf;
+		return lanes;
+	}
+
+	const u32 m0 = (mask >> (cc * 8)) & 0xff;
+	for (int i = 0; i < 4; i++)
+	{
+		switch ((m0 >> (i * 2)) & 3)
+		{
+			case 0: lanes.data |= 1 << i; break;
+			case 1: lanes.row  |= 1 << i; break;
+			case 2: lanes.col  |= 1 << i; break;
+			case 3: lanes.prot |= 1 << i; break;
+		}
+	}
+	return lanes;
+}
+
+bool VifUnpackSSE_Dynarec::CanUnpackPairAVX2() const
+{
+	if (!useAVX2)
+		return false;
+
+	// Difference mode is a running sum, the lane shuffles needed to do two vectors at once
+	// make it slower than doing them one at a time.
+	if (doMode == 2)
+		return false;
+
+	// Accumulate mode updates the row per vector, which can only be done for both vectors at
+	// once if they update the same lanes and neither reads a lane the other writes.
+	if (doMode == 3 && doMask)
+	{
+		const int cc0 = std::min(vCL, 3);
+		const int cc1 = std::min(vCL + 1, 3);
+		if (((vB.mask >> (cc0 * 8)) & 0xff) != ((vB.mask >> (cc1 * 8)) & 0xff))
+			return false;
+	}
+
+	return true;
+}
+
+// Unpacks the vectors at vCL and vCL + 1 into the low and high halves of a ymm register, and
+// applies the same masking and mode operations as doMaskWrite() to both at once.
+void VifUnpackSSE_Dynarec::xUnpackPairAVX2(int upknum)
+{
+	const xRegisterSSE& dest = xRegisterSSE::GetYMMInstance(destReg.Id);
+	const xRegisterSSE& row  = xRegisterSSE::GetYMMInstance(xmmRow.Id);
+	const xRegisterSSE& temp = xRegisterSSE::GetYMMInstance(xmmTemp.Id);
+	const xImplAVX_PMove& pmov = usn ? xVPMOVZX : xVPMOVSX;
+
+	const int cc0 = std::min(vCL, 3);
+	const int cc1 = std::min(vCL + 1, 3);
+	const VifLaneMasks m0 = GetLaneMasks(vB.mask, doMask, cc0);
+	const VifLaneMasks m1 = GetLaneMasks(vB.mask, doMask, cc1);
+	const u8 rowBits  = m0.row  | (m1.row << 4);
+	const u8 colBits  = m0.col  | (m1.col << 4);
+	const u8 protBits = m0.prot | (m1.prot << 4);
+
+	// V3-8 takes W from the next vector only at one point in the packet, see xUPK_V3_8().
+	u8 zeroW = 0;
+	for (int i = 0; i < 2; i++)
+	{
+		ModUnpack(upknum, false);
+		if (upknum == 10 && UnpkLoopIteration != IsAligned)
+			zeroW |= 0x8 << (i * 4);
+		ModUnpack(upknum, true);
+	}
+
+	// Every channel of both vectors is write protected.
+	if (protBits == 0xff)
+		return;
+
+	inAVX = true;
+
+	switch (upknum)
+	{
+		case 10:
+		{
+			xAddressVoid src1(srcIndirect);
+			src1 += nVifT[upknum];
+			pmov.BD(destReg, ptr32[srcIndirect]);
+			pmov.BD(workReg, ptr32[src1]);
+			xVINSERTI128(dest, dest, workReg, 1);
+			if (zeroW)
+			{
+				xVPXOR(xmmTemp, xmmTemp, xmmTemp);
+				xVPBLENDD(dest, dest, temp, zeroW);
+			}
+		}
+		break;
+
+		case 12: xVMOVUPS(dest, ptr[srcIndirect]);   break;
+		case 13: pmov.WD(dest, ptr128[srcIndirect]); break;
+		case 14: pmov.BD(dest, ptr64[srcIndirect]);  break;
+
+		jNO_DEFAULT
+	}
+
+	// The row stays broadcast to both halves until the next legacy SSE op, accumulate mode
+	// updates both halves.
+	if ((doMode || rowBits) && !rowYMM)
+	{
+		xVINSERTI128(row, row, xmmRow, 1);
+		rowYMM = true;
+	}
+
+	// Anything that isn't data gets overwritten by the merges below, so the row can be added to all lanes.
+	if (doMode == 1)
+		xVPADDD(dest, dest, row);
+
+	if (rowBits)
+		xVPBLENDD(dest, dest, row, rowBits);
+
+	if (colBits)
+	{
+		xVINSERTI128(temp, xRegisterSSE::GetYMMInstance(xmmCol0.Id + cc0), xRegisterSSE(xmmCol0.Id + cc1), 1);
+		xVPBLENDD(dest, dest, temp, colBits);
+	}
+
+	// Both vectors have the same data lanes here, so the row ends up with the second vector.
+	// Row lanes aren't data lanes in either vector, so the merge above saw the same row.
+	if (doMode == 3 && m1.data)
+	{
+		xVPERM2I128(temp, dest, dest, 0x11);
+		xVPBLENDD(row, row, temp, m1.data | (m1.data << 4));
+	}
+
+	if (protBits)
+	{
+		xVMOVUPS(temp, ptr[dstIndirect]);
+		xVPBLENDD(dest, dest, temp, protBits);
+	}
+
+	xVMOVUPS(ptr[dstIndirect], dest);
+}
+
+void VifUnpackSSE_Dynarec::xLeaveAVX2()
+{
+	if (inAVX)
+	{
+		xVZEROUPPER();
+		inAVX = false;
+		rowYMM = false;
+	}
+}
+
 static void ShiftDisplacementWindow(xAddressVoid& addr, const xRegisterLong& modReg)
 {
 	// Shifts the displacement factor of a given indirect address, so that the address
@@ -251,6 +446,10 @@ void VifUnpackSSE_Dynarec::CompileRoutine()
 	uint vNum = vB.num ? vB.num : 256;
 	doMode    = (upkNum == 0xf) ? 0 : doMode; // V4_5 has no mode feature.
 	UnpkNoOfIterations = 0;
+
+	// Large V4 uploads (vertex streams) are expanded two vectors at a time. V3-8 needs two loads
+	// per pair, which only pays off when the masking work is shared.
+	useAVX2 = useAVX2 && vNum >= AVX2_MIN_VECTORS && ((upkNum >= 12 && upkNum <= 14) || (upkNum == 10 && doMask));
 	VIF_LOG("Compiling new block, unpack number %x, mode %x, masking %x, vNum %x", upkNum, doMode, doMask, vNum);
 
 	pxAssume(vCL == 0);
@@ -272,8 +471,23 @@ void VifUnpackSSE_Dynarec::CompileRoutine()
 		// Determine if reads/processing can be skipped.
 		ProcessMasks();
 
+		if (vCL < cycleSize && vNum >= 2 && (vCL + 1) < cycleSize && CanUnpackPairAVX2())
+		{
+			xUnpackPairAVX2(upkNum);
+
+			dstIndirect += 32;
+			srcIndirect += vift * 2;
+
+			vNum -= 2;
+			vCL += 2;
+			if (vCL == blockSize)
+				vCL = 0;
+			continue;
+		}
+
 		if (vCL < cycleSize)
 		{
+			xLeaveAVX2();
 			ModUnpack(upkNum, false);
 			xUnpack(upkNum);
 			xMovDest();
@@ -289,6 +503,7 @@ void VifUnpackSSE_Dynarec::CompileRoutine()
 		else if (isFill)
 		{
 			// Filling doesn't need anything fancy, it's pretty much a normal write, just doesnt increment the source.
+			xLeaveAVX2();
 			xUnpack(upkNum);
 			xMovDest();
 
@@ -305,6 +520,8 @@ void VifUnpackSSE_Dynarec::CompileRoutine()
 		}
 	}
 
+	xLeaveAVX2();
+
 	if (doMode >= 2)
 		writeBackRow();
 
@@ -334,7 +551,7 @@ _vifT __fi nVifBlock* dVifCompile(nVifBlock& block, bool isFill)
 	{
 		DevCon.WriteLn("nVif Recompiler Cache Reset! [0x%016" PRIXPTR " > 0x%016" PRIXPTR "]",
 			v.recWritePtr, v.recEndPtr);
-		dVifReset(idx);
+		dVifResetCode(idx);
 	}
 
 	// Compile the block now
@@ -343,6 +560,7 @@ _vifT __fi nVifBlock* dVifCompile(nVifBlock& block, bool isFill)
 	block.startPtr = (uptr)xGetAlignedCallTarget();
 	block.length = dVifComputeLength(block.cl, block.wl, block.num, isFill);
 	v.vifBlocks.add(block);
+	VifBlockCache::Record(idx, block);
 
 	VifUnpackSSE_Dynarec(v, block).CompileRoutine();
 
@@ -352,6 +570,36 @@ _vifT __fi nVifBlock* dVifCompile(nVifBlock& block, bool isFill)
 	return &block;
 }
 
+// Compiles the variants the game has used in previous sessions, so they don't have to be compiled mid-frame.
+_vifT static void dVifPrecompile()
+{
+	nVifStruct& v = nVif[idx];
+
+	// Leave at least half of the buffer for variants which haven't been seen before.
+	const u8* limit = v.recWritePtr + (v.recEndPtr - v.recWritePtr) / 2;
+
+	const Common::Timer::Value start = Common::Timer::GetCurrentValue();
+	u32 count = 0;
+	for (const VifBlockCache::Key& key : VifBlockCache::GetKeys(idx))
+	{
+		if (v.recWritePtr >= limit)
+			break;
+
+		nVifBlock block = {};
+		block.hash_key = static_cast<u16>(key.hash_key);
+		block.key0 = key.key0;
+		block.key1 = key.key1;
+		if (v.vifBlocks.find(block))
+			continue;
+
+		const uint wl = block.wl ? block.wl : 256;
+		dVifCompile<idx>(block, block.cl < wl);
+		count++;
+	}
+
+	VifBlockCache::AddPrecompiled(idx, count, Common::Timer::GetCurrentValue() - start);
+}
+
 _vifT __fi void dVifUnpack(const u8* data, bool isFill)
 {
 
@@ -96,11 +96,14 @@ public:
 	int  doMode; // two bit value representing difference mode
 	bool skipProcessing;
 	bool inputMasked;
+	bool useAVX2; // expand pairs of vectors per ymm register, where the format allows it
 
 protected:
-	const nVifStruct& v;   // vif0 or vif1
-	const nVifBlock&  vB;  // some pre-collected data from VifStruct
-	int               vCL; // internal copy of vif->cl
+	const nVifStruct& v;     // vif0 or vif1
+	const nVifBlock&  vB;    // some pre-collected data from VifStruct
+	int               vCL;   // internal copy of vif->cl
+	bool              inAVX; // upper ymm halves are dirty, vzeroupper needed before legacy SSE
+	bool              rowYMM; // row is broadcast to both halves of its ymm register
 
 public:
 	VifUnpackSSE_Dynarec(const nVifStruct& vif_, const nVifBlock& vifBlock_);
@@ -109,8 +112,11 @@ public:
 		, v(src.v)
 		, vB(src.vB)
 	{
-		isFill = src.isFill;
-		vCL    = src.vCL;
+		isFill  = src.isFill;
+		useAVX2 = src.useAVX2;
+		vCL     = src.vCL;
+		inAVX   = src.inAVX;
+		rowYMM  = src.rowYMM;
 	}
 
 	virtual ~VifUnpackSSE_Dynarec() = default;
@@ -129,6 +135,10 @@ protected:
 	void SetMasks(int cS) const;
 	void writeBackRow() const;
 
+	bool CanUnpackPairAVX2() const;
+	void xUnpackPairAVX2(int upknum);
+	void xLeaveAVX2();
+
 	static VifUnpackSSE_Dynarec FillingWrite(const VifUnpackSSE_Dynarec& src)
 	{
 		VifUnpackSSE_Dynarec fillingWrite(src);
@@ -25,6 +25,7 @@
 #include "common/Path.h"
 #include "common/Perf.h"
 #include "DebugTools/Breakpoints.h"
+#include "DebugTools/SymbolGuardian.h"
 
 #include "fmt/core.h"
 
@@ -57,6 +58,7 @@ static BASEBLOCK* recROM = nullptr; // and here
 static BASEBLOCK* recROM1 = nullptr; // also here
 static BASEBLOCK* recROM2 = nullptr; // also here
 static BaseBlocks recBlocks;
+static RecCodeRegions s_codeRegions;
 static u8* recPtr = nullptr;
 static u8* recPtrEnd = nullptr;
 u32 psxpc; // recompiler psxpc
@@ -72,6 +74,15 @@ static BASEBLOCKEX* s_pCurBlockEx = nullptr;
 static u32 s_nEndBlock = 0; // what psxpc the current block ends
 static u32 s_branchTo;
 static bool s_nBlockFF;
+static u32 s_nBlockFFPC; // branch target which stays in the idle loop when s_nBlockFF is set
+
+// Idle loops detected for the WaitLoop speedhack, and the cycles skipped by fast-forwarding them to the next event.
+static struct
+{
+	u32 loops;
+	u64 fast_forwards;
+	u64 skipped_cycles;
+} s_idleLoopStats;
 
 static u32 s_saveConstRegs[32];
 static u32 s_saveHasConstReg = 0, s_saveFlushedConstReg = 0;
@@ -856,10 +867,24 @@ static u8* m_recBlockAlloc = NULL;
 static const uint m_recBlockAllocSize =
 	(((Ps2MemSize::IopRam + Ps2MemSize::Rom + Ps2MemSize::Rom1 + Ps2MemSize::Rom2) / 4) * sizeof(BASEBLOCK));
 
+// Names blocks after the guest function containing them in perf/VTune. Symbols are skipped rather than waited
+// for while they're being imported.
+static bool iopPerfResolvePC(u32 pc, std::string* function, u32* offset)
+{
+	const std::optional<FunctionInfo> info = R3000SymbolGuardian.TryFunctionOverlappingAddress(pc);
+	if (!info.has_value() || info->name.empty())
+		return false;
+
+	*function = info->name;
+	*offset = pc - info->address.value;
+	return true;
+}
+
 static void recReserve()
 {
 	recPtr = SysMemory::GetIOPRec();
 	recPtrEnd = SysMemory::GetIOPRecEnd() - _64kb;
+	Perf::iop.SetPCResolver(iopPerfResolvePC);
 
 	// Goal: Allocate BASEBLOCKs for every possible branch target in IOP memory.
 	// Any 4-byte aligned address makes a valid branch target as per MIPS design (all instructions are
@@ -894,9 +919,27 @@ void recResetIOP()
 {
 	DevCon.WriteLn("iR3000A Recompiler reset.");
 
+	if (s_idleLoopStats.fast_forwards > 0)
+	{
+		DevCon.WriteLn("IOP idle loops: %u detected, %llu fast-forwards skipping %llu cycles",
+			s_idleLoopStats.loops, static_cast<unsigned long long>(s_idleLoopStats.fast_forwards),
+			static_cast<unsigned long long>(s_idleLoopStats.skipped_cycles));
+	}
+	s_idleLoopStats = {};
+
+	if (recPtr && s_codeRegions.GetStats().evictions > 0)
+	{
+		const RecCodeRegions::Stats& stats = s_codeRegions.GetStats();
+		DevCon.WriteLn("IOP code buffer: %.1f%% full, %llu evictions (%llu blocks, %llu KB), %llu blocks (%llu KB) recompiled after eviction",
+			s_codeRegions.GetFullness(recPtr) * 100.0f, static_cast<unsigned long long>(stats.evictions),
+			static_cast<unsigned long long>(stats.evicted_blocks), static_cast<unsigned long long>(stats.evicted_bytes / 1024),
+			static_cast<unsigned long long>(stats.recompiled_blocks), static_cast<unsigned long long>(stats.recompiled_bytes / 1024));
+	}
+
 	xSetPtr(SysMemory::GetIOPRec());
 	_DynGen_Dispatchers();
 	recPtr = xGetPtr();
+	s_codeRegions.Reset(recPtr, SysMemory::GetIOPRecEnd(), _64kb);
 
 	iopClearRecLUT((BASEBLOCK*)m_recBlockAlloc,
 		(((Ps2MemSize::IopRam + Ps2MemSize::Rom + Ps2MemSize::Rom1 + Ps2MemSize::Rom2) / 4)));
@@ -1108,6 +1151,12 @@ void psxSetBranchReg(u32 reg)
 	JMP32((uptr)iopDispatcherReg - ((uptr)x86Ptr + 5));
 }
 
+static void iopLinkBlock(u32 pc, s32* jumpptr)
+{
+	if (const BASEBLOCKEX* target = recBlocks.Link(pc, jumpptr))
+		s_codeRegions.Touch(target->fnptr);
+}
+
 void psxSetBranchImm(u32 imm)
 {
 	psxbranch = 1;
@@ -1118,7 +1167,7 @@ void psxSetBranchImm(u32 imm)
 	_psxFlushCall(FLUSH_EVERYTHING);
 	iPsxBranchTest(imm, imm <= psxpc);
 
-	recBlocks.Link(HWADDR(imm), xJcc32());
+	iopLinkBlock(HWADDR(imm), xJcc32());
 }
 
 static __fi u32 psxScaleBlockCycles()
@@ -1155,7 +1204,7 @@ static void iPsxBranchTest(u32 newpc, u32 cpuBranch)
 {
 	u32 blockCycles = psxScaleBlockCycles();
 
-	if (EmuConfig.Speedhacks.WaitLoop && s_nBlockFF && newpc == s_branchTo)
+	if (EmuConfig.Speedhacks.WaitLoop && s_nBlockFF && newpc == s_nBlockFFPC)
 	{
 		xMOV(eax, ptr32[&psxRegs.cycle]);
 		xMOV(ecx, eax);
@@ -1166,7 +1215,11 @@ static void iPsxBranchTest(u32 newpc, u32 cpuBranch)
 		xCMP(eax, ptr32[&psxRegs.iopNextEventCycle]);
 		xCMOVNS(eax, ptr32[&psxRegs.iopNextEventCycle]);
 		xMOV(ptr32[&psxRegs.cycle], eax);
+		xADD(ptr64[&s_idleLoopStats.fast_forwards], 1);
 		xSUB(eax, ecx);
+		xForwardJLE8 nothing_skipped;
+		xADD(ptr64[&s_idleLoopStats.skipped_cycles], rax);
+		nothing_skipped.SetTarget();
 		xSHL(eax, 3);
 		iPsxAddEECycles(0xFFFFFFFF);
 		xJLE(iopExitRecompiledCode);
@@ -1533,6 +1586,119 @@ static void PreBlockCheck(u32 blockpc)
 }
 #endif
 
+// Makes room for new code by removing every block in the next region of the code buffer.
+static void iopEvictCodeRegion()
+{
+	u8* evict_start;
+	u8* evict_end;
+	recPtr = s_codeRegions.Advance(recPtr, &evict_start, &evict_end);
+	if (evict_start == evict_end)
+		return;
+
+	recBlocks.RemoveCodeRange((uptr)evict_start, (uptr)evict_end, [](const BASEBLOCKEX& block) {
+		BASEBLOCK* pblock = PSX_GETBLOCK(block.startpc);
+		if (pblock->GetFnptr() == block.fnptr)
+			pblock->SetFnptr((uptr)iopJITCompile);
+
+		s_codeRegions.NoteEvicted(block.startpc, block.x86size);
+	});
+}
+
+// A loop can be fast-forwarded to the next event as long as it doesn't write to a register it's
+// already read (excepting registers initialised with constants or memory loads) or use any
+// instructions which alter the machine state apart from registers. The branch at end - 8 is skipped.
+static bool psxIsIdleLoop(u32 start, u32 end)
+{
+	u32 reads = 0, loads = 1;
+
+	const auto write = [&reads, &loads](u32 srcs, u32 dest) {
+		if ((loads & srcs) == srcs)
+		{
+			loads |= 1u << dest;
+			return true;
+		}
+
+		reads |= srcs;
+		return !(reads & (1u << dest));
+	};
+
+	for (u32 i = start; i < end; i += 4)
+	{
+		if (i == end - 8)
+			continue;
+
+		psxRegs.code = iopMemRead32(i);
+		const u32 op = psxRegs.code >> 26;
+
+		// nop
+		if (psxRegs.code == 0)
+			continue;
+		// imm arithmetic
+		else if ((op & 070) == 010)
+		{
+			if (!write(1u << _Rs_, _Rt_))
+				return false;
+		}
+		// register arithmetic
+		else if (op == 0 && ((_Funct_ & 070) == 040 || _Funct_ == 052 || _Funct_ == 053))
+		{
+			if (!write(1u << _Rs_ | 1u << _Rt_, _Rd_))
+				return false;
+		}
+		// sll, srl, sra
+		else if (op == 0 && (_Funct_ == 000 || _Funct_ == 002 || _Funct_ == 003))
+		{
+			if (!write(1u << _Rt_, _Rd_))
+				return false;
+		}
+		// sllv, srlv, srav
+		else if (op == 0 && (_Funct_ == 004 || _Funct_ == 006 || _Funct_ == 007))
+		{
+			if (!write(1u << _Rs_ | 1u << _Rt_, _Rd_))
+				return false;
+		}
+		// loads
+		else if ((op & 070) == 040 && op != 047)
+		{
+			if (!write(1u << _Rs_, _Rt_))
+				return false;
+		}
+		// mfc0, mfc2, cfc2
+		else if ((op == 020 && _Rs_ == 0) || (op == 022 && (_Rs_ == 0 || _Rs_ == 2)))
+		{
+			loads |= 1u << _Rt_;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Checks for a conditional branch at branchpc whose fall-through path goes straight back to loop_start.
+static bool psxIsIdleLoopExit(u32 branchpc, u32 loop_start)
+{
+	const u32 branch = iopMemRead32(branchpc);
+	const u32 jump = iopMemRead32(branchpc + 8);
+	if (iopMemRead32(branchpc + 12) != 0)
+		return false;
+
+	const u32 op = branch >> 26;
+	const u32 rt = (branch >> 16) & 0x1f;
+	if (!((op >= 4 && op <= 7) || (op == 1 && (rt == 0 || rt == 1 || rt == 16 || rt == 17))))
+		return false;
+
+	const u32 jump_pc = branchpc + 8;
+	if ((jump >> 26) == 2) // j
+		return ((jump & 0x03ffffff) << 2 | ((jump_pc + 4) & 0xf0000000)) == loop_start;
+	if ((jump & 0xffff0000) == 0x10000000) // b (beq zero, zero)
+		return jump_pc + 4 + static_cast<s16>(jump) * 4 == loop_start;
+
+	return false;
+}
+
 static void iopRecRecompile(const u32 startpc)
 {
 	u32 i;
@@ -1559,8 +1725,12 @@ static void iopRecRecompile(const u32 startpc)
 
 	pxAssert(startpc);
 
-	// if recPtr reached the mem limit reset whole mem
-	if (recPtr >= recPtrEnd)
+	// if recPtr reached the mem limit reset whole mem, or just the oldest code if eviction is enabled
+	if (EmuConfig.Cpu.Recompiler.EnableCodeEviction && s_codeRegions.IsFull(recPtr))
+	{
+		iopEvictCodeRegion();
+	}
+	else if (recPtr >= recPtrEnd)
 	{
 		recResetIOP();
 	}
@@ -1666,22 +1836,19 @@ StartRecomp:
 	s_nBlockFF = false;
 	if (s_branchTo == startpc)
 	{
-		s_nBlockFF = true;
-		for (i = startpc; i < s_nEndBlock; i += 4)
-		{
-			if (i != s_nEndBlock - 8)
-			{
-				switch (iopMemRead32(i))
-				{
-					case 0: // nop
-						break;
-					default:
-						s_nBlockFF = false;
-				}
-			}
-		}
+		s_nBlockFF = psxIsIdleLoop(startpc, s_nEndBlock);
+		s_nBlockFFPC = s_branchTo;
+	}
+	else if (!willbranch3 && s_nEndBlock >= startpc + 8 && psxIsIdleLoopExit(s_nEndBlock - 8, startpc))
+	{
+		// Polling loops which branch out when the condition is met, then jump back to the start.
+		s_nBlockFF = psxIsIdleLoop(startpc, s_nEndBlock);
+		s_nBlockFFPC = s_nEndBlock;
 	}
 
+	if (EmuConfig.Speedhacks.WaitLoop && s_nBlockFF)
+		s_idleLoopStats.loops++;
+
 	// rec info //
 	{
 		EEINST* pcur;
@@ -1748,7 +1915,7 @@ StartRecomp:
 			pxAssert(psxpc == s_nEndBlock);
 			_psxFlushCall(FLUSH_EVERYTHING);
 			xMOV(ptr32[&psxRegs.pc], psxpc);
-			recBlocks.Link(HWADDR(s_nEndBlock), xJcc32());
+			iopLinkBlock(HWADDR(s_nEndBlock), xJcc32());
 			psxbranch = 3;
 		}
 	}
@@ -1759,6 +1926,7 @@ StartRecomp:
 	s_pCurBlockEx->x86size = xGetPtr() - recPtr;
 
 	Perf::iop.RegisterPC((void*)s_pCurBlockEx->fnptr, s_pCurBlockEx->x86size, s_pCurBlockEx->startpc);
+	s_codeRegions.NoteCompiled(s_pCurBlockEx->startpc, s_pCurBlockEx->x86size);
 
 	recPtr = xGetPtr();
 
@@ -349,6 +349,404 @@ void COP2MicroFinishPass::Run(u32 start, u32 end, EEINST* inst_cache)
 #endif
 }
 
+// How far past a branch target we look for writes.
+static constexpr u32 CROSS_BLOCK_LOOKAHEAD = 32;
+
+// How far before a branch we look for constants.
+static constexpr u32 CROSS_BLOCK_LOOKBEHIND = 32;
+
+static const u32* GetCodePtr(u32 apc)
+{
+	return static_cast<const u32*>(PSM(apc));
+}
+
+// Jumps and branches, i.e. instructions followed by a delay slot.
+static bool IsControlTransfer(u32 code)
+{
+	const u32 rs = (code >> 21) & 0x1F;
+	const u32 rt = (code >> 16) & 0x1F;
+
+	switch (code >> 26)
+	{
+		case 0: // jr, jalr
+			return ((code & 0x3F) == 8 || (code & 0x3F) == 9);
+		case 1: // regimm branches
+			return (rt < 4 || (rt >= 16 && rt < 20));
+		case 2: // j
+		case 3: // jal
+		case 4: // beq
+		case 5: // bne
+		case 6: // blez
+		case 7: // bgtz
+		case 20: // beql
+		case 21: // bnel
+		case 22: // blezl
+		case 23: // bgtzl
+			return true;
+		case 16: // bc0
+		case 17: // bc1
+		case 18: // bc2
+			return (rs == 8);
+		default:
+			return false;
+	}
+}
+
+static bool IsLikelyBranch(u32 code)
+{
+	const u32 rs = (code >> 21) & 0x1F;
+	const u32 rt = (code >> 16) & 0x1F;
+
+	switch (code >> 26)
+	{
+		case 1:
+			return (rt == 2 || rt == 3 || rt == 18 || rt == 19);
+		case 20:
+		case 21:
+		case 22:
+		case 23:
+			return true;
+		case 16:
+		case 17:
+		case 18:
+			return (rs == 8 && (rt & 2));
+		default:
+			return false;
+	}
+}
+
+// Instructions whose effects we don't follow: exceptions hand the registers to the kernel, and COP0
+// can change where execution goes.
+static bool IsLookaheadBarrier(u32 code)
+{
+	switch (code >> 26)
+	{
+		case 0:
+		{
+			const u32 funct = code & 0x3F;
+			return (funct == 12 || funct == 13 || (funct >= 48 && funct <= 54)); // syscall, break, traps
+		}
+		case 1:
+		{
+			const u32 rt = (code >> 16) & 0x1F;
+			return (rt >= 8 && rt <= 14); // trap immediates
+		}
+		case 16:
+			return true;
+		default:
+			return false;
+	}
+}
+
+// Returns the static target of the jump or branch at apc, or 0 if it's indirect.
+static u32 GetStaticTarget(u32 apc, u32 code)
+{
+	switch (code >> 26)
+	{
+		case 0:
+			return 0;
+		case 2:
+		case 3:
+			return ((apc + 4) & 0xF0000000) | ((code & 0x03FFFFFF) << 2);
+		default:
+			return apc + 4 + (static_cast<s32>(static_cast<s16>(code & 0xFFFF)) << 2);
+	}
+}
+
+static u32 GetGPRReads(u32 code)
+{
+	EEINST prev, inst;
+	std::memset(&inst, 0, sizeof(inst));
+	prev = inst;
+	recBackpropBSC(code, &prev, &inst);
+
+	u32 reads = 0;
+	for (u32 i = 1; i < 32; i++)
+		reads |= (prev.regs[i] & EEINST_LIVE) ? (1u << i) : 0;
+
+	return reads;
+}
+
+static u32 GetGPRWrites(u32 code)
+{
+	EEINST prev, inst;
+	_recClearInst(&inst);
+	prev = inst;
+	recBackpropBSC(code, &prev, &inst);
+
+	u32 writes = 0;
+	for (u32 i = 0; i < std::size(inst.writeType); i++)
+	{
+		if (inst.writeType[i] == XMMTYPE_GPRREG && inst.writeReg[i] > 0 && inst.writeReg[i] < 32)
+			writes |= 1u << inst.writeReg[i];
+	}
+
+	return writes;
+}
+
+CrossBlockPass::CrossBlockPass() = default;
+
+CrossBlockPass::~CrossBlockPass() = default;
+
+u32 CrossBlockPass::GetDeadGPRs(u32 target)
+{
+	const u32 page_end = (target & ~0xFFFu) + 0x1000;
+	u32 codes[CROSS_BLOCK_LOOKAHEAD + 1];
+	u32 count = 0;
+
+	for (u32 apc = target; count < CROSS_BLOCK_LOOKAHEAD && apc < page_end; apc += 4)
+	{
+		const u32* ptr = GetCodePtr(apc);
+		if (!ptr || IsLookaheadBarrier(*ptr) || isBreakpointNeeded(apc) != 0 || isMemcheckNeeded(apc) != 0)
+			break;
+
+		codes[count++] = *ptr;
+		if (!IsControlTransfer(*ptr))
+			continue;
+
+		// Beyond the branch we don't know where we'll be, but the delay slot runs on both sides of normal
+		// branches. Likely branches only run it when taken.
+		const u32* delay_ptr = (apc + 4 < page_end) ? GetCodePtr(apc + 4) : nullptr;
+		if (!IsLikelyBranch(*ptr) && delay_ptr && !IsLookaheadBarrier(*delay_ptr))
+			codes[count++] = *delay_ptr;
+		break;
+	}
+
+	// Everything is live at the end of what we looked at.
+	const u32 old_code = cpuRegs.code;
+	EEINST cur;
+	_recClearInst(&cur);
+	for (u32 i = count; i > 0; i--)
+	{
+		EEINST prev = cur;
+		cpuRegs.code = codes[i - 1];
+		recBackpropBSC(codes[i - 1], &prev, &cur);
+		cur = prev;
+	}
+	cpuRegs.code = old_code;
+
+	u32 dead = 0;
+	for (u32 i = 1; i < 32; i++)
+		dead |= (cur.regs[i] & EEINST_LIVE) ? 0 : (1u << i);
+
+	return dead;
+}
+
+u32 CrossBlockPass::GetDeadGPRsAtBranch(u32 pc)
+{
+	const u32* ptr = GetCodePtr(pc);
+	const u32* delay_ptr = GetCodePtr(pc + 4);
+	if (!ptr || !delay_ptr || !IsControlTransfer(*ptr))
+		return 0;
+
+	const u32 target = GetStaticTarget(pc, *ptr);
+	const u32 page = pc & ~0xFFFu;
+	if (target == 0 || (target & ~0xFFFu) != page || ((pc + 8) & ~0xFFFu) != page)
+		return 0;
+
+	const u32 old_code = cpuRegs.code;
+	u32 dead = GetDeadGPRs(target) & ~GetGPRReads(*ptr) & ~GetGPRReads(*delay_ptr);
+
+	// Jumps don't have a not-taken side.
+	if ((*ptr >> 26) != 2 && (*ptr >> 26) != 3)
+		dead &= GetDeadGPRs(pc + 8);
+
+	cpuRegs.code = old_code;
+	return dead;
+}
+
+void CrossBlockPass::PropagateConstants(u32 from_pc, u32 edge_pc, u32* known, u64* values)
+{
+	const u32 page = from_pc & ~0xFFFu;
+
+	// Start after the closest jump or branch before from_pc, since we don't know how we got there.
+	u32 start = from_pc;
+	for (u32 i = 0; i < CROSS_BLOCK_LOOKBEHIND && start > page; i++)
+	{
+		const u32* prev_ptr = GetCodePtr(start - 4);
+		const u32* prev2_ptr = (start - 4 > page) ? GetCodePtr(start - 8) : nullptr;
+		if (!prev_ptr || IsControlTransfer(*prev_ptr) || IsLookaheadBarrier(*prev_ptr) || (prev2_ptr && IsControlTransfer(*prev2_ptr)))
+			break;
+
+		start -= 4;
+	}
+
+	*known = 1;
+	values[0] = 0;
+
+	for (u32 apc = start; apc < edge_pc; apc += 4)
+	{
+		const u32 code = *GetCodePtr(apc);
+		const u32 rs = (code >> 21) & 0x1F;
+		const u32 rt = (code >> 16) & 0x1F;
+		const u32 rd = (code >> 11) & 0x1F;
+		const u64 imm = static_cast<u64>(static_cast<s64>(static_cast<s16>(code & 0xFFFF)));
+		const u64 uimm = code & 0xFFFF;
+		const bool rs_known = (*known >> rs) & 1;
+		const bool rt_known = (*known >> rt) & 1;
+
+		u32 dest = 0;
+		u64 value = 0;
+		switch (code >> 26)
+		{
+			case 0:
+			{
+				const u32 sa = (code >> 6) & 0x1F;
+				switch (code & 0x3F)
+				{
+					case 0: // sll
+						if (rt_known)
+							dest = rd, value = static_cast<u64>(static_cast<s64>(static_cast<s32>(static_cast<u32>(values[rt]) << sa)));
+						break;
+					case 32: // add
+					case 33: // addu
+						if (rs_known && rt_known)
+							dest = rd, value = static_cast<u64>(static_cast<s64>(static_cast<s32>(static_cast<u32>(values[rs] + values[rt]))));
+						break;
+					case 36: // and
+						if (rs_known && rt_known)
+							dest = rd, value = values[rs] & values[rt];
+						break;
+					case 37: // or
+						if (rs_known && rt_known)
+							dest = rd, value = values[rs] | values[rt];
+						break;
+					case 38: // xor
+						if (rs_known && rt_known)
+							dest = rd, value = values[rs] ^ values[rt];
+						break;
+					case 44: // dadd
+					case 45: // daddu
+						if (rs_known && rt_known)
+							dest = rd, value = values[rs] + values[rt];
+						break;
+				}
+			}
+			break;
+
+			case 3: // jal
+				dest = 31, value = apc + 8;
+				break;
+
+			case 8: // addi
+			case 9: // addiu
+				if (rs_known)
+					dest = rt, value = static_cast<u64>(static_cast<s64>(static_cast<s32>(static_cast<u32>(values[rs] + imm))));
+				break;
+
+			case 12: // andi
+				if (rs_known)
+					dest = rt, value = values[rs] & uimm;
+				break;
+
+			case 13: // ori
+				if (rs_known)
+					dest = rt, value = values[rs] | uimm;
+				break;
+
+			case 14: // xori
+				if (rs_known)
+					dest = rt, value = values[rs] ^ uimm;
+				break;
+
+			case 15: // lui
+				dest = rt, value = static_cast<u64>(static_cast<s64>(static_cast<s32>(static_cast<u32>(code << 16))));
+				break;
+
+			case 24: // daddi
+			case 25: // daddiu
+				if (rs_known)
+					dest = rt, value = values[rs] + imm;
+				break;
+		}
+
+		*known &= ~GetGPRWrites(code);
+		if (dest != 0)
+		{
+			*known |= 1u << dest;
+			values[dest] = value;
+		}
+	}
+}
+
+void CrossBlockPass::Run(u32 start, u32 end, EEINST* inst_cache)
+{
+	m_num_entry_constants = 0;
+
+	const u32 old_code = cpuRegs.code;
+	const u32 page = start & ~0xFFFu;
+
+	// Only registers the block reads before writing are worth having as constants.
+	u32 candidates = 0, written = 0;
+	for (u32 apc = start; apc < end; apc += 4)
+	{
+		const u32 code = *GetCodePtr(apc);
+		candidates |= GetGPRReads(code) & ~written;
+		written |= GetGPRWrites(code);
+	}
+
+	// Collect the constant state on every static edge into the block from within the page.
+	u32 edges = 0;
+	u32 agreed = candidates;
+	u64 agreed_values[32] = {};
+	const auto add_edge = [&](u32 from_pc, u32 edge_pc) {
+		u32 known;
+		u64 values[32];
+		PropagateConstants(from_pc, edge_pc, &known, values);
+
+		for (u32 reg = 1; reg < 32; reg++)
+		{
+			if (!(agreed & (1u << reg)))
+				continue;
+
+			if (!(known & (1u << reg)) || (edges > 0 && agreed_values[reg] != values[reg]))
+				agreed &= ~(1u << reg);
+			else
+				agreed_values[reg] = values[reg];
+		}
+
+		edges++;
+	};
+
+	for (u32 apc = page; apc < page + 0x1000 && agreed != 0; apc += 4)
+	{
+		const u32 code = *GetCodePtr(apc);
+		if (!IsControlTransfer(code) || GetStaticTarget(apc, code) != start || apc + 4 >= page + 0x1000)
+			continue;
+
+		// The delay slot runs when the branch is taken, likely or not.
+		add_edge(apc, apc + 8);
+	}
+
+	// Falling through from the instruction before, if it isn't a delay slot or the end of a jump.
+	if (start > page && agreed != 0)
+	{
+		const u32 prev_code = *GetCodePtr(start - 4);
+		const u32 prev2_code = (start - 4 > page) ? *GetCodePtr(start - 8) : 0;
+		const bool prev_is_delay_slot = (start - 4 > page) && IsControlTransfer(prev2_code);
+		if (!IsControlTransfer(prev_code) && !IsLookaheadBarrier(prev_code) && !prev_is_delay_slot)
+		{
+			add_edge(start, start);
+		}
+		else if (prev_is_delay_slot && (prev2_code >> 26) != 2 && (prev2_code >> 26) != 3 && (prev2_code >> 26) != 0)
+		{
+			// Not-taken side of a branch. Likely branches skip the delay slot.
+			add_edge(start - 8, IsLikelyBranch(prev2_code) ? start - 4 : start);
+		}
+	}
+
+	cpuRegs.code = old_code;
+
+	if (edges == 0)
+		return;
+
+	for (u32 reg = 1; reg < 32 && m_num_entry_constants < MAX_ENTRY_CONSTANTS; reg++)
+	{
+		if (agreed & (1u << reg))
+			m_entry_constants[m_num_entry_constants++] = {reg, agreed_values[reg]};
+	}
+}
+
 /////////////////////////////////////////////////////////////////////
 // Back-Prop Function Tables - Gathering Info
 // Note to anyone changing these: writes must go before reads.
@@ -59,6 +59,45 @@ namespace R5900
 
 		void Run(u32 start, u32 end, EEINST* inst_cache) override;
 	};
+
+	/// Looks past the ends of a block, following static branch targets within its page. Finds the GPRs
+	/// which are dead when the block exits to a target, and the GPRs which hold the same constant on every
+	/// static path into the block. The results depend on code outside the block, so they're only valid
+	/// while the block gets cleared along with the rest of its page.
+	class CrossBlockPass final : public AnalysisPass
+	{
+	public:
+		static constexpr u32 MAX_ENTRY_CONSTANTS = 4;
+
+		struct EntryConstant
+		{
+			u32 reg;
+			u64 value;
+		};
+
+		CrossBlockPass();
+		~CrossBlockPass();
+
+		/// Finds entry constants for the GPRs the block reads before writing.
+		void Run(u32 start, u32 end, EEINST* inst_cache) override;
+
+		u32 GetEntryConstantCount() const { return m_num_entry_constants; }
+		const EntryConstant& GetEntryConstant(u32 i) const { return m_entry_constants[i]; }
+
+		/// Returns the GPRs which are written before they're read from target onwards.
+		static u32 GetDeadGPRs(u32 target);
+
+		/// Returns the GPRs which are dead on both sides of the conditional branch at pc, and aren't
+		/// read by the branch or its delay slot, so can be dropped before the branch is compiled.
+		static u32 GetDeadGPRsAtBranch(u32 pc);
+
+	private:
+		/// Constants known on the straight-line path through from_pc which ends at edge_pc.
+		static void PropagateConstants(u32 from_pc, u32 edge_pc, u32* known, u64* values);
+
+		EntryConstant m_entry_constants[MAX_ENTRY_CONSTANTS];
+		u32 m_num_entry_constants = 0;
+	};
 } // namespace R5900
 
 void recBackpropBSC(u32 code, EEINST* prev, EEINST* pinst);
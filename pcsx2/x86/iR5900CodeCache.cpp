@@ -0,0 +1,561 @@
+// SPDX-FileCopyrightText: 2002-2024 PCSX2 Dev Team
+// SPDX-License-Identifier: GPL-3.0+
+
+#include "BuildVersion.h"
+#include "Config.h"
+#include "Memory.h"
+#include "x86/iR5900CodeCache.h"
+
+#include "common/Console.h"
+#include "common/FileSystem.h"
+#include "common/HostSys.h"
+#include "common/Path.h"
+#include "common/StringUtil.h"
+#include "common/Timer.h"
+
+#include "cpuinfo.h"
+#include "fmt/core.h"
+#include "Zydis/Zydis.h"
+
+#define XXH_STATIC_LINKING_ONLY 1
+#define XXH_INLINE_ALL 1
+#include <xxhash.h>
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace EERecCodeCache
+{
+	static constexpr u32 CACHE_SIGNATURE = 0x43524545; // EERC
+	static constexpr u32 CACHE_VERSION = 2;
+
+	struct CacheHeader
+	{
+		u32 signature;
+		u32 version;
+		u64 config_hash;
+		u32 num_blocks;
+		u32 pad;
+	};
+
+	struct BlockHeader
+	{
+		u32 startpc;
+		u32 size;
+		u64 guest_hash;
+		u32 code_size;
+		u32 num_relocations;
+		u32 num_links;
+		u32 num_loadstores;
+		BlockProtection protection;
+		u8 pad[7];
+	};
+
+	static u64 ComputeConfigHash(u32 dispatchers_size);
+	static bool ClassifyTarget(const u8* target, RelocationBase* base, s64* offset);
+	static const u8* GetBaseAddress(RelocationBase base);
+	static bool LoadFile();
+	static bool SaveFile();
+
+	static std::string s_path;
+	static u64 s_config_hash = 0;
+	static const u8* s_dispatchers_start = nullptr;
+	static const u8* s_dispatchers_end = nullptr;
+	static const u8* s_data_base = nullptr;
+	static const u8* s_image_base = nullptr;
+	static std::unordered_map<u32, std::vector<Block>> s_blocks;
+	static bool s_dirty = false;
+
+	static u32 s_stat_hits = 0;
+	static u32 s_stat_misses = 0;
+	static u32 s_stat_recorded = 0;
+	static u32 s_stat_rejected = 0;
+	static u64 s_stat_relocations = 0;
+	static u64 s_stat_install_ticks = 0;
+	static u64 s_stat_compile_ticks = 0;
+} // namespace EERecCodeCache
+
+u64 EERecCodeCache::ComputeConfigHash(u32 dispatchers_size)
+{
+	// Anything which changes the code generated for a given guest block needs to go in here.
+	// Addresses of a couple of symbols relative to the image catch rebuilds with the same version.
+	const struct
+	{
+		u32 version;
+		u32 dispatchers_size;
+		u32 recompiler;
+		u32 cpu;
+		u32 gamefixes;
+		u32 speedhacks;
+		u32 fpu_fpcr;
+		u32 fpu_div_fpcr;
+		s32 ee_cycle_rate;
+		u32 ee_cycle_skip;
+		u32 enable_patches;
+		u32 has_avx;
+		u32 has_avx2;
+		u32 pad;
+		s64 open_offset;
+		s64 config_offset;
+	} key = {
+		CACHE_VERSION,
+		dispatchers_size,
+		EmuConfig.Cpu.Recompiler.bitset,
+		EmuConfig.Cpu.bitset,
+		EmuConfig.Gamefixes.bitset,
+		EmuConfig.Speedhacks.bitset,
+		EmuConfig.Cpu.FPUFPCR.bitmask,
+		EmuConfig.Cpu.FPUDivFPCR.bitmask,
+		EmuConfig.Speedhacks.EECycleRate,
+		EmuConfig.Speedhacks.EECycleSkip,
+		EmuConfig.EnablePatches,
+		cpuinfo_has_x86_avx(),
+		cpuinfo_has_x86_avx2(),
+		0,
+		reinterpret_cast<const u8*>(&EERecCodeCache::Open) - s_image_base,
+		reinterpret_cast<const u8*>(&EmuConfig) - s_image_base,
+	};
+
+	XXH64_hash_t hash = XXH3_64bits(&key, sizeof(key));
+	hash = XXH3_64bits_withSeed(BuildVersion::GitHash, std::strlen(BuildVersion::GitHash), hash);
+	return hash;
+}
+
+const u8* EERecCodeCache::GetBaseAddress(RelocationBase base)
+{
+	switch (base)
+	{
+		case RelocationBase::Dispatchers:
+			return s_dispatchers_start;
+		case RelocationBase::DataMemory:
+			return s_data_base;
+		case RelocationBase::Executable:
+		default:
+			return s_image_base;
+	}
+}
+
+bool EERecCodeCache::ClassifyTarget(const u8* target, RelocationBase* base, s64* offset)
+{
+	if (target >= s_dispatchers_start && target < s_dispatchers_end)
+	{
+		*base = RelocationBase::Dispatchers;
+		*offset = target - s_dispatchers_start;
+		return true;
+	}
+
+	if (target >= s_data_base && target < (s_data_base + HostMemoryMap::MainSize))
+	{
+		*base = RelocationBase::DataMemory;
+		*offset = target - s_data_base;
+		return true;
+	}
+
+	if (s_image_base && HostSys::GetModuleBaseAddress(target) == s_image_base)
+	{
+		*base = RelocationBase::Executable;
+		*offset = target - s_image_base;
+		return true;
+	}
+
+	return false;
+}
+
+void EERecCodeCache::Open(const std::string& serial, u32 crc, const u8* dispatchers_start, const u8* dispatchers_end)
+{
+	s_image_base = static_cast<const u8*>(HostSys::GetModuleBaseAddress(reinterpret_cast<const void*>(&EERecCodeCache::Open)));
+	if (!s_image_base)
+	{
+		Close();
+		return;
+	}
+
+	// Anything in the low 2GB can be encoded as an absolute 32-bit immediate or displacement, which can't be told
+	// apart from constants or offsets. Above it, addresses are always RIP-relative or tagged 64-bit immediates.
+	const auto is_low = [](const void* ptr) { return reinterpret_cast<uptr>(ptr) < 0x80000000u; };
+	if (is_low(s_image_base) || is_low(SysMemory::GetDataPtr(0)) || is_low(dispatchers_start))
+	{
+		Console.Warning("EE code cache: Host memory is mapped below 2GB, disabling.");
+		Close();
+		return;
+	}
+
+	const u64 config_hash = ComputeConfigHash(static_cast<u32>(dispatchers_end - dispatchers_start));
+	std::string path = Path::Combine(EmuFolders::Cache, fmt::format("eerec_{}_{:08X}.bin", Path::SanitizeFileName(serial), crc));
+	if (path == s_path && config_hash == s_config_hash && dispatchers_start == s_dispatchers_start)
+		return;
+
+	Close();
+
+	s_path = std::move(path);
+	s_config_hash = config_hash;
+	s_dispatchers_start = dispatchers_start;
+	s_dispatchers_end = dispatchers_end;
+	s_data_base = SysMemory::GetDataPtr(0);
+
+	if (!LoadFile())
+		s_blocks.clear();
+
+	Console.WriteLn("EE code cache: %zu block entries loaded from '%s'.", s_blocks.size(), Path::GetFileName(s_path).data());
+}
+
+void EERecCodeCache::Close()
+{
+	if (s_path.empty())
+		return;
+
+	if (s_dirty && !SaveFile())
+		Console.Error("EE code cache: Failed to write '%s'.", s_path.c_str());
+
+	if (s_stat_hits > 0 || s_stat_misses > 0)
+	{
+		const double install_ms = Common::Timer::ConvertValueToMilliseconds(s_stat_install_ticks);
+		const double compile_ms = Common::Timer::ConvertValueToMilliseconds(s_stat_compile_ticks);
+		const double avg_compile_ms = (s_stat_misses > 0) ? (compile_ms / s_stat_misses) : 0.0;
+		Console.WriteLn("EE code cache: %u hits, %u misses, %u recorded, %u rejected, %llu relocations applied.",
+			s_stat_hits, s_stat_misses, s_stat_recorded, s_stat_rejected, static_cast<unsigned long long>(s_stat_relocations));
+		Console.WriteLn("EE code cache: %.2f ms installing, %.2f ms compiling, ~%.2f ms of compilation saved.",
+			install_ms, compile_ms, std::max(avg_compile_ms * s_stat_hits - install_ms, 0.0));
+	}
+
+	s_blocks.clear();
+	s_path = {};
+	s_config_hash = 0;
+	s_dispatchers_start = nullptr;
+	s_dispatchers_end = nullptr;
+	s_dirty = false;
+
+	s_stat_hits = 0;
+	s_stat_misses = 0;
+	s_stat_recorded = 0;
+	s_stat_rejected = 0;
+	s_stat_relocations = 0;
+	s_stat_install_ticks = 0;
+	s_stat_compile_ticks = 0;
+}
+
+bool EERecCodeCache::IsOpen()
+{
+	return !s_path.empty();
+}
+
+const EERecCodeCache::Block* EERecCodeCache::Lookup(u32 startpc, const void* guest_code)
+{
+	const auto iter = s_blocks.find(startpc);
+	if (iter == s_blocks.end())
+		return nullptr;
+
+	// Several variants can exist for the same start address when code is overlaid.
+	for (const Block& block : iter->second)
+	{
+		if (XXH3_64bits(guest_code, block.size * 4) == block.guest_hash)
+			return &block;
+	}
+
+	return nullptr;
+}
+
+bool EERecCodeCache::Relocate(const Block& block, u8* dest)
+{
+	std::memcpy(dest, block.code.data(), block.code.size());
+
+	for (const Relocation& reloc : block.relocations)
+	{
+		const u8* target = GetBaseAddress(reloc.base) + reloc.target;
+		u8* field = dest + reloc.offset;
+
+		switch (reloc.type)
+		{
+			case RelocationType::Rel32:
+			{
+				const sptr disp = reinterpret_cast<sptr>(target) - reinterpret_cast<sptr>(field + reloc.ip_delta);
+				if (disp != static_cast<s32>(disp))
+					return false;
+
+				const s32 value = static_cast<s32>(disp);
+				std::memcpy(field, &value, sizeof(value));
+			}
+			break;
+
+			case RelocationType::Abs64:
+			{
+				const u64 value = reinterpret_cast<uptr>(target);
+				std::memcpy(field, &value, sizeof(value));
+			}
+			break;
+		}
+	}
+
+	s_stat_relocations += block.relocations.size();
+	return true;
+}
+
+void EERecCodeCache::Record(u32 startpc, u32 size, const void* guest_code, BlockProtection protection, const u8* code, u32 code_size,
+	const std::vector<BlockLink>& links, const std::vector<u8*>& address_tags)
+{
+	Block block;
+	block.startpc = startpc;
+	block.size = size;
+	block.guest_hash = XXH3_64bits(guest_code, size * 4);
+	block.protection = protection;
+	block.code.assign(code, code + code_size);
+	block.links = links;
+
+	ZydisDecoder decoder;
+	ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_ADDRESS_WIDTH_64);
+
+	const auto is_link_field = [&links](u32 offset) {
+		return std::any_of(links.begin(), links.end(), [offset](const BlockLink& link) { return link.offset == offset; });
+	};
+	const auto is_address_field = [&address_tags, code](u32 offset) {
+		return std::find(address_tags.begin(), address_tags.end(), code + offset) != address_tags.end();
+	};
+	u32 address_fields = 0;
+
+	const auto add_relocation = [&block](u32 offset, RelocationType type, u8 ip_delta, const u8* target) {
+		Relocation reloc = {};
+		reloc.offset = offset;
+		reloc.type = type;
+		reloc.ip_delta = ip_delta;
+		if (!ClassifyTarget(target, &reloc.base, &reloc.target))
+			return false;
+
+		block.relocations.push_back(reloc);
+		return true;
+	};
+
+	u32 offset = 0;
+	while (offset < code_size)
+	{
+		ZydisDecodedInstruction inst;
+		if (!ZYAN_SUCCESS(ZydisDecoderDecodeBuffer(&decoder, code + offset, code_size - offset, &inst)))
+		{
+			s_stat_rejected++;
+			return;
+		}
+
+		const u8* inst_end = code + offset + inst.length;
+		bool ok = true;
+
+		BlockLoadStore loadstore;
+		if (vtlb_GetLoadStoreInfo(reinterpret_cast<uptr>(code + offset), &loadstore.info))
+		{
+			loadstore.offset = offset;
+			block.loadstores.push_back(loadstore);
+		}
+
+		for (u32 i = 0; i < std::size(inst.raw.imm) && ok; i++)
+		{
+			const auto& imm = inst.raw.imm[i];
+			if (imm.size == 0)
+				continue;
+
+			const u32 field = offset + imm.offset;
+			if (imm.is_relative)
+			{
+				const u8* target = inst_end + imm.value.s;
+				if (target >= code && target <= code + code_size)
+					continue;
+
+				// Short branches can't be retargeted, but should never leave the block.
+				if (imm.size != 32)
+					ok = false;
+				else if (!is_link_field(field))
+					ok = add_relocation(field, RelocationType::Rel32, static_cast<u8>(inst.length - imm.offset), target);
+			}
+			else if (imm.size == 64 && is_address_field(field))
+			{
+				// Untagged 64-bit immediates are constants, even when they look like an address.
+				ok = add_relocation(field, RelocationType::Abs64, 0, reinterpret_cast<const u8*>(imm.value.u));
+				address_fields++;
+			}
+		}
+
+		if (ok && inst.raw.disp.size == 32)
+		{
+			const ZydisDecodedOperand* mem = nullptr;
+			for (u32 i = 0; i < inst.operand_count; i++)
+			{
+				if (inst.operands[i].type == ZYDIS_OPERAND_TYPE_MEMORY)
+				{
+					mem = &inst.operands[i];
+					break;
+				}
+			}
+
+			const u32 field = offset + inst.raw.disp.offset;
+			if (mem && mem->mem.base == ZYDIS_REGISTER_RIP)
+			{
+				const u8* target = inst_end + inst.raw.disp.value;
+				if (target < code || target > code + code_size)
+					ok = add_relocation(field, RelocationType::Rel32, static_cast<u8>(inst.length - inst.raw.disp.offset), target);
+			}
+			else if (mem && mem->mem.base == ZYDIS_REGISTER_NONE)
+			{
+				// Absolute addresses, which can't point into any of the relocatable regions (see Open()).
+				ok = false;
+			}
+		}
+
+		// Heap pointers, other code buffers, etc. Can't be moved, so don't cache the block.
+		if (!ok)
+		{
+			s_stat_rejected++;
+			return;
+		}
+
+		offset += inst.length;
+	}
+
+	// Every tagged address has to have been found, otherwise the block wasn't decoded the way it was emitted.
+	const u32 tagged_fields = static_cast<u32>(std::count_if(address_tags.begin(), address_tags.end(),
+		[code, code_size](const u8* tag) { return tag >= code && tag < code + code_size; }));
+	if (address_fields != tagged_fields)
+	{
+		s_stat_rejected++;
+		return;
+	}
+
+	std::vector<Block>& variants = s_blocks[startpc];
+	for (Block& existing : variants)
+	{
+		if (existing.guest_hash == block.guest_hash && existing.size == block.size)
+		{
+			existing = std::move(block);
+			s_dirty = true;
+			s_stat_recorded++;
+			return;
+		}
+	}
+
+	variants.push_back(std::move(block));
+	s_dirty = true;
+	s_stat_recorded++;
+}
+
+void EERecCodeCache::AddHit(u64 install_ticks)
+{
+	s_stat_hits++;
+	s_stat_install_ticks += install_ticks;
+}
+
+void EERecCodeCache::AddMiss(u64 compile_ticks)
+{
+	s_stat_misses++;
+	s_stat_compile_ticks += compile_ticks;
+}
+
+bool EERecCodeCache::LoadFile()
+{
+	std::optional<std::vector<u8>> data = FileSystem::ReadBinaryFile(s_path.c_str());
+	if (!data.has_value())
+		return false;
+
+	const u8* ptr = data->data();
+	const u8* end = ptr + data->size();
+	const auto read = [&ptr, end](void* dest, size_t size) {
+		if (static_cast<size_t>(end - ptr) < size)
+			return false;
+		std::memcpy(dest, ptr, size);
+		ptr += size;
+		return true;
+	};
+	const auto read_vector = [&read, &ptr, end](auto& vec, u32 count) {
+		const size_t size = static_cast<size_t>(count) * sizeof(vec[0]);
+		if (static_cast<size_t>(end - ptr) < size)
+			return false;
+		vec.resize(count);
+		return read(vec.data(), size);
+	};
+
+	CacheHeader header;
+	if (!read(&header, sizeof(header)) || header.signature != CACHE_SIGNATURE || header.version != CACHE_VERSION ||
+		header.config_hash != s_config_hash)
+	{
+		Console.Warning("EE code cache: '%s' is stale or corrupted, discarding.", Path::GetFileName(s_path).data());
+		return false;
+	}
+
+	for (u32 i = 0; i < header.num_blocks; i++)
+	{
+		BlockHeader bheader;
+		Block block;
+		if (!read(&bheader, sizeof(bheader)) ||
+			!read_vector(block.code, bheader.code_size) ||
+			!read_vector(block.relocations, bheader.num_relocations) ||
+			!read_vector(block.links, bheader.num_links) ||
+			!read_vector(block.loadstores, bheader.num_loadstores))
+		{
+			Console.Warning("EE code cache: '%s' is truncated, discarding.", Path::GetFileName(s_path).data());
+			return false;
+		}
+
+		// Fields are patched in place when the block is installed, so they all have to be inside its code.
+		const size_t code_size = block.code.size();
+		const bool valid =
+			std::all_of(block.relocations.begin(), block.relocations.end(), [code_size](const Relocation& reloc) {
+				const size_t field_size = (reloc.type == RelocationType::Abs64) ? sizeof(u64) : sizeof(s32);
+				return (reloc.type == RelocationType::Rel32 || reloc.type == RelocationType::Abs64) &&
+					   reloc.base <= RelocationBase::Executable && reloc.offset <= code_size &&
+					   field_size <= (code_size - reloc.offset);
+			}) &&
+			std::all_of(block.links.begin(), block.links.end(),
+				[code_size](const BlockLink& link) { return link.offset <= code_size && sizeof(s32) <= (code_size - link.offset); }) &&
+			std::all_of(block.loadstores.begin(), block.loadstores.end(),
+				[code_size](const BlockLoadStore& ls) { return ls.offset < code_size; });
+		if (!valid)
+		{
+			Console.Warning("EE code cache: '%s' is corrupted, discarding.", Path::GetFileName(s_path).data());
+			return false;
+		}
+
+		block.startpc = bheader.startpc;
+		block.size = bheader.size;
+		block.guest_hash = bheader.guest_hash;
+		block.protection = bheader.protection;
+		s_blocks[block.startpc].push_back(std::move(block));
+	}
+
+	return true;
+}
+
+bool EERecCodeCache::SaveFile()
+{
+	std::vector<u8> data;
+	const auto write = [&data](const void* src, size_t size) {
+		const u8* bytes = static_cast<const u8*>(src);
+		data.insert(data.end(), bytes, bytes + size);
+	};
+
+	CacheHeader header = {};
+	header.signature = CACHE_SIGNATURE;
+	header.version = CACHE_VERSION;
+	header.config_hash = s_config_hash;
+	for (const auto& it : s_blocks)
+		header.num_blocks += static_cast<u32>(it.second.size());
+	write(&header, sizeof(header));
+
+	for (const auto& it : s_blocks)
+	{
+		for (const Block& block : it.second)
+		{
+			BlockHeader bheader = {};
+			bheader.startpc = block.startpc;
+			bheader.size = block.size;
+			bheader.guest_hash = block.guest_hash;
+			bheader.code_size = static_cast<u32>(block.code.size());
+			bheader.num_relocations = static_cast<u32>(block.relocations.size());
+			bheader.num_links = static_cast<u32>(block.links.size());
+			bheader.num_loadstores = static_cast<u32>(block.loadstores.size());
+			bheader.protection = block.protection;
+			write(&bheader, sizeof(bheader));
+			write(block.code.data(), block.code.size());
+			write(block.relocations.data(), block.relocations.size() * sizeof(Relocation));
+			write(block.links.data(), block.links.size() * sizeof(BlockLink));
+			write(block.loadstores.data(), block.loadstores.size() * sizeof(BlockLoadStore));
+		}
+	}
+
+	return FileSystem::WriteBinaryFile(s_path.c_str(), data.data(), data.size());
+}
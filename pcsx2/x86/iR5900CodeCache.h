@@ -0,0 +1,105 @@
+// SPDX-FileCopyrightText: 2002-2024 PCSX2 Dev Team
+// SPDX-License-Identifier: GPL-3.0+
+
+#pragma once
+
+#include "vtlb.h"
+
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------------------------------------
+//  EERecCodeCache
+// --------------------------------------------------------------------------------------
+// Persistent, per-game cache of recompiled EE blocks. Each block is stored together with
+// the relocations needed to move it to a different location in the code buffer (and to a
+// different process, where the executable and memory regions may be mapped elsewhere),
+// and is looked up by the hash of the guest code it was compiled from. The cache is only
+// valid for a given build and configuration; the file is discarded if either changes.
+//
+namespace EERecCodeCache
+{
+	/// Page protection scheme a block was compiled under. Manual protection emits integrity
+	/// checks into the block itself, so a cached block can only be reused under the same scheme.
+	enum class BlockProtection : u8
+	{
+		NotRequired,
+		Counted,
+		ManualCounted,
+		ManualUncounted,
+	};
+
+	/// Jump from a block to the start of another block, managed by BaseBlocks::Link().
+	struct BlockLink
+	{
+		u32 offset; // offset of the rel32 field within the block's code
+		u32 target_pc; // HW address of the target block
+	};
+
+	struct BlockLoadStore
+	{
+		u32 offset; // offset of the fastmem access within the block's code
+		LoadstoreBackpatchInfo info;
+	};
+
+	enum class RelocationBase : u8
+	{
+		Dispatchers, // EE dispatchers at the start of the recompiler code buffer
+		DataMemory, // SysMemory data (guest memory, vtlb maps)
+		Executable, // statics and functions in the PCSX2 image
+	};
+
+	enum class RelocationType : u8
+	{
+		Rel32,
+		Abs64,
+	};
+
+	struct Relocation
+	{
+		u32 offset; // offset of the field within the block's code
+		RelocationType type;
+		RelocationBase base;
+		u8 ip_delta; // for Rel32, distance from the field to the end of the instruction
+		s64 target; // target address, relative to the base
+	};
+
+	struct Block
+	{
+		u32 startpc;
+		u32 size; // in instructions
+		u64 guest_hash;
+		BlockProtection protection;
+		std::vector<u8> code;
+		std::vector<Relocation> relocations;
+		std::vector<BlockLink> links;
+		std::vector<BlockLoadStore> loadstores;
+	};
+
+	/// Opens (or keeps open) the cache for the specified game. Any previously open cache for a
+	/// different game or configuration is written back first.
+	void Open(const std::string& serial, u32 crc, const u8* dispatchers_start, const u8* dispatchers_end);
+
+	/// Writes the cache back to disk if it has new blocks, logs statistics, and releases it.
+	void Close();
+
+	bool IsOpen();
+
+	/// Returns a cached block starting at startpc whose guest code matches the current memory
+	/// contents at guest_code, or nullptr if there is none.
+	const Block* Lookup(u32 startpc, const void* guest_code);
+
+	/// Copies a cached block to dest, and applies its relocations. Links and fastmem info are
+	/// the caller's responsibility. Returns false if the block cannot be placed at dest.
+	bool Relocate(const Block& block, u8* dest);
+
+	/// Captures a freshly compiled block. address_tags holds the 64-bit immediates which were emitted as
+	/// host addresses (see x86AddressTags), every other immediate is kept as it is. Blocks referencing host
+	/// memory that cannot be relocated (e.g. heap allocations, absolute addresses) are not cached.
+	void Record(u32 startpc, u32 size, const void* guest_code, BlockProtection protection, const u8* code, u32 code_size,
+		const std::vector<BlockLink>& links, const std::vector<u8*>& address_tags);
+
+	/// Statistics, reported when the cache is closed.
+	void AddHit(u64 install_ticks);
+	void AddMiss(u64 compile_ticks);
+} // namespace EERecCodeCache
@@ -4,6 +4,7 @@
 #include "Common.h"
 #include "CDVD/CDVD.h"
 #include "DebugTools/Breakpoints.h"
+#include "DebugTools/SymbolGuardian.h"
 #include "Elfheader.h"
 #include "GS.h"
 #include "Memory.h"
@@ -15,11 +16,13 @@
 #include "x86/BaseblockEx.h"
 #include "x86/iR5900.h"
 #include "x86/iR5900Analysis.h"
+#include "x86/iR5900CodeCache.h"
 
 #include "common/AlignedMalloc.h"
 #include "common/FastJmp.h"
 #include "common/HeapArray.h"
 #include "common/Perf.h"
+#include "common/Timer.h"
 
 // Only for MOVQ workaround.
 #include "common/emitter/internal.h"
@@ -37,6 +40,10 @@
 #include <zlib.h>
 #endif
 
+#include <bit>
+#include <unordered_map>
+#include <unordered_set>
+
 using namespace x86Emitter;
 using namespace R5900;
 
@@ -63,6 +70,7 @@ u32 g_cpuHasConstReg = 0, g_cpuFlushedConstReg = 0;
 bool g_cpuFlushedPC, g_cpuFlushedCode, g_recompilingDelaySlot, g_maySignalException;
 
 eeProfiler EE::Profiler;
+eeBlockProfiler EE::BlockProfiler;
 
 ////////////////////////////////////////////////////////////////
 // Static Private Variables - R5900 Dynarec
@@ -80,6 +88,7 @@ static BASEBLOCK* recROM1 = nullptr; // also here
 static BASEBLOCK* recROM2 = nullptr; // also here
 
 static BaseBlocks recBlocks;
+static RecCodeRegions s_codeRegions;
 static u8* recPtr = nullptr;
 static u8* recPtrEnd = nullptr;
 EEINST* s_pInstCache = nullptr;
@@ -90,6 +99,7 @@ static BASEBLOCKEX* s_pCurBlockEx = nullptr;
 u32 s_nEndBlock = 0; // what pc the current block ends
 u32 s_branchTo;
 static bool s_nBlockFF;
+static u32 s_nBlockFFPC; // branch target which stays in the idle loop when s_nBlockFF is set
 
 // save states for branches
 GPR_reg64 s_saveConstRegs[32];
@@ -98,11 +108,69 @@ static EEINST* s_psaveInstInfo = nullptr;
 
 static u32 s_savenBlockCycles = 0;
 
+// Links emitted by the current block, kept so they can be re-established when the block is loaded from the code cache.
+static std::vector<EERecCodeCache::BlockLink> s_blockLinks;
+static std::vector<u8*> s_blockAddressTags;
+
+// Superblock mode: profile of the block being compiled in the profiling tier, or the branches a superblock
+// carries on past (identified by their fall-through pc) when building one.
+static constexpr u32 MAX_SUPERBLOCK_BRANCHES = 8;
+static eeBlockProfile* s_pCurBlockProfile = nullptr;
+static u32 s_superblockStart = 0;
+static u32 s_superblockExits[MAX_SUPERBLOCK_BRANCHES];
+static u32 s_numSuperblockExits = 0;
+
+// Cross-block analysis (see CrossBlockPass) is usable for the current block.
+static bool s_crossBlockAnalysis = false;
+static u32 s_crossBlockPage = 0;
+
+// Blocks whose entry constants turned out to be wrong, which get compiled without them.
+static std::unordered_set<u32> s_entryConstantMisses;
+
+static struct
+{
+	u32 discarded_writebacks;
+	u32 seeded_blocks;
+	u32 seeded_constants;
+	u32 constant_misses;
+} s_crossBlockStats;
+
+// Interpreter tier: blocks are interpreted until they've been entered INTERPRETER_TIER_THRESHOLD times, so code
+// which only runs a few times (e.g. while loading) doesn't stall on the recompiler.
+static constexpr u32 INTERPRETER_TIER_THRESHOLD = 16;
+static constexpr u32 INTERPRETER_TIER_MAX_INSTS = 256;
+static std::unordered_map<u32, u32> s_pendingBlocks;
+static bool s_interpreterTierActive = false;
+
+static struct
+{
+	u64 interpreted_insts;
+	u32 interpreted_runs;
+	u32 tiered_compiles;
+	u32 max_pending;
+} s_interpreterTierStats;
+
+// Idle loops detected for the WaitLoop speedhack, and the cycles skipped by fast-forwarding them to the next event.
+static struct
+{
+	u32 loops;
+	u64 fast_forwards;
+	u64 skipped_cycles;
+} s_idleLoopStats;
+
 static void iBranchTest(u32 newpc = 0xffffffff);
 static void ClearRecLUT(BASEBLOCK* base, int count);
 static u32 scaleblockcycles();
 static void recExitExecution();
 
+static void recLinkBlock(u32 pc, s32* jumpptr)
+{
+	if (const BASEBLOCKEX* target = recBlocks.Link(pc, jumpptr))
+		s_codeRegions.Touch(target->fnptr);
+
+	s_blockLinks.push_back({static_cast<u32>(reinterpret_cast<uptr>(jumpptr) - s_pCurBlockEx->fnptr), pc});
+}
+
 #ifdef TRACE_BLOCKS
 static void pauseAAA()
 {
@@ -230,6 +298,46 @@ void _eeFlushAllDirty()
 	_flushConstRegs();
 }
 
+// Forgets that the GPRs in mask are dirty, so they don't get written back. Only for registers which are
+// overwritten before they're read again. GPRs in xmm registers are left alone, since the upper half may
+// still be live after a 64-bit write.
+static void _eeDiscardDeadGPRs(u32 mask)
+{
+	if (mask == 0)
+		return;
+
+	for (u32 i = 0; i < iREGCNT_GPR; i++)
+	{
+		if (x86regs[i].inuse && x86regs[i].type == X86TYPE_GPR && x86regs[i].reg < 32 && (mask & (1u << x86regs[i].reg)) &&
+			(x86regs[i].mode & MODE_WRITE))
+		{
+			x86regs[i].mode &= ~MODE_WRITE;
+			s_crossBlockStats.discarded_writebacks++;
+		}
+	}
+
+	const u32 dirty_consts = g_cpuHasConstReg & ~g_cpuFlushedConstReg & mask;
+	g_cpuFlushedConstReg |= dirty_consts;
+	s_crossBlockStats.discarded_writebacks += std::popcount(dirty_consts);
+}
+
+// Drops writebacks of GPRs which the code at target overwrites before reading. Only valid for targets in the
+// same page as the block, since the block has to be cleared if they change.
+static void recDiscardDeadGPRsAt(u32 target)
+{
+	if (!s_crossBlockAnalysis || (target & ~0xfffu) != s_crossBlockPage)
+		return;
+
+	// The EELOAD hooks read arguments from the registers.
+	if (HWADDR(target) == EELOAD_START || (g_eeloadMain && HWADDR(target) == HWADDR(g_eeloadMain)) ||
+		(g_eeloadExec && HWADDR(target) == HWADDR(g_eeloadExec)))
+	{
+		return;
+	}
+
+	_eeDiscardDeadGPRs(CrossBlockPass::GetDeadGPRs(target));
+}
+
 void _eeMoveGPRtoR(const xRegister32& to, int fromgpr, bool allow_preload)
 {
 	if (fromgpr == 0)
@@ -344,8 +452,11 @@ void recCall(void (*func)())
 // =====================================================================================================
 
 static void recRecompile(const u32 startpc);
+static void recCompileOrInterpret(const u32 startpc);
 static void dyna_block_discard(u32 start, u32 sz);
 static void dyna_page_reset(u32 start, u32 sz);
+static void recPromoteBlock(u32 index);
+static void recEntryConstantMiss(u32 startpc);
 
 static const void* DispatcherEvent = nullptr;
 static const void* DispatcherReg = nullptr;
@@ -354,6 +465,8 @@ static const void* JITCompileInBlock = nullptr;
 static const void* EnterRecompiledCode = nullptr;
 static const void* DispatchBlockDiscard = nullptr;
 static const void* DispatchPageReset = nullptr;
+static const void* DispatchPromoteBlock = nullptr;
+static const void* DispatchEntryConstantMiss = nullptr;
 
 static void recEventTest()
 {
@@ -366,7 +479,7 @@ static void recEventTest()
 	}
 }
 
-// The address for all cleared blocks.  It recompiles the current pc and then
+// The address for all cleared blocks.  It recompiles (or interprets) the current pc and then
 // dispatches to the recompiled block address.
 static const void* _DynGen_JITCompile()
 {
@@ -374,7 +487,7 @@ static const void* _DynGen_JITCompile()
 
 	u8* retval = xGetAlignedCallTarget();
 
-	xFastCall((const void*)recRecompile, ptr32[&cpuRegs.pc]);
+	xFastCall((const void*)recCompileOrInterpret, ptr32[&cpuRegs.pc]);
 
 	// C equivalent:
 	// u32 addr = cpuRegs.pc;
@@ -469,6 +582,22 @@ static const void* _DynGen_DispatchPageReset()
 	return retval;
 }
 
+static const void* _DynGen_DispatchPromoteBlock()
+{
+	u8* retval = xGetPtr();
+	xFastCall((const void*)recPromoteBlock);
+	xJMP(DispatcherReg);
+	return retval;
+}
+
+static const void* _DynGen_DispatchEntryConstantMiss()
+{
+	u8* retval = xGetPtr();
+	xFastCall((const void*)recEntryConstantMiss);
+	xJMP(DispatcherReg);
+	return retval;
+}
+
 static void _DynGen_Dispatchers()
 {
 	const u8* start = xGetAlignedCallTarget();
@@ -483,6 +612,8 @@ static void _DynGen_Dispatchers()
 	EnterRecompiledCode = _DynGen_EnterRecompiledCode();
 	DispatchBlockDiscard = _DynGen_DispatchBlockDiscard();
 	DispatchPageReset = _DynGen_DispatchPageReset();
+	DispatchPromoteBlock = _DynGen_DispatchPromoteBlock();
+	DispatchEntryConstantMiss = _DynGen_DispatchEntryConstantMiss();
 
 	recBlocks.SetJITCompile(JITCompile);
 
@@ -556,11 +687,25 @@ static void recReserveRAM()
 	}
 }
 
+// Names blocks after the guest function containing them in perf/VTune. Symbols are skipped rather than waited
+// for while they're being imported.
+static bool recPerfResolvePC(u32 pc, std::string* function, u32* offset)
+{
+	const std::optional<FunctionInfo> info = R5900SymbolGuardian.TryFunctionOverlappingAddress(pc);
+	if (!info.has_value() || info->name.empty())
+		return false;
+
+	*function = info->name;
+	*offset = pc - info->address.value;
+	return true;
+}
+
 static void recReserve()
 {
 	recPtr = SysMemory::GetEERec();
 	recPtrEnd = SysMemory::GetEERecEnd() - _64kb;
 	recReserveRAM();
+	Perf::ee.SetPCResolver(recPerfResolvePC);
 
 	pxAssertRel(!s_pInstCache, "InstCache not allocated");
 	s_nInstCacheSize = 128;
@@ -572,6 +717,50 @@ static void recReserve()
 alignas(16) static u16 manual_page[Ps2MemSize::TotalRam >> 12];
 alignas(16) static u8 manual_counter[Ps2MemSize::TotalRam >> 12];
 
+// Sub-page SMC tracking: pages with blocks which rely on vtlb write protection. A write to one of these pages
+// only clears the blocks near it (see mmap_ClearCpuBlock), the rest get guarded by an integrity check.
+alignas(16) static u8 s_countedPage[Ps2MemSize::TotalRam >> 12];
+
+struct GuardedBlock
+{
+	uptr guard; // the check, which the block's fnptr now points to
+	uptr body; // the block's original code
+};
+static std::unordered_map<u32, GuardedBlock> s_guardedBlocks;
+
+struct SubPageSMCStats
+{
+	u32 writes;
+	u32 cleared_blocks;
+	u32 guarded_blocks;
+};
+static std::unordered_map<u32, SubPageSMCStats> s_subPageSMCStats;
+
+static void recPrintSubPageSMCStats()
+{
+	if (s_subPageSMCStats.empty())
+		return;
+
+	std::vector<std::pair<u32, SubPageSMCStats>> pages(s_subPageSMCStats.begin(), s_subPageSMCStats.end());
+	std::sort(pages.begin(), pages.end(), [](const auto& lhs, const auto& rhs) { return lhs.second.writes > rhs.second.writes; });
+
+	SubPageSMCStats total = {};
+	for (const auto& [page, stats] : pages)
+	{
+		total.writes += stats.writes;
+		total.cleared_blocks += stats.cleared_blocks;
+		total.guarded_blocks += stats.guarded_blocks;
+	}
+
+	DevCon.WriteLn("EE sub-page SMC: %u writes to code in %zu pages, %u blocks cleared, %u blocks guarded", total.writes,
+		pages.size(), total.cleared_blocks, total.guarded_blocks);
+	for (size_t i = 0; i < std::min<size_t>(pages.size(), 8); i++)
+	{
+		DevCon.WriteLn("  page 0x%05X: %u writes, %u blocks cleared, %u blocks guarded", pages[i].first >> 12,
+			pages[i].second.writes, pages[i].second.cleared_blocks, pages[i].second.guarded_blocks);
+	}
+}
+
 ////////////////////////////////////////////////////
 static void recResetRaw()
 {
@@ -584,11 +773,62 @@ static void recResetRaw()
 	}
 
 	EE::Profiler.Reset();
+	EE::BlockProfiler.Print();
+	EE::BlockProfiler.Reset();
+
+	if (s_crossBlockStats.seeded_blocks > 0 || s_crossBlockStats.discarded_writebacks > 0)
+	{
+		DevCon.WriteLn("EE cross-block analysis: %u writebacks skipped, %u entry constants in %u blocks, %u constant misses",
+			s_crossBlockStats.discarded_writebacks, s_crossBlockStats.seeded_constants, s_crossBlockStats.seeded_blocks,
+			s_crossBlockStats.constant_misses);
+	}
+	s_crossBlockStats = {};
+	s_entryConstantMisses.clear();
+
+	if (s_interpreterTierStats.interpreted_runs > 0)
+	{
+		DevCon.WriteLn("EE interpreter tier: %llu instructions in %u runs, %u blocks compiled, %u pending (max %u)",
+			static_cast<unsigned long long>(s_interpreterTierStats.interpreted_insts), s_interpreterTierStats.interpreted_runs,
+			s_interpreterTierStats.tiered_compiles, static_cast<u32>(s_pendingBlocks.size()), s_interpreterTierStats.max_pending);
+	}
+	s_interpreterTierStats = {};
+	s_pendingBlocks.clear();
+
+	if (s_idleLoopStats.fast_forwards > 0)
+	{
+		DevCon.WriteLn("EE idle loops: %u detected, %llu fast-forwards skipping %llu cycles",
+			s_idleLoopStats.loops, static_cast<unsigned long long>(s_idleLoopStats.fast_forwards),
+			static_cast<unsigned long long>(s_idleLoopStats.skipped_cycles));
+	}
+	s_idleLoopStats = {};
+
+	recPrintSubPageSMCStats();
+	s_subPageSMCStats.clear();
+	s_guardedBlocks.clear();
+	std::memset(s_countedPage, 0, sizeof(s_countedPage));
+
+	if (recPtr && s_codeRegions.GetStats().evictions > 0)
+	{
+		const RecCodeRegions::Stats& stats = s_codeRegions.GetStats();
+		DevCon.WriteLn("EE code buffer: %.1f%% full, %llu evictions (%llu blocks, %llu KB), %llu blocks (%llu KB) recompiled after eviction",
+			s_codeRegions.GetFullness(recPtr) * 100.0f, static_cast<unsigned long long>(stats.evictions),
+			static_cast<unsigned long long>(stats.evicted_blocks), static_cast<unsigned long long>(stats.evicted_bytes / 1024),
+			static_cast<unsigned long long>(stats.recompiled_blocks), static_cast<unsigned long long>(stats.recompiled_bytes / 1024));
+	}
 
 	xSetPtr(SysMemory::GetEERec());
 	_DynGen_Dispatchers();
 	vtlb_DynGenDispatchers();
 	recPtr = xGetPtr();
+	s_codeRegions.Reset(recPtr, SysMemory::GetEERecEnd(), _64kb);
+
+	// Blocks are only cached once a game is running, since the BIOS gets compiled with hooks.
+	const std::string serial = VMManager::GetDiscSerial();
+	const u32 crc = VMManager::GetCurrentCRC();
+	if (EmuConfig.Cpu.Recompiler.EnableEECodeCache && !serial.empty() && crc != 0)
+		EERecCodeCache::Open(serial, crc, SysMemory::GetEERec(), recPtr);
+	else
+		EERecCodeCache::Close();
 
 	ClearRecLUT(reinterpret_cast<BASEBLOCK*>(recLutReserve_RAM.data()), recLutSize);
 	recRAMCopy.fill(0);
@@ -607,6 +847,8 @@ static void recResetRaw()
 
 void recShutdown()
 {
+	EERecCodeCache::Close();
+
 	recRAMCopy.deallocate();
 	recLutReserve_RAM.deallocate();
 
@@ -671,6 +913,10 @@ static void recResetEE()
 
 static void recCancelInstruction()
 {
+	// Code run through the interpreter tier can raise exceptions which cancel the instruction.
+	if (s_interpreterTierActive)
+		intCancelForRecompiler();
+
 	pxFailRel("recCancelInstruction() called, this should never happen!");
 }
 
@@ -698,6 +944,13 @@ static void recExecute()
 
 	eeCpuExecuting = false;
 
+	// Exiting execution (TLB miss pauses, breakpoints, VM stop) can jump out from the middle of an interpreted run.
+	if (s_interpreterTierActive)
+	{
+		s_interpreterTierActive = false;
+		intAbortForRecompiler();
+	}
+
 	EE::Profiler.Print();
 }
 
@@ -730,12 +983,8 @@ void R5900::Dynarec::OpcodeImpl::recBREAK()
 }
 
 // Size is in dwords (4 bytes)
-void recClear(u32 addr, u32 size)
+static void recClearBlocksLinear(u32 addr, u32 size)
 {
-	if ((addr) >= maxrecmem || !(recLUT[(addr) >> 16] + (addr & ~0xFFFFUL)))
-		return;
-	addr = HWADDR(addr);
-
 	int blockidx = recBlocks.LastIndex(addr + size * 4 - 4);
 
 	if (blockidx == -1)
@@ -803,6 +1052,206 @@ void recClear(u32 addr, u32 size)
 		ClearRecLUT(PC_GETBLOCK(lowerextent), upperextent - lowerextent);
 }
 
+// Size is in dwords (4 bytes)
+static void recClearBlocksOverlapping(u32 addr, u32 size)
+{
+	if (recBlocks.LastIndex(addr + size * 4 - 4) == -1)
+		return;
+
+	// Superblocks overlap the blocks compiled for pcs inside them, which can end before or after the
+	// superblock does. So grow the range until it covers every block that overlaps it, then remove
+	// every block starting inside it; whatever's left can't overlap anything that was removed.
+	// Blocks stop at page boundaries, but a branch in the last word of a page takes its delay slot
+	// from the next one, so blocks overlapping the lower extent start in its page or the one before.
+	u32 lowerextent = addr, upperextent = addr + size * 4;
+	bool overlapping = false;
+	BASEBLOCKEX* pexblock;
+
+	for (bool grown = true; grown;)
+	{
+		grown = false;
+
+		for (int i = recBlocks.LastIndex(upperextent - 4); (pexblock = recBlocks[i]); i--)
+		{
+			const u32 blockstart = pexblock->startpc;
+			const u32 blockend = pexblock->startpc + pexblock->size * 4;
+			if (lowerextent >= 4 && blockstart < ((lowerextent - 4) & ~0xfffu))
+				break;
+
+			if (PC_GETBLOCK(blockstart) == s_pCurBlock || (blockstart < lowerextent && blockend <= lowerextent))
+				continue;
+
+			overlapping = true;
+			lowerextent = std::min(lowerextent, blockstart);
+			if (blockend > upperextent)
+			{
+				upperextent = blockend;
+				grown = true;
+			}
+		}
+	}
+
+	if (overlapping)
+	{
+		int blockidx = recBlocks.LastIndex(upperextent - 4);
+		int toRemoveLast = blockidx;
+
+		while ((pexblock = recBlocks[blockidx]) && pexblock->startpc >= lowerextent)
+		{
+			if (PC_GETBLOCK(pexblock->startpc) == s_pCurBlock)
+			{
+				if (toRemoveLast != blockidx)
+				{
+					recBlocks.Remove((blockidx + 1), toRemoveLast);
+				}
+				toRemoveLast = --blockidx;
+				continue;
+			}
+
+			blockidx--;
+		}
+
+		if (toRemoveLast != blockidx)
+		{
+			recBlocks.Remove((blockidx + 1), toRemoveLast);
+		}
+	}
+
+	for (int i = 0; (pexblock = recBlocks[i]); i++)
+	{
+		if (s_pCurBlock == PC_GETBLOCK(pexblock->startpc))
+			continue;
+		u32 blockend = pexblock->startpc + pexblock->size * 4;
+		if ((pexblock->startpc >= addr && pexblock->startpc < addr + size * 4) || (pexblock->startpc < addr && blockend > addr)) [[unlikely]]
+		{
+			Console.Error("[EE] Impossible block clearing failure");
+			pxFail("[EE] Impossible block clearing failure");
+		}
+	}
+
+	if (overlapping)
+		ClearRecLUT(PC_GETBLOCK(lowerextent), upperextent - lowerextent);
+}
+
+// Size is in dwords (4 bytes)
+static void recClearBlocks(u32 addr, u32 size)
+{
+	if ((addr) >= maxrecmem || !(recLUT[(addr) >> 16] + (addr & ~0xFFFFUL)))
+		return;
+	addr = HWADDR(addr);
+
+	// Without superblocks blocks can't overlap each other, so the cheaper scan is enough.
+	if (EmuConfig.Cpu.Recompiler.EnableEESuperblocks)
+		recClearBlocksOverlapping(addr, size);
+	else
+		recClearBlocksLinear(addr, size);
+}
+
+// Called after a write to a page under vtlb protection cleared the blocks around it. The page is writable now,
+// so each remaining block gets a check in front of it, the same one manual blocks have. If any of them can't
+// be guarded, the whole page is cleared like it would have been without sub-page tracking.
+static void recGuardCountedBlocks(u32 page, u32 cleared_blocks)
+{
+	SubPageSMCStats& stats = s_subPageSMCStats[page];
+	stats.writes++;
+	stats.cleared_blocks += cleared_blocks;
+
+	// Blocks starting in the previous page can run into this one (see recClearBlocksOverlapping()), so they
+	// need guarding too. Blocks between them which end before the page are skipped.
+	const auto overlaps_page = [page](const BASEBLOCKEX* block) { return (block->startpc + block->size * 4) > page; };
+	const u32 lowest_start = (page != 0) ? (page - 0x1000) : 0;
+	const int last = recBlocks.LastIndex(page + 0xffc);
+	int first = last + 1;
+	for (int i = last; i >= 0 && recBlocks[i]->startpc >= lowest_start; i--)
+	{
+		if (overlaps_page(recBlocks[i]))
+			first = i;
+	}
+	if (last < 0 || first > last)
+		return;
+
+	// Blocks compiled with cross-block analysis depend on code elsewhere in the page, which may have just changed.
+	u32 guard_size = 0;
+	for (int i = first; i <= last; i++)
+	{
+		if (overlaps_page(recBlocks[i]))
+			guard_size += 32 + recBlocks[i]->size * 16;
+	}
+
+	const bool fits = EmuConfig.Cpu.Recompiler.EnableCodeEviction ? !s_codeRegions.IsFull(recPtr + guard_size) :
+																	 (recPtr + guard_size) < recPtrEnd;
+	if (EmuConfig.Cpu.Recompiler.EnableEECrossBlockAnalysis || !fits || s_pCurBlock)
+	{
+		const int before = recBlocks.LastIndex(0xffffffff);
+		recClearBlocks(page, 0x400);
+		stats.cleared_blocks += before - recBlocks.LastIndex(0xffffffff);
+		return;
+	}
+
+	const bool counted = manual_counter[page >> 12] <= 3;
+	xSetPtr(recPtr);
+	for (int i = first; i <= last; i++)
+	{
+		BASEBLOCKEX* block = recBlocks[i];
+		if (!overlaps_page(block))
+			continue;
+
+		u8* guard = xGetAlignedCallTarget();
+
+		xMOV(arg1regd, block->startpc);
+		xMOV(arg2regd, block->size);
+		for (u32 lpc = block->startpc; lpc < block->startpc + block->size * 4; lpc += 4)
+		{
+			xCMP(ptr32[PSM(lpc)], *(u32*)PSM(lpc));
+			xJNE(DispatchBlockDiscard);
+		}
+
+		if (counted)
+		{
+			xADD(ptr16[&manual_page[page >> 12]], block->size);
+			xJC(DispatchPageReset);
+		}
+
+		xJMP((void*)block->fnptr);
+
+		BASEBLOCK* pblock = PC_GETBLOCK(block->startpc);
+		if (pblock->GetFnptr() == block->fnptr)
+			pblock->SetFnptr((uptr)guard);
+
+		s_guardedBlocks[block->startpc] = {(uptr)guard, block->fnptr};
+		recBlocks.Retarget(block, (uptr)guard);
+		Perf::ee.RegisterPC(guard, static_cast<u32>(xGetPtr() - guard), block->startpc);
+		stats.guarded_blocks++;
+	}
+
+	recPtr = xGetPtr();
+}
+
+// Size is in dwords (4 bytes)
+void recClear(u32 addr, u32 size)
+{
+	if (!EmuConfig.Cpu.Recompiler.EnableEESubPageSMC)
+	{
+		recClearBlocks(addr, size);
+		return;
+	}
+
+	const u32 page = HWADDR(addr) & ~0xfffu;
+	const u32 page_index = page >> 12;
+	if (addr >= maxrecmem || page_index >= std::size(s_countedPage) || !s_countedPage[page_index] ||
+		mmap_GetRamPageInfo(page) != ProtMode_Manual)
+	{
+		recClearBlocks(addr, size);
+		return;
+	}
+
+	// Counted blocks in a page which has gone manual means a write hit the page, see mmap_ClearCpuBlock().
+	s_countedPage[page_index] = 0;
+
+	const int before = recBlocks.LastIndex(0xffffffff);
+	recClearBlocks(addr, size);
+	recGuardCountedBlocks(page, static_cast<u32>(before - recBlocks.LastIndex(0xffffffff)));
+}
 
 static int* s_pCode;
 
@@ -879,14 +1328,38 @@ void SetBranchReg(u32 reg)
 	iBranchTest();
 }
 
+static bool recIsSuperblockExit(u32 fallthroughpc)
+{
+	for (u32 i = 0; i < s_numSuperblockExits; i++)
+	{
+		if (s_superblockExits[i] == fallthroughpc)
+			return true;
+	}
+
+	return false;
+}
+
 void SetBranchImm(u32 imm)
 {
+	// Superblocks carry on into the fall-through side of the branches they were built across, with
+	// the constants and register state of the not-taken path. Likely branches skip the delay slot,
+	// so resync the instruction info with pc.
+	if (imm == pc && pc < s_nEndBlock && recIsSuperblockExit(imm))
+	{
+		g_branch = 0;
+		g_pCurInstInfo = s_pInstCache + (pc - s_superblockStart) / 4;
+		return;
+	}
+
 	g_branch = 1;
 
 	pxAssert(imm);
 
 	// end the current block
+	recDiscardDeadGPRsAt(imm);
 	iFlushCall(FLUSH_EVERYTHING);
+	if (s_pCurBlockProfile)
+		xADD(ptr32[(imm == s_nEndBlock) ? &s_pCurBlockProfile->fallthrough : &s_pCurBlockProfile->taken], 1);
 	xMOV(ptr32[&cpuRegs.pc], imm);
 	iBranchTest(imm);
 }
@@ -1366,14 +1839,19 @@ static void iBranchTest(u32 newpc)
 	//    cpuRegs.cycle += blockcycles;
 	//    if( cpuRegs.cycle > g_nextEventCycle ) { DoEvents(); }
 
-	if (EmuConfig.Speedhacks.WaitLoop && s_nBlockFF && newpc == s_branchTo)
+	if (EmuConfig.Speedhacks.WaitLoop && s_nBlockFF && newpc == s_nBlockFFPC)
 	{
 		xMOV(eax, ptr32[&cpuRegs.nextEventCycle]);
-		xADD(ptr32[&cpuRegs.cycle], scaleblockcycles());
-		xCMP(eax, ptr32[&cpuRegs.cycle]);
-		xCMOVS(eax, ptr32[&cpuRegs.cycle]);
+		xMOV(ecx, ptr32[&cpuRegs.cycle]);
+		xADD(ecx, scaleblockcycles());
+		xCMP(eax, ecx);
+		xCMOVS(eax, ecx);
 		xMOV(ptr32[&cpuRegs.cycle], eax);
 
+		xSUB(eax, ecx);
+		xADD(ptr64[&s_idleLoopStats.skipped_cycles], rax);
+		xADD(ptr64[&s_idleLoopStats.fast_forwards], 1);
+
 		xJMP((void*)DispatcherEvent);
 	}
 	else
@@ -1386,7 +1864,7 @@ static void iBranchTest(u32 newpc)
 		if (newpc == 0xffffffff)
 			xJS(DispatcherReg);
 		else
-			recBlocks.Link(HWADDR(newpc), xJcc32(Jcc_Signed));
+			recLinkBlock(HWADDR(newpc), xJcc32(Jcc_Signed));
 
 		xJMP((void*)DispatcherEvent);
 	}
@@ -1741,6 +2219,10 @@ void recompileNextInstruction(bool delayslot, bool swapped_delay_slot)
 		_flushCOP2regs();
 	}
 
+	// Branches flush everything before they compare, registers which are dead on both sides can be skipped.
+	if (s_crossBlockAnalysis && !delayslot)
+		_eeDiscardDeadGPRs(CrossBlockPass::GetDeadGPRsAtBranch(pc - 4));
+
 	const OPCODE& opcode = GetCurrentInstruction();
 
 	//pxAssert( !(g_pCurInstInfo->info & EEINSTINFO_NOREC) );
@@ -2009,10 +2491,30 @@ void dyna_page_reset(u32 start, u32 sz)
 	mmap_MarkCountedRamPage(start);
 }
 
-static void memory_protect_recompiled_code(u32 startpc, u32 size)
+// Called from the profiling tier of superblock mode once a block has been entered enough times.
+// The block is thrown away, and gets rebuilt as a superblock the next time it's dispatched to.
+void recPromoteBlock(u32 index)
 {
-	u32 inpage_ptr = HWADDR(startpc);
-	const u32 inpage_sz = size * 4;
+	const eeBlockProfile& prof = EE::BlockProfiler.blocks[index];
+	eeRecPerfLog.Write("Promoting block @ 0x%08X : fallthrough=%u taken=%u", prof.startpc, prof.fallthrough, prof.taken);
+
+	EE::BlockProfiler.Promote(index);
+	recClear(prof.startpc, 1);
+}
+
+// Called when a block's entry constants don't match the registers. It gets recompiled without them.
+void recEntryConstantMiss(u32 startpc)
+{
+	eeRecPerfLog.Write("Entry constant miss @ 0x%08X", startpc);
+
+	s_entryConstantMisses.insert(startpc);
+	s_crossBlockStats.constant_misses++;
+	recClear(startpc, 1);
+}
+
+static EERecCodeCache::BlockProtection recGetBlockProtection(u32 startpc)
+{
+	const u32 inpage_ptr = HWADDR(startpc);
 
 	// The kernel context register is stored @ 0x800010C0-0x80001300
 	// The EENULL thread context register is stored @ 0x81000-....
@@ -2024,15 +2526,46 @@ static void memory_protect_recompiled_code(u32 startpc, u32 size)
 	switch (PageType)
 	{
 		case ProtMode_NotRequired:
-			break;
+			return EERecCodeCache::BlockProtection::NotRequired;
 
 		case ProtMode_None:
 		case ProtMode_Write:
+			return EERecCodeCache::BlockProtection::Counted;
+
+		case ProtMode_Manual:
+		default:
+			// Tweakpoint!  3 is a 'magic' number representing the number of times a counted block
+			// is re-protected before the recompiler gives up and sets it up as an uncounted (permanent)
+			// manual block.  Higher thresholds result in more recompilations for blocks that share code
+			// and data on the same page.  Side effects of a lower threshold: over extended gameplay
+			// with several map changes, a game's overall performance could degrade.
+
+			// (ideally, perhaps, manual_counter should be reset to 0 every few minutes?)
+			return (!contains_thread_stack && manual_counter[inpage_ptr >> 12] <= 3) ?
+					   EERecCodeCache::BlockProtection::ManualCounted :
+					   EERecCodeCache::BlockProtection::ManualUncounted;
+	}
+}
+
+static void memory_protect_recompiled_code(u32 startpc, u32 size, EERecCodeCache::BlockProtection protection)
+{
+	u32 inpage_ptr = HWADDR(startpc);
+	const u32 inpage_sz = size * 4;
+
+	switch (protection)
+	{
+		case EERecCodeCache::BlockProtection::NotRequired:
+			break;
+
+		case EERecCodeCache::BlockProtection::Counted:
 			mmap_MarkCountedRamPage(inpage_ptr);
 			manual_page[inpage_ptr >> 12] = 0;
+			s_countedPage[inpage_ptr >> 12] = 1;
 			break;
 
-		case ProtMode_Manual:
+		case EERecCodeCache::BlockProtection::ManualCounted:
+		case EERecCodeCache::BlockProtection::ManualUncounted:
+		{
 			xMOV(arg1regd, inpage_ptr);
 			xMOV(arg2regd, inpage_sz / 4);
 			//xMOV( eax, startpc );		// uncomment this to access startpc (as eax) in dyna_block_discard
@@ -2049,15 +2582,7 @@ static void memory_protect_recompiled_code(u32 startpc, u32 size)
 				lpc += 4;
 			}
 
-			// Tweakpoint!  3 is a 'magic' number representing the number of times a counted block
-			// is re-protected before the recompiler gives up and sets it up as an uncounted (permanent)
-			// manual block.  Higher thresholds result in more recompilations for blocks that share code
-			// and data on the same page.  Side effects of a lower threshold: over extended gameplay
-			// with several map changes, a game's overall performance could degrade.
-
-			// (ideally, perhaps, manual_counter should be reset to 0 every few minutes?)
-
-			if (!contains_thread_stack && manual_counter[inpage_ptr >> 12] <= 3)
+			if (protection == EERecCodeCache::BlockProtection::ManualCounted)
 			{
 				// Counted blocks add a weighted (by block size) value into manual_page each time they're
 				// run.  If the block gets run a lot, it resets and re-protects itself in the hope
@@ -2087,7 +2612,8 @@ static void memory_protect_recompiled_code(u32 startpc, u32 size)
 				eeRecPerfLog.Write("Uncounted Manual block @ 0x%08X : size =%3d page/offs = 0x%05X/0x%03X  inpgsz = %d",
 					startpc, size, inpage_ptr >> 12, inpage_ptr & 0xfff, inpage_sz);
 			}
-			break;
+		}
+		break;
 	}
 }
 
@@ -2121,6 +2647,112 @@ static bool skipMPEG_By_Pattern(u32 sPC)
 	return 0;
 }
 
+// The idea here is that as long as a loop doesn't write to a register it's already read
+// (excepting registers initialised with constants or memory loads) or use any instructions
+// which alter the machine state apart from registers, it will do the same thing on every
+// iteration until an event changes the memory it's polling. The branch at end - 8 is skipped.
+static bool recIsIdleLoop(u32 start, u32 end)
+{
+	u32 reads = 0, loads = 1;
+
+	// Registers computed only from loads and constants are loads themselves, anything else must
+	// not overwrite a register which was read earlier in the loop.
+	const auto write = [&reads, &loads](u32 srcs, u32 dest) {
+		if ((loads & srcs) == srcs)
+		{
+			loads |= 1u << dest;
+			return true;
+		}
+
+		reads |= srcs;
+		return !(reads & (1u << dest));
+	};
+
+	for (u32 i = start; i < end; i += 4)
+	{
+		if (i == end - 8)
+			continue;
+		cpuRegs.code = *(u32*)PSM(i);
+		// nop
+		if (cpuRegs.code == 0)
+			continue;
+		// cache, sync
+		else if (_Opcode_ == 057 || (_Opcode_ == 0 && _Funct_ == 017))
+			continue;
+		// imm arithmetic
+		else if ((_Opcode_ & 070) == 010 || (_Opcode_ & 076) == 030)
+		{
+			if (!write(1u << _Rs_, _Rt_))
+				return false;
+		}
+		// common register arithmetic instructions
+		else if (_Opcode_ == 0 && (_Funct_ & 060) == 040 && (_Funct_ & 076) != 050)
+		{
+			if (!write(1u << _Rs_ | 1u << _Rt_, _Rd_))
+				return false;
+		}
+		// shifts by immediate: sll, srl, sra, dsll, dsrl, dsra, dsll32, dsrl32, dsra32
+		else if (_Opcode_ == 0 && (_Funct_ == 000 || _Funct_ == 002 || _Funct_ == 003 ||
+									  ((_Funct_ & 070) == 070 && _Funct_ != 071 && _Funct_ != 075)))
+		{
+			if (!write(1u << _Rt_, _Rd_))
+				return false;
+		}
+		// variable shifts: sllv, srlv, srav, dsllv, dsrlv, dsrav
+		else if (_Opcode_ == 0 && (_Funct_ == 004 || _Funct_ == 006 || _Funct_ == 007 ||
+									  _Funct_ == 024 || _Funct_ == 026 || _Funct_ == 027))
+		{
+			if (!write(1u << _Rs_ | 1u << _Rt_, _Rd_))
+				return false;
+		}
+		// loads
+		else if ((_Opcode_ & 070) == 040 || (_Opcode_ & 076) == 032 || _Opcode_ == 067 || _Opcode_ == 036)
+		{
+			if (!write(1u << _Rs_, _Rt_))
+				return false;
+		}
+		// mfc*, cfc*
+		else if ((_Opcode_ & 074) == 020 && _Rs_ < 4)
+		{
+			loads |= 1u << _Rt_;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Checks for a conditional branch at branchpc whose fall-through path goes straight back to loop_start, i.e.
+//   loop: lw v0, 0(a0); bne v0, zero, done; nop; j loop; nop
+static bool recIsIdleLoopExit(u32 branchpc, u32 loop_start)
+{
+	const u32* branch = (const u32*)PSM(branchpc);
+	const u32* jump = (const u32*)PSM(branchpc + 8);
+	const u32* delay = (const u32*)PSM(branchpc + 12);
+	if (!branch || !jump || !delay || *delay != 0)
+		return false;
+
+	const u32 op = *branch >> 26;
+	const u32 rs = (*branch >> 21) & 0x1f;
+	const u32 rt = (*branch >> 16) & 0x1f;
+	const bool conditional = (op >= 4 && op <= 7) || (op >= 20 && op <= 23) ||
+							 (op == 1 && (rt < 4 || (rt >= 16 && rt < 20))) ||
+							 (op >= 16 && op <= 18 && rs == 8);
+	if (!conditional)
+		return false;
+
+	const u32 jump_pc = branchpc + 8;
+	if ((*jump >> 26) == 2) // j
+		return ((*jump & 0x03ffffff) << 2 | ((jump_pc + 4) & 0xf0000000)) == loop_start;
+	if ((*jump & 0xffff0000) == 0x10000000) // b (beq zero, zero)
+		return jump_pc + 4 + static_cast<s16>(*jump) * 4 == loop_start;
+
+	return false;
+}
+
 static bool recSkipTimeoutLoop(s32 reg, bool is_timeout_loop)
 {
 	if (!EmuConfig.Speedhacks.WaitLoop || !is_timeout_loop)
@@ -2163,7 +2795,7 @@ static bool recSkipTimeoutLoop(s32 reg, bool is_timeout_loop)
 	xMOV(ptr32[&cpuRegs.GPR.r[reg].UL[0]], edx); // write back new value of v0
 	xJNZ((void*)DispatcherEvent); // jump to dispatcher if new v0 is not zero (i.e. an event)
 	xMOV(ptr32[&cpuRegs.pc], s_nEndBlock); // otherwise end of loop
-	recBlocks.Link(HWADDR(s_nEndBlock), xJcc32());
+	recLinkBlock(HWADDR(s_nEndBlock), xJcc32());
 
 	g_branch = 1;
 	pc = s_nEndBlock;
@@ -2171,6 +2803,154 @@ static bool recSkipTimeoutLoop(s32 reg, bool is_timeout_loop)
 	return true;
 }
 
+// Publishes the block at s_pCurBlockEx through the LUT, and snapshots the guest code it was compiled from.
+static void recCommitBlock(u32 startpc, u32 endpc)
+{
+	if (HWADDR(endpc) <= Ps2MemSize::ExposedRam)
+	{
+		BASEBLOCKEX* oldBlock;
+		int i;
+
+		i = recBlocks.LastIndex(HWADDR(endpc) - 4);
+		while ((oldBlock = recBlocks[i--]))
+		{
+			if (oldBlock == s_pCurBlockEx)
+				continue;
+			if (oldBlock->startpc >= HWADDR(endpc))
+				continue;
+			if ((oldBlock->startpc + oldBlock->size * 4) <= HWADDR(startpc))
+				break;
+
+			if (memcmp(&recRAMCopy[oldBlock->startpc / 4], PSM(oldBlock->startpc),
+					oldBlock->size * 4))
+			{
+				recClear(startpc, (endpc - startpc) / 4);
+				s_pCurBlockEx = recBlocks.Get(HWADDR(startpc));
+				pxAssert(s_pCurBlockEx->startpc == HWADDR(startpc));
+				break;
+			}
+		}
+
+		memcpy(&recRAMCopy[HWADDR(startpc) / 4], PSM(startpc), endpc - startpc);
+	}
+
+	s_pCurBlock->SetFnptr(s_pCurBlockEx->fnptr);
+
+	for (u32 i = 1; i < static_cast<u32>(s_pCurBlockEx->size); i++)
+	{
+		if ((uptr)JITCompile == s_pCurBlock[i].GetFnptr())
+			s_pCurBlock[i].SetFnptr((uptr)JITCompileInBlock);
+	}
+
+	if (!(endpc & 0x10000000))
+		maxrecmem = std::max((endpc & ~0xa0000000), maxrecmem);
+}
+
+// Places a block from the persistent code cache at recPtr, if one matching the current guest code exists.
+static bool recTryInstallCachedBlock(u32 startpc)
+{
+	const void* guest_code = PSM(startpc);
+	if (!guest_code)
+		return false;
+
+	const EERecCodeCache::Block* block = EERecCodeCache::Lookup(startpc, guest_code);
+	if (!block || block->protection != recGetBlockProtection(startpc) || (recPtr + block->code.size()) >= recPtrEnd)
+		return false;
+
+	// The block has to end in the same place it would if it was compiled now.
+	for (u32 i = 0; i < block->size; i++)
+	{
+		if (isBreakpointNeeded(startpc + i * 4) != 0 || isMemcheckNeeded(startpc + i * 4) != 0)
+			return false;
+
+		if (i > 0 && s_pCurBlock[i].GetFnptr() != (uptr)JITCompile && s_pCurBlock[i].GetFnptr() != (uptr)JITCompileInBlock)
+			return false;
+	}
+
+	// Fastmem accesses which have since faulted get compiled as slowmem.
+	for (const EERecCodeCache::BlockLoadStore& ls : block->loadstores)
+	{
+		if (vtlb_IsFaultingPC(ls.info.guest_pc))
+			return false;
+	}
+
+	if (!EERecCodeCache::Relocate(*block, recPtr))
+		return false;
+
+	s_pCurBlockEx = recBlocks.New(HWADDR(startpc), (uptr)recPtr);
+	s_pCurBlockEx->size = block->size;
+	s_pCurBlockEx->x86size = static_cast<u32>(block->code.size());
+
+	if (block->protection == EERecCodeCache::BlockProtection::Counted)
+	{
+		mmap_MarkCountedRamPage(HWADDR(startpc));
+		manual_page[HWADDR(startpc) >> 12] = 0;
+		s_countedPage[HWADDR(startpc) >> 12] = 1;
+	}
+
+	recCommitBlock(startpc, startpc + block->size * 4);
+
+	for (const EERecCodeCache::BlockLink& link : block->links)
+	{
+		if (const BASEBLOCKEX* target = recBlocks.Link(link.target_pc, reinterpret_cast<s32*>(recPtr + link.offset)))
+			s_codeRegions.Touch(target->fnptr);
+	}
+
+	for (const EERecCodeCache::BlockLoadStore& ls : block->loadstores)
+	{
+		const LoadstoreBackpatchInfo& info = ls.info;
+		vtlb_AddLoadStoreInfo((uptr)recPtr + ls.offset, info.code_size, info.guest_pc, info.gpr_bitmask, info.fpr_bitmask,
+			info.address_register, info.data_register, info.size_in_bits, info.is_signed, info.is_load, info.is_fpr);
+	}
+
+	Perf::ee.RegisterPC((void*)s_pCurBlockEx->fnptr, s_pCurBlockEx->x86size, s_pCurBlockEx->startpc);
+	s_codeRegions.NoteCompiled(s_pCurBlockEx->startpc, s_pCurBlockEx->x86size);
+
+	recPtr += block->code.size();
+	return true;
+}
+
+// Makes room for new code by removing every block in the next region of the code buffer.
+static void recEvictCodeRegion()
+{
+	u8* evict_start;
+	u8* evict_end;
+	recPtr = s_codeRegions.Advance(recPtr, &evict_start, &evict_end);
+	if (evict_start == evict_end)
+		return;
+
+	// Guarded blocks live on in their guard, so they have to go if their original code is being evicted.
+	std::vector<u32> guarded_pcs;
+	for (auto it = s_guardedBlocks.begin(); it != s_guardedBlocks.end();)
+	{
+		const BASEBLOCKEX* block = recBlocks.Get(it->first);
+		const bool alive = block && block->startpc == it->first && block->fnptr == it->second.guard;
+		if (alive && (it->second.body < (uptr)evict_start || it->second.body >= (uptr)evict_end))
+		{
+			++it;
+			continue;
+		}
+
+		if (alive)
+			guarded_pcs.push_back(it->first);
+		it = s_guardedBlocks.erase(it);
+	}
+	for (const u32 guarded_pc : guarded_pcs)
+		recClearBlocks(guarded_pc, 1);
+
+	const u32 removed = recBlocks.RemoveCodeRange((uptr)evict_start, (uptr)evict_end, [](const BASEBLOCKEX& block) {
+		BASEBLOCK* pblock = PC_GETBLOCK(block.startpc);
+		if (pblock->GetFnptr() == block.fnptr)
+			pblock->SetFnptr((uptr)JITCompile);
+
+		s_codeRegions.NoteEvicted(block.startpc, block.x86size);
+	});
+	vtlb_RemoveLoadStoreInfo((uptr)evict_start, (uptr)evict_end);
+
+	eeRecPerfLog.Write("Evicted %u blocks (%u KB) from the code buffer", removed,
+		static_cast<u32>((evict_end - evict_start) / 1024));
+}
+
 static void recRecompile(const u32 startpc)
 {
 	u32 i = 0;
@@ -2178,8 +2958,10 @@ static void recRecompile(const u32 startpc)
 
 	pxAssert(startpc);
 
-	// if recPtr reached the mem limit reset whole mem
-	if (recPtr >= recPtrEnd)
+	// if recPtr reached the mem limit reset whole mem, or just the oldest code if eviction is enabled
+	if (EmuConfig.Cpu.Recompiler.EnableCodeEviction && !eeRecNeedsReset && s_codeRegions.IsFull(recPtr))
+		recEvictCodeRegion();
+	else if (recPtr >= recPtrEnd)
 		eeRecNeedsReset = true;
 
 	if (HWADDR(startpc) == VMManager::Internal::GetCurrentELFEntryPoint())
@@ -2201,7 +2983,29 @@ static void recRecompile(const u32 startpc)
 	s_pCurBlockEx = recBlocks.Get(HWADDR(startpc));
 	pxAssert(!s_pCurBlockEx || s_pCurBlockEx->startpc != HWADDR(startpc));
 
+	// Blocks which have been promoted by the profiling tier get rebuilt as superblocks.
+	const bool build_superblock = EmuConfig.Cpu.Recompiler.EnableEESuperblocks && EE::BlockProfiler.IsPromoted(startpc);
+
+	// Blocks with hooks, debugger checks, profiling counters or cross-block analysis depend on more than the guest code,
+	// so they're never cached.
+	const bool use_code_cache = EERecCodeCache::IsOpen() && !EmuConfig.Gamefixes.GoemonTlbHack &&
+								!EmuConfig.Cpu.Recompiler.EnableEESuperblocks && !EmuConfig.Cpu.Recompiler.EnableEECrossBlockAnalysis &&
+								HWADDR(startpc) != EELOAD_START && HWADDR(startpc) != HWADDR(g_eeloadMain) &&
+								HWADDR(startpc) != HWADDR(g_eeloadExec) &&
+								isBreakpointNeeded(startpc) == 0 && isMemcheckNeeded(startpc) == 0;
+	const Common::Timer::Value compile_start = use_code_cache ? Common::Timer::GetCurrentValue() : 0;
+	if (use_code_cache && recTryInstallCachedBlock(startpc))
+	{
+		EERecCodeCache::AddHit(Common::Timer::GetCurrentValue() - compile_start);
+		s_pCurBlock = nullptr;
+		s_pCurBlockEx = nullptr;
+		return;
+	}
+
 	s_pCurBlockEx = recBlocks.New(HWADDR(startpc), (uptr)recPtr);
+	s_blockLinks.clear();
+	s_blockAddressTags.clear();
+	x86AddressTags = use_code_cache ? &s_blockAddressTags : nullptr;
 
 	pxAssert(s_pCurBlockEx);
 
@@ -2293,6 +3097,27 @@ static void recRecompile(const u32 startpc)
 	s32 timeout_reg = -1;
 	bool is_timeout_loop = true;
 
+	// Superblocks carry on past conditional branches whose fall-through side is hot, as long as the
+	// block they started was compiled ending at the same branch in the profiling tier. The taken side
+	// becomes a side exit.
+	u32 segment_start = startpc;
+	s_superblockStart = startpc;
+	s_numSuperblockExits = 0;
+	const auto extend_superblock = [&]() {
+		const u32 fallthroughpc = i + 8;
+		if (s_numSuperblockExits == MAX_SUPERBLOCK_BRANCHES || s_branchTo == fallthroughpc || (fallthroughpc & 0xffc) == 0 ||
+			!EE::BlockProfiler.IsFallthroughHot(segment_start, fallthroughpc))
+		{
+			return false;
+		}
+
+		s_superblockExits[s_numSuperblockExits++] = fallthroughpc;
+		segment_start = fallthroughpc;
+		is_timeout_loop = false;
+		i = fallthroughpc;
+		return true;
+	};
+
 	// compile breakpoints as individual blocks
 	const int n1 = isBreakpointNeeded(i);
 	const int n2 = isMemcheckNeeded(i);
@@ -2325,7 +3150,8 @@ static void recRecompile(const u32 startpc)
 				break;
 			}
 
-			if (pblock->GetFnptr() != (uptr)JITCompile && pblock->GetFnptr() != (uptr)JITCompileInBlock)
+			// Superblocks can overlap existing blocks, recClear() takes care of removing both.
+			if (!build_superblock && pblock->GetFnptr() != (uptr)JITCompile && pblock->GetFnptr() != (uptr)JITCompileInBlock)
 			{
 				willbranch3 = 1;
 				s_nEndBlock = i;
@@ -2379,7 +3205,10 @@ static void recRecompile(const u32 startpc)
 				{
 					// branches
 					s_branchTo = _Imm_ * 4 + i + 4;
-					if (s_branchTo > startpc && s_branchTo < i)
+					if (build_superblock && extend_superblock())
+						continue;
+
+					if (s_branchTo > segment_start && s_branchTo < i)
 						s_nEndBlock = s_branchTo;
 					else
 						s_nEndBlock = i + 8;
@@ -2404,7 +3233,10 @@ static void recRecompile(const u32 startpc)
 			case 22:
 			case 23:
 				s_branchTo = _Imm_ * 4 + i + 4;
-				if (s_branchTo > startpc && s_branchTo < i)
+				if (build_superblock && extend_superblock())
+					continue;
+
+				if (s_branchTo > segment_start && s_branchTo < i)
 					s_nEndBlock = s_branchTo;
 				else
 					s_nEndBlock = i + 8;
@@ -2430,7 +3262,10 @@ static void recRecompile(const u32 startpc)
 					// BC1F, BC1T, BC1FL, BC1TL
 					// BC2F, BC2T, BC2FL, BC2TL
 					s_branchTo = _Imm_ * 4 + i + 4;
-					if (s_branchTo > startpc && s_branchTo < i)
+					if (build_superblock && extend_superblock())
+						continue;
+
+					if (s_branchTo > segment_start && s_branchTo < i)
 						s_nEndBlock = s_branchTo;
 					else
 						s_nEndBlock = i + 8;
@@ -2445,91 +3280,33 @@ static void recRecompile(const u32 startpc)
 
 StartRecomp:
 
-	// The idea here is that as long as a loop doesn't write to a register it's already read
-	// (excepting registers initialised with constants or memory loads) or use any instructions
-	// which alter the machine state apart from registers, it will do the same thing on every
-	// iteration.
 	s_nBlockFF = false;
 	if (s_branchTo == startpc)
 	{
-		s_nBlockFF = true;
-
-		u32 reads = 0, loads = 1;
+		s_nBlockFF = recIsIdleLoop(startpc, s_nEndBlock);
+		s_nBlockFFPC = s_branchTo;
+	}
+	else
+	{
+		is_timeout_loop = false;
 
-		for (i = startpc; i < s_nEndBlock; i += 4)
+		// Polling loops which branch out when the condition is met, then jump back to the start.
+		if (!willbranch3 && s_nEndBlock >= startpc + 8 && recIsIdleLoopExit(s_nEndBlock - 8, startpc))
 		{
-			if (i == s_nEndBlock - 8)
-				continue;
-			cpuRegs.code = *(u32*)PSM(i);
-			// nop
-			if (cpuRegs.code == 0)
-				continue;
-			// cache, sync
-			else if (_Opcode_ == 057 || (_Opcode_ == 0 && _Funct_ == 017))
-				continue;
-			// imm arithmetic
-			else if ((_Opcode_ & 070) == 010 || (_Opcode_ & 076) == 030)
-			{
-				if (loads & 1 << _Rs_)
-				{
-					loads |= 1 << _Rt_;
-					continue;
-				}
-				else
-					reads |= 1 << _Rs_;
-				if (reads & 1 << _Rt_)
-				{
-					s_nBlockFF = false;
-					break;
-				}
-			}
-			// common register arithmetic instructions
-			else if (_Opcode_ == 0 && (_Funct_ & 060) == 040 && (_Funct_ & 076) != 050)
-			{
-				if (loads & 1 << _Rs_ && loads & 1 << _Rt_)
-				{
-					loads |= 1 << _Rd_;
-					continue;
-				}
-				else
-					reads |= 1 << _Rs_ | 1 << _Rt_;
-				if (reads & 1 << _Rd_)
-				{
-					s_nBlockFF = false;
-					break;
-				}
-			}
-			// loads
-			else if ((_Opcode_ & 070) == 040 || (_Opcode_ & 076) == 032 || _Opcode_ == 067)
-			{
-				if (loads & 1 << _Rs_)
-				{
-					loads |= 1 << _Rt_;
-					continue;
-				}
-				else
-					reads |= 1 << _Rs_;
-				if (reads & 1 << _Rt_)
-				{
-					s_nBlockFF = false;
-					break;
-				}
-			}
-			// mfc*, cfc*
-			else if ((_Opcode_ & 074) == 020 && _Rs_ < 4)
-			{
-				loads |= 1 << _Rt_;
-			}
-			else
-			{
-				s_nBlockFF = false;
-				break;
-			}
+			s_nBlockFF = recIsIdleLoop(startpc, s_nEndBlock);
+			s_nBlockFFPC = s_nEndBlock;
 		}
 	}
-	else
+
+	if (EmuConfig.Speedhacks.WaitLoop && s_nBlockFF)
+		s_idleLoopStats.loops++;
+
+	if (s_numSuperblockExits > 0)
 	{
-		is_timeout_loop = false;
+		EE::BlockProfiler.superblocks++;
+		EE::BlockProfiler.merged_branches += s_numSuperblockExits;
+		eeRecPerfLog.Write("Superblock @ %08X : size=%d insts, %u merged branches", startpc, (s_nEndBlock - startpc) / 4,
+			s_numSuperblockExits);
 	}
 
 	// rec info //
@@ -2547,11 +3324,17 @@ StartRecomp:
 		_recClearInst(pcur);
 		pcur->info = 0;
 
+		// Merged branches in superblocks can leave for anywhere, so liveness is reset there like at the end of a block.
+		EEINST exit_inst;
+		_recClearInst(&exit_inst);
+		exit_inst.info = 0;
+
 		for (i = s_nEndBlock; i > startpc; i -= 4)
 		{
+			EEINST* next = recIsSuperblockExit(i) ? &exit_inst : pcur;
 			cpuRegs.code = *(int*)PSM(i - 4);
-			pcur[-1] = pcur[0];
-			recBackpropBSC(cpuRegs.code, pcur - 1, pcur);
+			pcur[-1] = *next;
+			recBackpropBSC(cpuRegs.code, pcur - 1, next);
 			pcur--;
 
 			has_cop2_instructions |= (_Opcode_ == 022 || _Opcode_ == 066 || _Opcode_ == 076);
@@ -2559,12 +3342,22 @@ StartRecomp:
 	}
 
 	// eventually we'll want to have a vector of passes or something.
+	// Superblocks are analysed one branch-delimited segment at a time, for the same reason as above.
 	if (has_cop2_instructions)
 	{
-		COP2MicroFinishPass().Run(startpc, s_nEndBlock, s_pInstCache + 1);
+		u32 segment_pc = startpc;
+		for (u32 segment = 0; segment <= s_numSuperblockExits; segment++)
+		{
+			const u32 segment_end = (segment < s_numSuperblockExits) ? s_superblockExits[segment] : s_nEndBlock;
+			EEINST* segment_inst = s_pInstCache + 1 + (segment_pc - startpc) / 4;
+
+			COP2MicroFinishPass().Run(segment_pc, segment_end, segment_inst);
 
-		if (EmuConfig.Speedhacks.vuFlagHack)
-			COP2FlagHackPass().Run(startpc, s_nEndBlock, s_pInstCache + 1);
+			if (EmuConfig.Speedhacks.vuFlagHack)
+				COP2FlagHackPass().Run(segment_pc, segment_end, segment_inst);
+
+			segment_pc = segment_end;
+		}
 	}
 
 #ifdef DUMP_BLOCKS
@@ -2588,13 +3381,73 @@ StartRecomp:
 #endif
 
 	// Detect and handle self-modified code
-	memory_protect_recompiled_code(startpc, (s_nEndBlock - startpc) >> 2);
+	const EERecCodeCache::BlockProtection protection = recGetBlockProtection(startpc);
+	memory_protect_recompiled_code(startpc, (s_nEndBlock - startpc) >> 2, protection);
+
+	// Profiling tier: count entries, and hand the block over to recPromoteBlock() once it's hot.
+	if (EmuConfig.Cpu.Recompiler.EnableEESuperblocks && !build_superblock)
+	{
+		s_pCurBlockProfile = EE::BlockProfiler.Allocate(startpc, s_nEndBlock);
+		if (s_pCurBlockProfile)
+		{
+			xSUB(ptr32[&s_pCurBlockProfile->countdown], 1);
+			xForwardJNZ8 not_hot;
+			xMOV(arg1regd, static_cast<u32>(s_pCurBlockProfile - EE::BlockProfiler.blocks));
+			xJMP(DispatchPromoteBlock);
+			not_hot.SetTarget();
+		}
+	}
+
+	// Cross-block analysis depends on the code around the block, so it's only safe when any write to the page
+	// clears the block.
+	s_crossBlockAnalysis = EmuConfig.Cpu.Recompiler.EnableEECrossBlockAnalysis && !EmuConfig.Gamefixes.GoemonTlbHack &&
+						   (protection == EERecCodeCache::BlockProtection::Counted ||
+							   protection == EERecCodeCache::BlockProtection::NotRequired);
+	s_crossBlockPage = startpc & ~0xfffu;
 
 	// Skip Recompilation if sceMpegIsEnd Pattern detected
 	const bool doRecompilation = !skipMPEG_By_Pattern(startpc) && !recSkipTimeoutLoop(timeout_reg, is_timeout_loop);
 
 	if (doRecompilation)
 	{
+		// Constants which every static path into the block agrees on are checked on entry, then treated as
+		// known. If the check ever fails, the block is recompiled without them.
+		if (s_crossBlockAnalysis && !s_entryConstantMisses.contains(startpc))
+		{
+			CrossBlockPass entry_pass;
+			entry_pass.Run(startpc, s_nEndBlock, s_pInstCache + 1);
+
+			const u32 count = entry_pass.GetEntryConstantCount();
+			if (count > 0)
+			{
+				u32* miss[CrossBlockPass::MAX_ENTRY_CONSTANTS];
+				for (u32 i = 0; i < count; i++)
+				{
+					const CrossBlockPass::EntryConstant& ec = entry_pass.GetEntryConstant(i);
+					xImm64Op(xCMP, ptr64[&cpuRegs.GPR.r[ec.reg].UD[0]], rax, ec.value);
+					miss[i] = JNE32(0);
+				}
+
+				xForwardJump8 hit;
+				for (u32 i = 0; i < count; i++)
+					x86SetJ32(miss[i]);
+				xMOV(arg1regd, startpc);
+				xJMP(DispatchEntryConstantMiss);
+				hit.SetTarget();
+
+				for (u32 i = 0; i < count; i++)
+				{
+					const CrossBlockPass::EntryConstant& ec = entry_pass.GetEntryConstant(i);
+					g_cpuConstRegs[ec.reg].UD[0] = ec.value;
+					g_cpuHasConstReg |= (1u << ec.reg);
+					g_cpuFlushedConstReg |= (1u << ec.reg);
+				}
+
+				s_crossBlockStats.seeded_blocks++;
+				s_crossBlockStats.seeded_constants += count;
+			}
+		}
+
 		// Finally: Generate x86 recompiled code!
 		g_pCurInstInfo = s_pInstCache;
 		while (!g_branch && pc < s_nEndBlock)
@@ -2634,44 +3487,11 @@ StartRecomp:
 	pxAssert((pc - startpc) >> 2 <= 0xffff);
 	s_pCurBlockEx->size = (pc - startpc) >> 2;
 
-	if (HWADDR(pc) <= Ps2MemSize::ExposedRam)
-	{
-		BASEBLOCKEX* oldBlock;
-		int i;
-
-		i = recBlocks.LastIndex(HWADDR(pc) - 4);
-		while ((oldBlock = recBlocks[i--]))
-		{
-			if (oldBlock == s_pCurBlockEx)
-				continue;
-			if (oldBlock->startpc >= HWADDR(pc))
-				continue;
-			if ((oldBlock->startpc + oldBlock->size * 4) <= HWADDR(startpc))
-				break;
-
-			if (memcmp(&recRAMCopy[oldBlock->startpc / 4], PSM(oldBlock->startpc),
-					oldBlock->size * 4))
-			{
-				recClear(startpc, (pc - startpc) / 4);
-				s_pCurBlockEx = recBlocks.Get(HWADDR(startpc));
-				pxAssert(s_pCurBlockEx->startpc == HWADDR(startpc));
-				break;
-			}
-		}
-
-		memcpy(&recRAMCopy[HWADDR(startpc) / 4], PSM(startpc), pc - startpc);
-	}
-
-	s_pCurBlock->SetFnptr((uptr)recPtr);
-
-	for (i = 1; i < static_cast<u32>(s_pCurBlockEx->size); i++)
-	{
-		if ((uptr)JITCompile == s_pCurBlock[i].GetFnptr())
-			s_pCurBlock[i].SetFnptr((uptr)JITCompileInBlock);
-	}
+	// A superblock can end early, on a merged branch which turned out to always be taken.
+	if (g_branch && s_numSuperblockExits > 0)
+		willbranch3 = 0;
 
-	if (!(pc & 0x10000000))
-		maxrecmem = std::max((pc & ~0xa0000000), maxrecmem);
+	recCommitBlock(startpc, pc);
 
 	if (g_branch == 2)
 	{
@@ -2692,6 +3512,7 @@ StartRecomp:
 		if (willbranch3 || !g_branch)
 		{
 
+			recDiscardDeadGPRsAt(pc);
 			iFlushCall(FLUSH_EVERYTHING);
 
 			// Split Block concatenation mode.
@@ -2707,7 +3528,7 @@ StartRecomp:
 			{
 				xMOV(ptr32[&cpuRegs.pc], pc);
 				xADD(ptr32[&cpuRegs.cycle], scaleblockcycles());
-				recBlocks.Link(HWADDR(pc), xJcc32());
+				recLinkBlock(HWADDR(pc), xJcc32());
 			}
 		}
 	}
@@ -2723,6 +3544,18 @@ StartRecomp:
 	}
 #endif
 	Perf::ee.RegisterPC((void*)s_pCurBlockEx->fnptr, s_pCurBlockEx->x86size, s_pCurBlockEx->startpc);
+	s_codeRegions.NoteCompiled(s_pCurBlockEx->startpc, s_pCurBlockEx->x86size);
+
+	x86AddressTags = nullptr;
+	if (use_code_cache)
+	{
+		EERecCodeCache::AddMiss(Common::Timer::GetCurrentValue() - compile_start);
+		if (s_pCurBlockEx->size > 0)
+		{
+			EERecCodeCache::Record(startpc, s_pCurBlockEx->size, PSM(startpc), protection, recPtr, s_pCurBlockEx->x86size,
+				s_blockLinks, s_blockAddressTags);
+		}
+	}
 
 	recPtr = xGetPtr();
 
@@ -2730,6 +3563,52 @@ StartRecomp:
 
 	s_pCurBlock = nullptr;
 	s_pCurBlockEx = nullptr;
+	s_pCurBlockProfile = nullptr;
+	s_numSuperblockExits = 0;
+	s_crossBlockAnalysis = false;
+}
+
+// Interprets cold code instead of compiling it, see INTERPRETER_TIER_THRESHOLD. Returns false if the block should be
+// compiled now.
+static bool recTryInterpretBlock(const u32 startpc)
+{
+	// Hooks, hacks and breakpoints are handled by the recompiled code, so anything which needs them is compiled.
+	if (!EmuConfig.Cpu.Recompiler.EnableEEInterpreterTier || eeRecNeedsReset || EmuConfig.Gamefixes.GoemonTlbHack ||
+		!VMManager::Internal::HasBootedELF() || HWADDR(startpc) == VMManager::Internal::GetCurrentELFEntryPoint() ||
+		(HWADDR(startpc) >= EELOAD_START && HWADDR(startpc) < EELOAD_START + EELOAD_SIZE) ||
+		CBreakPoints::GetNumBreakpoints() != 0 || CBreakPoints::GetNumMemchecks() != 0 || isBreakpointNeeded(startpc) != 0)
+	{
+		return false;
+	}
+
+	const auto it = s_pendingBlocks.try_emplace(HWADDR(startpc), 0).first;
+	if (++it->second >= INTERPRETER_TIER_THRESHOLD)
+	{
+		s_pendingBlocks.erase(it);
+		s_interpreterTierStats.tiered_compiles++;
+		return false;
+	}
+
+	s_interpreterTierStats.max_pending = std::max(s_interpreterTierStats.max_pending, static_cast<u32>(s_pendingBlocks.size()));
+
+	s_interpreterTierActive = true;
+	const u32 executed = intExecuteForRecompiler(INTERPRETER_TIER_MAX_INSTS);
+	s_interpreterTierActive = false;
+
+	s_interpreterTierStats.interpreted_insts += executed;
+	s_interpreterTierStats.interpreted_runs++;
+
+	// Same as the end of a recompiled block.
+	if (eeRecExitRequested || static_cast<s32>(cpuRegs.cycle - cpuRegs.nextEventCycle) >= 0)
+		recEventTest();
+
+	return true;
+}
+
+static void recCompileOrInterpret(const u32 startpc)
+{
+	if (!recTryInterpretBlock(startpc))
+		recRecompile(startpc);
 }
 
 R5900cpu recCpu = {
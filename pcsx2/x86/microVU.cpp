@@ -2,10 +2,17 @@
 // SPDX-License-Identifier: GPL-3.0+
 
 #include "microVU.h"
+#include "microVU_ProgCache.h"
+
+#include "Counters.h"
+#include "VMManager.h"
 
 #include "common/AlignedMalloc.h"
 #include "common/Perf.h"
 #include "common/StringUtil.h"
+#include "common/Timer.h"
+
+#include <bit>
 
 //------------------------------------------------------------------
 // Micro VU - Main Functions
@@ -51,8 +58,23 @@ void mVUreset(microVU& mVU, bool resetReserve)
 
 	mVU.regs().nextBlockCycles = 0;
 	memset(&mVU.prog.lpState, 0, sizeof(mVU.prog.lpState));
+	mVU.useVEX = EmuConfig.Cpu.Recompiler.EnableVUVexEncoding && cpuinfo_has_x86_avx();
 	mVU.profiler.Reset(mVU.index);
 
+	const microSearchStats& stats = mVU.prog.stats;
+	if (stats.searches)
+	{
+		DevCon.WriteLn("microVU%d: %u program searches in %u frames, %.1f programs probed per search (max %u per frame), "
+					   "%llu bytes compared (max %llu per frame), %u false hash matches",
+			mVU.index, stats.searches, stats.frames, (double)stats.probes / (double)stats.searches,
+			std::max(stats.maxProbes, stats.frameProbes), (unsigned long long)(stats.cmpBytes + stats.frameCmpBytes),
+			(unsigned long long)std::max(stats.maxCmpBytes, stats.frameCmpBytes), stats.falseHits);
+	}
+	memset(&mVU.prog.stats, 0, sizeof(mVU.prog.stats));
+
+	// Micro memory may have been replaced (e.g. by loading a state), rehash all of it on the next search
+	memset(mVU.prog.hashDirty, 0xff, sizeof(mVU.prog.hashDirty));
+
 	// Program Variables
 	mVU.prog.cleared  =  1;
 	mVU.prog.isSame   = -1;
@@ -60,9 +82,21 @@ void mVUreset(microVU& mVU, bool resetReserve)
 	mVU.prog.total    =  0;
 	mVU.prog.curFrame =  0;
 
+	const RecCodeRegions::Stats& regionStats = mVU.codeRegions.GetStats();
+	if (regionStats.evictions)
+	{
+		DevCon.WriteLn("microVU%d: %llu cache region evictions, %llu programs evicted, %llu recompiled after eviction",
+			mVU.index, (unsigned long long)regionStats.evictions, (unsigned long long)regionStats.evicted_blocks,
+			(unsigned long long)regionStats.recompiled_blocks);
+	}
+
 	// Setup Dynarec Cache Limits for Each Program
 	mVU.prog.x86start = xGetAlignedCallTarget();
 	mVU.prog.x86ptr   = mVU.prog.x86start;
+	mVU.codeRegions.Reset(mVU.prog.x86start, mVU.prog.x86end + mVUcacheSafeZone * _1mb, mVUcacheSafeZone * _1mb);
+
+	// Programs which ran go to the program cache before they're deleted
+	mVUrecordProgs(mVU);
 
 	for (u32 i = 0; i < (mVU.progSize / 2); i++)
 	{
@@ -80,11 +114,33 @@ void mVUreset(microVU& mVU, bool resetReserve)
 		mVU.prog.quick[i].block = NULL;
 		mVU.prog.quick[i].prog = NULL;
 	}
+
+	// Programs are only cached once a game is running, and precompiled on a full reset (not when the
+	// cache filled up in the middle of execution).
+	if (resetReserve)
+	{
+		const std::string serial = VMManager::GetDiscSerial();
+		const u32 crc = VMManager::GetCurrentCRC();
+		if (EmuConfig.Cpu.Recompiler.EnableVUProgramCache && !serial.empty() && crc != 0)
+		{
+			mVUProgCache::Open(mVU.index, serial, crc);
+			if (EmuConfig.Cpu.Recompiler.BenchmarkVUCodegen)
+				mVUbenchmarkCodegen(mVU);
+			mVUprecompileProgs(mVU);
+		}
+		else
+		{
+			mVUProgCache::Close(mVU.index);
+		}
+	}
 }
 
 // Free Allocated Resources
 void mVUclose(microVU& mVU)
 {
+	mVUrecordProgs(mVU);
+	mVUProgCache::Close(mVU.index);
+
 	// Delete Programs and Block Managers
 	for (u32 i = 0; i < (mVU.progSize / 2); i++)
 	{
@@ -102,6 +158,10 @@ void mVUclose(microVU& mVU)
 // Clears Block Data in specified range
 __fi void mVUclear(mV, u32 addr, u32 size)
 {
+	const u32 endSlot = std::min((addr + size + 7) / 8, mVU.progSize / 2);
+	for (u32 i = addr / 8; i < endSlot; i++)
+		mVU.prog.hashDirty[i / 64] |= 1ull << (i % 64);
+
 	if (!mVU.prog.cleared)
 	{
 		mVU.prog.cleared = 1; // Next execution searches/creates a new microprogram
@@ -137,6 +197,8 @@ __ri microProgram* mVUcreateProg(microVU& mVU, int startPC)
 	prog->idx = mVU.prog.total++;
 	prog->ranges = new std::deque<microRange>();
 	prog->startPC = startPC;
+	prog->lastFrame = g_FrameCount;
+	mVU.codeRegions.NoteCompiled(startPC * 8, 0);
 	if(doWholeProgCompare)
 		mVUcacheProg(mVU, *prog); // Cache Micro Program
 	double cacheSize = (double)((uptr)mVU.prog.x86end - (uptr)mVU.prog.x86start);
@@ -166,6 +228,291 @@ __ri void mVUcacheProg(microVU& mVU, microProgram& prog)
 	mVUdumpProg(mVU, prog);
 }
 
+// Saves a program which has run to the program cache, with the pipeline states of its blocks
+void mVUrecordProg(microVU& mVU, microProgram& prog)
+{
+	if (!prog.used || !mVUProgCache::IsOpen(mVU.index))
+		return;
+
+	mVUProgCache::Program cached;
+	cached.start_pc = prog.startPC * 8;
+	for (const microRange& range : *prog.ranges)
+	{
+		if (range.start >= 0 && range.end > range.start && range.end <= (s32)mVU.microMemSize)
+			cached.ranges.push_back({range.start, range.end});
+	}
+	if (cached.ranges.empty())
+		return;
+
+	// Ranges can overlap (a block starting inside another), merge them so the data is only stored once
+	std::sort(cached.ranges.begin(), cached.ranges.end(),
+		[](const mVUProgCache::Range& a, const mVUProgCache::Range& b) { return a.start < b.start; });
+	u32 merged = 0;
+	for (u32 j = 1; j < cached.ranges.size(); j++)
+	{
+		if (cached.ranges[j].start <= cached.ranges[merged].end)
+			cached.ranges[merged].end = std::max(cached.ranges[merged].end, cached.ranges[j].end);
+		else
+			cached.ranges[++merged] = cached.ranges[j];
+	}
+	cached.ranges.resize(merged + 1);
+
+	for (const mVUProgCache::Range& range : cached.ranges)
+		cached.data.insert(cached.data.end(), (u8*)prog.data + range.start, (u8*)prog.data + range.end);
+
+	for (u32 j = 0; j < (mVU.progSize / 2); j++)
+	{
+		if (!prog.block[j])
+			continue;
+		prog.block[j]->forEachBlock([&cached, j](const microBlock& block) {
+			mVUProgCache::Block& cblock = cached.blocks.emplace_back();
+			cblock.pc = j * 8;
+			std::memcpy(cblock.state, &block.pState, sizeof(cblock.state));
+		});
+	}
+
+	cached.hash = mVUProgCache::ComputeHash(cached.start_pc, cached.ranges, cached.data);
+	mVUProgCache::Record(mVU.index, std::move(cached), prog.cacheHash);
+}
+
+void mVUrecordProgs(microVU& mVU)
+{
+	if (!mVUProgCache::IsOpen(mVU.index))
+		return;
+
+	for (u32 i = 0; i < (mVU.progSize / 2); i++)
+	{
+		if (!mVU.prog.prog[i])
+			continue;
+
+		for (microProgram* prog : *mVU.prog.prog[i])
+			mVUrecordProg(mVU, *prog);
+	}
+}
+
+// Moves on to the next rec-cache region when the current one is full, and deletes the programs with code
+// in it, instead of resetting the whole cache. Blocks of a program link to each other directly, so a
+// program's code can't be moved or freed piecemeal; any of it being in the region evicts the whole program.
+void mVUevictRegion(microVU& mVU)
+{
+	RecCodeRegions& regions = mVU.codeRegions;
+
+	// Regions holding code of recently run programs get a second chance
+	for (u32 i = 0; i < (mVU.progSize / 2); i++)
+	{
+		for (const microProgram* prog : *mVU.prog.prog[i])
+		{
+			if ((g_FrameCount - prog->lastFrame) >= mVUevictFrames)
+				continue;
+			for (u32 r = 0; r < RecCodeRegions::NUM_REGIONS; r++)
+			{
+				if (prog->regions & (1u << r))
+					regions.TouchRegion(r);
+			}
+		}
+	}
+
+	u8* evict_start;
+	u8* evict_end;
+	mVU.prog.x86ptr = regions.Advance(xGetPtr(), &evict_start, &evict_end);
+	if (evict_start == evict_end)
+		return;
+
+	const u8 regionBit = 1u << regions.GetCurrentRegion();
+	std::vector<microProgram*> evicted;
+	for (u32 i = 0; i < (mVU.progSize / 2); i++)
+	{
+		microProgramList& list = *mVU.prog.prog[i];
+		for (auto it = list.begin(); it != list.end();)
+		{
+			if ((*it)->regions & regionBit)
+			{
+				evicted.push_back(*it);
+				it = list.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+	if (evicted.empty())
+		return;
+
+	std::sort(evicted.begin(), evicted.end());
+	const auto isEvicted = [&evicted](const microProgram* prog) {
+		return std::binary_search(evicted.begin(), evicted.end(), prog);
+	};
+
+	for (u32 i = 0; i < (mVU.progSize / 2); i++)
+	{
+		if (isEvicted(mVU.prog.quick[i].prog))
+		{
+			mVU.prog.quick[i].block = NULL;
+			mVU.prog.quick[i].prog = NULL;
+		}
+	}
+	if (isEvicted(mVU.prog.cur))
+		mVU.prog.cur = NULL;
+
+	// Jump caches of the remaining programs may point into the evicted programs' code. They're validated
+	// against the program pointer, which could be reused by a new program, so they have to go too.
+	for (u32 i = 0; i < (mVU.progSize / 2); i++)
+	{
+		for (microProgram* prog : *mVU.prog.prog[i])
+		{
+			for (u32 j = 0; j < (mVU.progSize / 2); j++)
+			{
+				if (!prog->block[j])
+					continue;
+				prog->block[j]->forEachBlock([&isEvicted](const microBlock& block) {
+					if (!block.jumpCache)
+						return;
+					for (u32 k = 0; k < (mProgSize / 2); k++)
+					{
+						if (block.jumpCache[k].prog && isEvicted(block.jumpCache[k].prog))
+							block.jumpCache[k] = microJumpCache();
+					}
+				});
+			}
+		}
+	}
+
+	for (microProgram* prog : evicted)
+	{
+		regions.NoteEvicted(prog->startPC * 8, 0);
+		mVUrecordProg(mVU, *prog);
+		mVUdeleteProg(mVU, prog);
+	}
+
+	PerformanceMetrics::AddVUCacheEviction(mVU.index, static_cast<u32>(evicted.size()));
+	DevCon.WriteLn(mVU.index ? Color_Orange : Color_Magenta, "microVU%d: Evicted %zu programs from cache region %u.",
+		mVU.index, evicted.size(), regions.GetCurrentRegion());
+}
+
+// Compiles the blocks of a program from the program cache, at the current x86 pointer.
+// Returns NULL if the entry doesn't fit this VU.
+static microProgram* mVUcompileCachedProg(microVU& mVU, const mVUProgCache::Program& cached)
+{
+	static_assert(sizeof(microRegInfo) == mVUProgCache::PIPELINE_STATE_SIZE);
+
+	if (!mVUProgCache::IsValid(cached, mVU.microMemSize))
+		return NULL;
+
+	std::memset(mVU.regs().Micro, 0, mVU.microMemSize);
+	const u8* data = cached.data.data();
+	for (const mVUProgCache::Range& range : cached.ranges)
+	{
+		std::memcpy(mVU.regs().Micro + range.start, data, range.end - range.start);
+		data += range.end - range.start;
+	}
+
+	mVU.prog.cleared = 0;
+	mVU.prog.isSame  = 1;
+	mVU.prog.cur     = mVUcreateProg(mVU, cached.start_pc / 8);
+	mVU.prog.cur->cacheHash = cached.hash;
+	for (const mVUProgCache::Block& block : cached.blocks)
+	{
+		alignas(16) microRegInfo pState;
+		std::memcpy(&pState, block.state, sizeof(pState));
+		mVUblockFetch(mVU, block.pc, (uptr)&pState);
+	}
+	return mVU.prog.cur;
+}
+
+// Recompiles the programs in the program cache, so they don't need compiling when the game first runs them
+void mVUprecompileProgs(microVU& mVU)
+{
+	if (!mVUProgCache::IsOpen(mVU.index))
+		return;
+
+	// Leave room for the programs the cache doesn't know about, filling the whole buffer would just reset it.
+	// With eviction, everything has to go in the first region, since regions are only moved on between runs.
+	const u8* limit = mVU.prog.x86start + (mVU.prog.x86end - mVU.prog.x86start) / 2;
+	const bool eviction = EmuConfig.Cpu.Recompiler.EnableCodeEviction;
+
+	// Blocks are compiled from micro memory, so the cached program has to be put there temporarily
+	const std::vector<u8> micro(mVU.regs().Micro, mVU.regs().Micro + mVU.microMemSize);
+
+	xSetPtr(mVU.prog.x86ptr);
+	for (const mVUProgCache::Program& cached : mVUProgCache::GetPrograms(mVU.index))
+	{
+		const u64 start = Common::Timer::GetCurrentValue();
+		microProgram* prog = NULL;
+		if (xGetPtr() < limit && !(eviction && mVU.codeRegions.IsFull(xGetPtr())))
+			prog = mVUcompileCachedProg(mVU, cached);
+		if (!prog)
+		{
+			mVUProgCache::AddSkipped(mVU.index);
+			continue;
+		}
+
+		mVU.prog.prog[cached.start_pc / 8]->push_back(prog);
+		mVUProgCache::AddPrecompiled(mVU.index, static_cast<u32>(cached.blocks.size()), Common::Timer::GetCurrentValue() - start);
+	}
+	mVU.prog.x86ptr = xGetPtr();
+
+	std::memcpy(mVU.regs().Micro, micro.data(), mVU.microMemSize);
+	std::memset(&mVU.prog.lpState, 0, sizeof(mVU.prog.lpState));
+	mVU.prog.cleared = 1;
+	mVU.prog.isSame  = -1;
+	mVU.prog.cur     = NULL;
+}
+
+// Compiles the programs in the program cache with and without VEX encodings, and reports the
+// size and compile time of each. The code is thrown away afterwards; programs aren't run, since
+// there's no guest state to run them with at this point (core_test's MicroVUVexTest runs recorded
+// programs on both paths, and compares and times them).
+void mVUbenchmarkCodegen(microVU& mVU)
+{
+	if (!mVUProgCache::IsOpen(mVU.index) || !cpuinfo_has_x86_avx())
+		return;
+
+	const u8* limit = mVU.prog.x86start + (mVU.prog.x86end - mVU.prog.x86start) / 2;
+	const std::vector<u8> micro(mVU.regs().Micro, mVU.regs().Micro + mVU.microMemSize);
+	const bool useVEX = mVU.useVEX;
+
+	// The SSE path goes first since its code is larger, the VEX path compiles the same programs.
+	u32 numProgs = UINT32_MAX;
+	for (const bool vex : {false, true})
+	{
+		mVU.useVEX = vex;
+		u32 programs = 0;
+		u32 blocks = 0;
+
+		xSetPtr(mVU.prog.x86ptr);
+		const u64 start = Common::Timer::GetCurrentValue();
+		for (const mVUProgCache::Program& cached : mVUProgCache::GetPrograms(mVU.index))
+		{
+			if (programs == numProgs || xGetPtr() >= limit)
+				break;
+
+			microProgram* prog = mVUcompileCachedProg(mVU, cached);
+			if (!prog)
+				continue;
+
+			mVUdeleteProg(mVU, prog);
+			programs++;
+			blocks += static_cast<u32>(cached.blocks.size());
+		}
+		const u64 ticks = Common::Timer::GetCurrentValue() - start;
+		numProgs = programs;
+
+		Console.WriteLn("microVU%u codegen benchmark (%s): %u programs, %u blocks, %zu bytes in %.2f ms.", mVU.index,
+			vex ? "VEX" : "SSE", programs, blocks, static_cast<size_t>(xGetPtr() - mVU.prog.x86ptr),
+			Common::Timer::ConvertValueToMilliseconds(ticks));
+	}
+
+	xSetPtr(mVU.prog.x86ptr);
+	std::memcpy(mVU.regs().Micro, micro.data(), mVU.microMemSize);
+	std::memset(&mVU.prog.lpState, 0, sizeof(mVU.prog.lpState));
+	mVU.useVEX       = useVEX;
+	mVU.prog.total   = 0;
+	mVU.prog.cleared = 1;
+	mVU.prog.isSame  = -1;
+	mVU.prog.cur     = NULL;
+}
+
 // Generate Hash for partial program based on compiled ranges...
 u64 mVUrangesHash(microVU& mVU, microProgram& prog)
 {
@@ -214,11 +561,85 @@ void mVUprintUniqueRatio(microVU& mVU)
 	DevCon.WriteLn("%d / %d [%3.1f%%]", v.size(), total, 100. - (double)v.size() / (double)total * 100.);
 }
 
+// Hashes one instruction of micro memory. The slot is mixed in so moved code hashes differently.
+static __fi u64 mVUslotHash(u64 instr, u32 slot)
+{
+	u64 h = instr ^ ((u64)(slot + 1) * 0x9E3779B97F4A7C15ull);
+	h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+	h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+	return h ^ (h >> 31);
+}
+
+// Rehashes the instructions which were written since the last search
+static void mVUupdateHash(microVU& mVU)
+{
+	const u32 slots = mVU.progSize / 2;
+	const u64* micro = (const u64*)mVU.regs().Micro;
+	for (u32 w = 0; w < slots / 64; w++)
+	{
+		u64 dirty = mVU.prog.hashDirty[w];
+		mVU.prog.hashDirty[w] = 0;
+		while (dirty)
+		{
+			const u32 i = w * 64 + std::countr_zero(dirty);
+			dirty &= dirty - 1;
+
+			const u64 h = mVUslotHash(micro[i], i);
+			const u64 delta = h - mVU.prog.hashSlot[i];
+			mVU.prog.hashSlot[i] = h;
+			for (u32 j = i + 1; j <= slots; j += j & (0 - j))
+				mVU.prog.hashTree[j] += delta;
+		}
+	}
+}
+
+// Sum of the hashes of the first 'slots' instructions of micro memory
+static __fi u64 mVUhashPrefix(const microVU& mVU, u32 slots)
+{
+	u64 sum = 0;
+	for (u32 j = slots; j > 0; j -= j & (0 - j))
+		sum += mVU.prog.hashTree[j];
+	return sum;
+}
+
+// Hash of micro memory over the ranges of a program, comparable to mVUprogHash()
+static u64 mVUmemHash(const microVU& mVU, const microProgram& prog)
+{
+	u64 hash = 0;
+	for (const microRange& range : *prog.ranges)
+	{
+		if (range.end > range.start && range.start >= 0)
+			hash += mVUhashPrefix(mVU, range.end / 8) - mVUhashPrefix(mVU, range.start / 8);
+	}
+	return hash;
+}
+
+// Hash of a cached program over its ranges, recomputed when they've changed
+static u64 mVUprogHash(microProgram& prog)
+{
+	if (!prog.hashValid)
+	{
+		const u64* data = (const u64*)prog.data;
+		prog.hash = 0;
+		for (const microRange& range : *prog.ranges)
+		{
+			if (range.end > range.start && range.start >= 0)
+			{
+				for (u32 i = range.start / 8; i < (u32)range.end / 8; i++)
+					prog.hash += mVUslotHash(data[i], i);
+			}
+		}
+		prog.hashValid = true;
+	}
+	return prog.hash;
+}
+
 // Compare Cached microProgram to mVU.regs().Micro
 __fi bool mVUcmpProg(microVU& mVU, microProgram& prog)
 {
 	if (doWholeProgCompare)
 	{
+		mVU.prog.stats.frameCmpBytes += mVU.microMemSize;
 		if (memcmp((u8*)prog.data, mVU.regs().Micro, mVU.microMemSize))
 			return false;
 	}
@@ -232,6 +653,7 @@ __fi bool mVUcmpProg(microVU& mVU, microProgram& prog)
 #endif
 			auto cmpOffset = [&](void* x) { return (u8*)x + range.start; };
 
+			mVU.prog.stats.frameCmpBytes += range.end - range.start;
 			if (memcmp(cmpOffset(prog.data), cmpOffset(mVU.regs().Micro), (range.end - range.start)))
 				return false;
 		}
@@ -251,15 +673,38 @@ _mVUt __fi void* mVUsearchProg(u32 startPC, uptr pState)
 
 	if (!quick.prog) // If null, we need to search for new program
 	{
+		microSearchStats& stats = mVU.prog.stats;
+		if (mVU.prog.curFrame != g_FrameCount)
+		{
+			mVU.prog.curFrame = g_FrameCount;
+			stats.frames++;
+			stats.cmpBytes += stats.frameCmpBytes;
+			stats.maxProbes = std::max(stats.maxProbes, stats.frameProbes);
+			stats.maxCmpBytes = std::max(stats.maxCmpBytes, stats.frameCmpBytes);
+			stats.frameProbes = 0;
+			stats.frameCmpBytes = 0;
+		}
+		stats.searches++;
+
+		// Only programs whose ranges hash the same as micro memory need comparing
+		mVUupdateHash(mVU);
 		std::deque<microProgram*>::iterator it(list->begin());
 		for (; it != list->end(); ++it)
 		{
+			stats.probes++;
+			stats.frameProbes++;
+			if (mVUprogHash(*it[0]) != mVUmemHash(mVU, *it[0]))
+				continue;
+
 			bool b = mVUcmpProg(mVU, *it[0]);
+			stats.falseHits += !b;
 
 			if (b)
 			{
 				quick.block = it[0]->block[startPC / 8];
 				quick.prog  = it[0];
+				quick.prog->used = true;
+				quick.prog->lastFrame = g_FrameCount;
 				list->erase(it);
 				list->push_front(quick.prog);
 
@@ -277,6 +722,7 @@ _mVUt __fi void* mVUsearchProg(u32 startPC, uptr pState)
 		mVU.prog.cleared = 0;
 		mVU.prog.isSame  = 1;
 		mVU.prog.cur     = mVUcreateProg(mVU, mVU.regs().start_pc/8);
+		mVU.prog.cur->used = true;
 		void* entryPoint = mVUblockFetch(mVU,  startPC, pState);
 		quick.block      = mVU.prog.cur->block[startPC/8];
 		quick.prog       = mVU.prog.cur;
@@ -288,6 +734,7 @@ _mVUt __fi void* mVUsearchProg(u32 startPC, uptr pState)
 	// If list.quick, then we've already found and recompiled the program ;)
 	mVU.prog.isSame = -1;
 	mVU.prog.cur = quick.prog;
+	mVU.prog.cur->lastFrame = g_FrameCount;
 	// Because the VU's can now run in sections and not whole programs at once
 	// we need to set the current block so it gets the right program back
 	quick.block = mVU.prog.cur->block[startPC / 8];
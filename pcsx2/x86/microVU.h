@@ -14,7 +14,9 @@
 #include "MTVU.h"
 #include "GS.h"
 #include "Gif_Unit.h"
+#include "PerformanceMetrics.h"
 #include "iR5900.h"
+#include "BaseblockEx.h"
 #include "R5900OpcodeTables.h"
 #include "common/emitter/x86emitter.h"
 #include "microVU_Misc.h"
@@ -50,6 +52,12 @@ struct microProgram
 	std::deque<microRange>* ranges;          // The ranges of the microProgram that have already been recompiled
 	u32 startPC; // Start PC of this program
 	int idx;     // Program index
+	u64 hash;       // Hash of data over ranges (see mVUprogHash)
+	bool hashValid; // hash is up to date with ranges
+	bool used;      // Program has run (as opposed to only being precompiled from the program cache)
+	u64 cacheHash;  // Program cache entry this program was precompiled from (0 = none)
+	u32 lastFrame;  // Frame the program last ran in
+	u8  regions;    // Rec-cache regions holding code for this program (bit per region)
 };
 
 typedef std::deque<microProgram*> microProgramList;
@@ -60,6 +68,19 @@ struct microProgramQuick
 	microProgram*      prog;  // The microProgram who is the owner of 'block'
 };
 
+struct microSearchStats
+{
+	u32 searches;    // Program searches (after micro memory was written)
+	u32 probes;      // Cached programs whose hash was checked
+	u32 falseHits;   // Hash matches which failed the confirming compare
+	u64 cmpBytes;    // Bytes compared to confirm hash matches
+	u32 frames;      // Frames with at least one search
+	u32 maxProbes;   // Most probes in a single frame
+	u64 maxCmpBytes; // Most bytes compared in a single frame
+	u32 frameProbes;
+	u64 frameCmpBytes;
+};
+
 struct microProgManager
 {
 	microIR<mProgSize> IRinfo;             // IR information
@@ -74,9 +95,15 @@ struct microProgManager
 	u8*                x86start;           // Start of program's rec-cache
 	u8*                x86end;             // Limit of program's rec-cache
 	microRegInfo       lpState;            // Pipeline state from where program left off (useful for continuing execution)
+	u64                hashSlot[mProgSize/2];      // Hash of each instruction in micro memory
+	u64                hashTree[mProgSize/2 + 1];  // Fenwick tree over hashSlot, for hashing program ranges
+	u64                hashDirty[mProgSize/2/64];  // Instructions written since hashTree was last updated
+	microSearchStats   stats;              // Program search counters
 };
 
 static const uint mVUcacheSafeZone =  3; // Safe-Zone for program recompilation (in megabytes)
+static const uint mVUevictFrames   = 60; // Programs which ran in this many frames keep their rec-cache regions from eviction
+static_assert(RecCodeRegions::NUM_REGIONS <= 8, "microProgram::regions needs more bits");
 
 struct microVU
 {
@@ -94,8 +121,10 @@ struct microVU
 	u32 progSize;     // VU Micro Memory Size (in u32's)
 	u32 progMemMask;  // VU Micro Memory Size (in u32's)
 	u32 cacheSize;    // VU Cache Size
+	bool useVEX;      // Emit 3-operand VEX encodings for FMAC ops (host has AVX)
 
 	microProgManager               prog;     // Micro Program Data
+	RecCodeRegions                 codeRegions; // Rec-cache regions, for evicting programs instead of resetting when full
 	microProfiler                  profiler; // Opcode Profiler
 	std::unique_ptr<microRegAlloc> regAlloc; // Reg Alloc Class
 	std::FILE*                     logFile;  // Log File Pointer
@@ -146,6 +175,14 @@ private:
 
 public:
 	inline int getFullListCount() const { return fListI; }
+	template <typename F>
+	void forEachBlock(F&& f) const
+	{
+		for (microBlockLink* linkI = qBlockList; linkI != nullptr; linkI = linkI->next)
+			f(linkI->block);
+		for (microBlockLink* linkI = fBlockList; linkI != nullptr; linkI = linkI->next)
+			f(linkI->block);
+	}
 	microBlockManager()
 	{
 		qListI = fListI = 0;
@@ -288,6 +325,11 @@ mVUop(mVUopL);
 // Private Functions
 extern void mVUcacheProg(microVU& mVU, microProgram& prog);
 extern void mVUdeleteProg(microVU& mVU, microProgram*& prog);
+extern void mVUrecordProg(microVU& mVU, microProgram& prog);
+extern void mVUrecordProgs(microVU& mVU);
+extern void mVUevictRegion(microVU& mVU);
+extern void mVUprecompileProgs(microVU& mVU);
+extern void mVUbenchmarkCodegen(microVU& mVU);
 _mVUt extern void* mVUsearchProg(u32 startPC, uptr pState);
 extern void* mVUexecuteVU0(u32 startPC, u32 cycles);
 extern void* mVUexecuteVU1(u32 startPC, u32 cycles);
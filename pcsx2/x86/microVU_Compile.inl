@@ -36,6 +36,7 @@ __fi void mVUcheckIsSame(mV)
 void mVUsetupRange(microVU& mVU, s32 pc, bool isStartPC)
 {
 	std::deque<microRange>*& ranges = mVUcurProg.ranges;
+	mVUcurProg.hashValid = false;
 	if (pc > (s64)mVU.microMemSize)
 	{
 		Console.Error("microVU%d: PC outside of VU memory PC=0x%04x", mVU.index, pc);
@@ -550,6 +551,7 @@ __fi void mVUinitFirstPass(microVU& mVU, uptr pState, u8* thisPtr)
 	mVUregs.viBackUp  = 0;
 	mVUregs.flagInfo  = 0;
 	mVUsFlagHack = CHECK_VU_FLAGHACK;
+	mVUsFlagDead = false;
 	mVUinitConstValues(mVU);
 }
 
@@ -697,6 +699,7 @@ void* mVUcompile(microVU& mVU, u32 startPC, uptr pState)
 
 	// First Pass
 	iPC = startPC / 4;
+	mVUcurProg.regions |= 1u << mVU.codeRegions.GetCurrentRegion();
 	mVUsetupRange(mVU, startPC, 1); // Setup Program Bounds/Range
 	mVU.regAlloc->reset(false);          // Reset regAlloc
 	mVUinitFirstPass(mVU, pState, thisPtr);
@@ -340,9 +340,15 @@ _mVUt void mVUcleanUp()
 
 	mVU.prog.x86ptr = x86Ptr;
 
-	if ((xGetPtr() < mVU.prog.x86start) || (xGetPtr() >= mVU.prog.x86end))
+	if (EmuConfig.Cpu.Recompiler.EnableCodeEviction)
+	{
+		if (mVU.codeRegions.IsFull(xGetPtr()))
+			mVUevictRegion(mVU);
+	}
+	else if ((xGetPtr() < mVU.prog.x86start) || (xGetPtr() >= mVU.prog.x86end))
 	{
 		Console.WriteLn(vuIndex ? Color_Orange : Color_Magenta, "microVU%d: Program cache limit reached.", mVU.index);
+		PerformanceMetrics::AddVUCacheReset(mVU.index);
 		mVUreset(mVU, false);
 	}
 
@@ -110,6 +110,30 @@ __fi void mVUsetFlags(mV, microFlagCycles& mFC)
 	u32 aCount = 0; // Amount of instructions needed to get valid mac flag instances for block linking
 	//bool writeProtect = false;
 
+	// Sticky status flag bits from the end of the block are overwritten by FSSET in the following blocks before
+	// anything reads them, so status updates which only need to set sticky bits can be skipped (same as the
+	// in-block FSSET optimization). Stops at the last flag read in the block, or an update which has to set
+	// the non-sticky bits.
+	if (mVUsFlagDead && !__Status && !noFlagOpts && !mVUsFlagHack && !CHECK_VUOVERFLOWHACK)
+	{
+		bool endsProgram = false;
+		iPC = mVUstartPC;
+		for (u32 i = 0; i < mVUcount; i++)
+		{
+			endsProgram |= mVUup.eBit || mVUup.tBit || mVUup.mBit;
+			incPC2(2);
+		}
+		iPC = endPC;
+		for (int i = mVUcount; (i > 0) && !endsProgram; i--)
+		{
+			if (mVUlow.readFlags || sFLAG.doNonSticky)
+				break;
+			sFLAG.doFlag = false;
+			incPC2(-2);
+		}
+		iPC = endPC;
+	}
+
 	// Ensure last ~4+ instructions update mac/status flags (if next block's first 4 instructions will read them)
 	for (int i = mVUcount; i > 0; i--, aCount++)
 	{
@@ -429,6 +453,90 @@ void mVUflagPass(mV, u32 startPC, u32 sCount = 0, u32 found = 0)
 	_mVUflagPass(mVU, startPC, sCount, found, v);
 }
 
+// Follows the program from startPC, and checks if FSSET overwrites the sticky status flag bits on every
+// path before anything can read them (FSAND/FSEQ/FSOR, the end of the program, or an unknown jump).
+// Reads in the 4 instructions after FSSET can still see an older flag instance, so they count too.
+bool _mVUsFlagDeadPass(mV, u32 startPC, u32& budget, std::vector<u32>& v)
+{
+	for (u32 i = 0; i < v.size(); i++)
+	{
+		if (v[i] == startPC)
+			return true; // Loops back, or was already checked on another path
+	}
+	v.push_back(startPC);
+
+	int oldPC = iPC;
+	int oldBranch = mVUbranch;
+	int aBranchAddr = 0;
+	int sinceFSSET = -1;
+	bool dead = false;
+	iPC = startPC / 4;
+	mVUbranch = 0;
+	for (int branch = 0; budget > 0; budget--)
+	{
+		incPC(1);
+		if ((curI & (_Ebit_ | _Tbit_)) || ((curI & _Dbit_) && doDBitHandling) || ((curI & _Mbit_) && isVU0))
+			break;
+
+		mVUregs.needExactMatch = 0;
+		mVUopU(mVU, 3);
+		if (!(curI & _Ibit_))
+		{
+			incPC(-1);
+			mVUopL(mVU, 3);
+			incPC(1);
+		}
+
+		if (mVUregs.needExactMatch & 1) // Status flag read
+			break;
+		if (mVUregs.needExactMatch & 0x10) // FSSET
+			sinceFSSET = 0;
+		else if ((sinceFSSET >= 0) && (++sinceFSSET >= 4))
+		{
+			dead = true;
+			break;
+		}
+
+		if (branch) // Delay slot
+		{
+			// Give up on FSSET close to a branch, branches in delay slots and JR/JALR
+			if ((sinceFSSET >= 0) || mVUbranch || (branch == 5))
+				break;
+			if (!_mVUsFlagDeadPass(mVU, aBranchAddr, budget, v))
+				break;
+			if (branch == 3) // Non-conditional Branch
+			{
+				dead = true;
+				break;
+			}
+			branch = 0; // Conditional Branch, carry on with the not-taken path
+		}
+		else if (mVUbranch)
+		{
+			branch = ((mVUbranch > 8) ? (5) : ((mVUbranch < 3) ? 3 : 4));
+			incPC(-1);
+			aBranchAddr = branchAddr(mVU);
+			incPC(1);
+			mVUbranch = 0;
+		}
+		incPC(1);
+	}
+	iPC = oldPC;
+	mVUbranch = oldBranch;
+	setCode();
+	return dead;
+}
+
+bool mVUsFlagDeadPass(mV, u32 startPC)
+{
+	std::vector<u32> v;
+	u32 budget = 256; // Instructions to look through before giving up
+	const u8 needExactMatch = mVUregs.needExactMatch;
+	const bool dead = _mVUsFlagDeadPass(mVU, startPC, budget, v);
+	mVUregs.needExactMatch = needExactMatch;
+	return dead;
+}
+
 // Checks if the first ~4 instructions of a block will read flags
 void mVUsetFlagInfo(mV)
 {
@@ -442,6 +550,7 @@ void mVUsetFlagInfo(mV)
 	{
 		incPC(-1);
 		mVUflagPass(mVU, branchAddr(mVU));
+		mVUsFlagDead = mVUsFlagDeadPass(mVU, branchAddr(mVU));
 		incPC(1);
 
 		mVUregs.needExactMatch &= 0x7;
@@ -450,11 +559,13 @@ void mVUsetFlagInfo(mV)
 	{
 		incPC(-1); // Branch Taken
 		mVUflagPass(mVU, branchAddr(mVU));
+		mVUsFlagDead = mVUsFlagDeadPass(mVU, branchAddr(mVU));
 		int backupFlagInfo = mVUregs.needExactMatch;
 		mVUregs.needExactMatch = 0;
 
 		incPC(4); // Branch Not Taken
 		mVUflagPass(mVU, xPC);
+		mVUsFlagDead = mVUsFlagDead && mVUsFlagDeadPass(mVU, xPC);
 		incPC(-3);
 
 		mVUregs.needExactMatch |= backupFlagInfo;
@@ -469,6 +580,7 @@ void mVUsetFlagInfo(mV)
 		else
 		{
 			mVUflagPass(mVU, (mVUlow.constJump.regValue * 8) & (mVU.microMemSize - 8));
+			mVUsFlagDead = mVUsFlagDeadPass(mVU, (mVUlow.constJump.regValue * 8) & (mVU.microMemSize - 8));
 		}
 		mVUregs.needExactMatch &= 0x7;
 	}
@@ -195,6 +195,7 @@ struct microIR
 	u32 curPC;     // Current PC
 	u32 startPC;   // Start PC for Cur Block
 	u32 sFlagHack; // Optimize out all Status flag updates if microProgram doesn't use Status flags
+	u32 sFlagDead; // Sticky Status flag bits at the end of the block are overwritten (FSSET) before being read
 };
 
 //------------------------------------------------------------------
@@ -626,6 +627,27 @@ public:
 		}
 	}
 
+	// In COP2 mode, the EE keeps VF regs cached across instructions, but only whole ones. Rather than writing
+	// back a partially written reg after every macro op (and loading it again in the next one), the vectors
+	// which weren't written are loaded from memory, and it's kept as a dirty reg.
+	void fillPartialCOP2(const xmm& reg)
+	{
+		microMapXMM& mapX = xmmMap[reg.Id];
+		const int xyzw = mapX.xyzw;
+		if (xyzw == 4 || xyzw == 2 || xyzw == 1) // Single vector ops on y/z/w leave the result in x
+			xPSHUF.D(reg, reg, 0);
+
+		const int mask = ((xyzw & 1) << 3) | ((xyzw & 2) << 1) | ((xyzw & 4) >> 1) | ((xyzw & 8) >> 3);
+		if (mapX.VFreg == 32)
+			xBLEND.PS(reg, ptr128[&regs().ACC], ~mask & 0xf);
+		else
+			xBLEND.PS(reg, ptr128[&getVF(mapX.VFreg)], ~mask & 0xf);
+
+		mapX.xyzw  = 0xf;
+		mapX.count = counter;
+		updateCOP2AllocState(reg.Id);
+	}
+
 	void clearRegCOP2(int xmmReg)
 	{
 		if (regAllocCOP2)
@@ -738,6 +760,8 @@ public:
 				}
 				if (mergeRegs == 2) // Clear Current Reg if Merged
 					clearReg(reg);
+				else if (mergeRegs == 1 && regAllocCOP2 && clear.VFreg <= 32) // Keep it cached for the next COP2 op
+					fillPartialCOP2(reg);
 				else if (mergeRegs == 1) // Write Back Partial Writes if couldn't merge
 					writeBackReg(reg);
 			}
@@ -818,6 +818,7 @@ mVUop(mVU_FSSET)
 		mVU.profiler.EmitOp(opFSSET);
 	}
 	pass3 { mVUlog("FSSET $%x", _Imm12_); }
+	pass4 { mVUregs.needExactMatch |= 0x10; }
 }
 
 //------------------------------------------------------------------
@@ -191,6 +191,7 @@ typedef Fntype_mVUrecInst* Fnptr_mVUrecInst;
 #define mVUregsTemp  mVU.prog.IRinfo.regsTemp
 #define iPC          mVU.prog.IRinfo.curPC
 #define mVUsFlagHack mVU.prog.IRinfo.sFlagHack
+#define mVUsFlagDead mVU.prog.IRinfo.sFlagDead
 #define mVUconstReg  mVU.prog.IRinfo.constReg
 #define mVUstartPC   mVU.prog.IRinfo.startPC
 #define mVUinfo      mVU.prog.IRinfo.info[iPC / 2]
@@ -594,3 +594,12 @@ void SSE_DIVSS(mV, const xmm& to, const xmm& from, const xmm& t1 = xEmptyReg, co
 {
 	clampOp(xDIV.SS, false);
 }
+
+// 3-operand form of SSE_ADD/SUB/MULxx for AVX hosts, the result goes to a register other than the operands.
+// Operands aren't clamped, callers only use this when mVUclamp3()/mVUclamp4() wouldn't do anything.
+void VEX_FMAC(const xmm& to, const xmm& from1, const xmm& from2, int opType, bool isSS)
+{
+	const xImplAVX_ArithFloat& op = (opType == 1) ? xVSUB : ((opType == 2) ? xVMUL : xVADD);
+	if (isSS) op.SS(to, from1, from2);
+	else      op.PS(to, from1, from2);
+}
@@ -0,0 +1,382 @@
+// SPDX-FileCopyrightText: 2002-2024 PCSX2 Dev Team
+// SPDX-License-Identifier: GPL-3.0+
+
+#include "BuildVersion.h"
+#include "Config.h"
+#include "x86/microVU_ProgCache.h"
+
+#include "common/Console.h"
+#include "common/FileSystem.h"
+#include "common/Path.h"
+#include "common/Timer.h"
+
+#include "cpuinfo.h"
+#include "fmt/core.h"
+
+#define XXH_STATIC_LINKING_ONLY 1
+#define XXH_INLINE_ALL 1
+#include <xxhash.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace mVUProgCache
+{
+	static constexpr u32 CACHE_SIGNATURE = 0x4350564D; // MVPC
+	static constexpr u32 CACHE_VERSION = 1;
+
+	// Least recently used programs are dropped when the file would grow past this.
+	static constexpr size_t MAX_CACHE_SIZE = 32 * _1mb;
+
+	struct CacheHeader
+	{
+		u32 signature;
+		u32 version;
+		u64 config_hash;
+		u32 session;
+		u32 num_programs;
+	};
+
+	struct ProgramHeader
+	{
+		u32 start_pc;
+		u32 last_used;
+		u64 hash;
+		u32 num_ranges;
+		u32 data_size;
+		u32 num_blocks;
+		u32 pad;
+	};
+
+	struct Stats
+	{
+		u32 loaded;
+		u32 precompiled;
+		u32 precompiled_blocks;
+		u32 skipped;
+		u32 recorded;
+		u32 evicted;
+		u64 precompile_ticks;
+	};
+
+	struct State
+	{
+		std::string path;
+		u64 config_hash = 0;
+		u32 session = 0;
+		std::vector<Program> programs;
+		bool dirty = false;
+		Stats stats = {};
+	};
+
+	static u64 ComputeConfigHash(u32 vu);
+	static size_t GetProgramSize(const Program& program);
+	static bool LoadFile(State& state, u32 vu);
+	static bool SaveFile(State& state);
+
+	// VU1 may be reset from the MTVU thread, so each VU has its own state and only touches that.
+	static State s_state[2];
+} // namespace mVUProgCache
+
+u64 mVUProgCache::ComputeConfigHash(u32 vu)
+{
+	// Anything which changes which blocks get compiled, or the pipeline states they're entered with.
+	const struct
+	{
+		u32 version;
+		u32 vu;
+		u32 overflow;
+		u32 extra_overflow;
+		u32 sign_overflow;
+		u32 underflow;
+		u32 flag_hack;
+		u32 vu_thread;
+		u32 gamefixes;
+		u32 has_avx;
+	} key = {
+		CACHE_VERSION,
+		vu,
+		CHECK_VU_OVERFLOW(vu),
+		CHECK_VU_EXTRA_OVERFLOW(vu),
+		CHECK_VU_SIGN_OVERFLOW(vu),
+		CHECK_VU_UNDERFLOW(vu),
+		EmuConfig.Speedhacks.vuFlagHack,
+		EmuConfig.Speedhacks.vuThread,
+		EmuConfig.Gamefixes.bitset,
+		cpuinfo_has_x86_avx(),
+	};
+
+	XXH64_hash_t hash = XXH3_64bits(&key, sizeof(key));
+	hash = XXH3_64bits_withSeed(BuildVersion::GitHash, std::strlen(BuildVersion::GitHash), hash);
+	return hash;
+}
+
+size_t mVUProgCache::GetProgramSize(const Program& program)
+{
+	return sizeof(ProgramHeader) + program.ranges.size() * sizeof(Range) + program.data.size() +
+		   program.blocks.size() * sizeof(Block);
+}
+
+u32 mVUProgCache::GetMicroMemSize(u32 vu)
+{
+	return vu ? 0x4000 : 0x1000;
+}
+
+bool mVUProgCache::IsValid(const Program& program, u32 micro_mem_size)
+{
+	if (program.start_pc >= micro_mem_size || (program.start_pc & 7) != 0)
+		return false;
+
+	size_t size = 0;
+	s32 prev_end = 0;
+	for (const Range& range : program.ranges)
+	{
+		if (range.start < prev_end || range.end <= range.start || range.end > static_cast<s32>(micro_mem_size))
+			return false;
+		size += range.end - range.start;
+		prev_end = range.end;
+	}
+	if (size != program.data.size())
+		return false;
+
+	return std::all_of(program.blocks.begin(), program.blocks.end(),
+		[micro_mem_size](const Block& block) { return block.pc < micro_mem_size && (block.pc & 7) == 0; });
+}
+
+u64 mVUProgCache::ComputeHash(u32 start_pc, const std::vector<Range>& ranges, const std::vector<u8>& data)
+{
+	XXH64_hash_t hash = XXH3_64bits_withSeed(ranges.data(), ranges.size() * sizeof(Range), start_pc);
+	hash = XXH3_64bits_withSeed(data.data(), data.size(), hash);
+	return hash;
+}
+
+void mVUProgCache::Open(u32 vu, const std::string& serial, u32 crc)
+{
+	State& state = s_state[vu];
+	const u64 config_hash = ComputeConfigHash(vu);
+	std::string path = Path::Combine(EmuFolders::Cache, fmt::format("mvu{}_{}_{:08X}.bin", vu, Path::SanitizeFileName(serial), crc));
+	if (path == state.path && config_hash == state.config_hash)
+		return;
+
+	Close(vu);
+
+	state.path = std::move(path);
+	state.config_hash = config_hash;
+
+	if (!LoadFile(state, vu))
+	{
+		state.programs.clear();
+		state.session = 0;
+	}
+	state.session++;
+	state.stats.loaded = static_cast<u32>(state.programs.size());
+
+	Console.WriteLn("microVU%u program cache: %zu programs loaded from '%s'.", vu, state.programs.size(),
+		Path::GetFileName(state.path).data());
+}
+
+void mVUProgCache::Close(u32 vu)
+{
+	State& state = s_state[vu];
+	if (state.path.empty())
+		return;
+
+	if (state.dirty && !SaveFile(state))
+		Console.Error("microVU%u program cache: Failed to write '%s'.", vu, state.path.c_str());
+
+	const Stats& stats = state.stats;
+	if (stats.loaded > 0 || stats.recorded > 0)
+	{
+		Console.WriteLn("microVU%u program cache: %u loaded, %u precompiled (%u blocks in %.2f ms), %u skipped, %u recorded, %u evicted.",
+			vu, stats.loaded, stats.precompiled, stats.precompiled_blocks,
+			Common::Timer::ConvertValueToMilliseconds(stats.precompile_ticks), stats.skipped, stats.recorded, stats.evicted);
+	}
+
+	state = {};
+}
+
+bool mVUProgCache::ReadFile(u32 vu, std::string path, std::vector<Program>* programs)
+{
+	State state;
+	state.path = std::move(path);
+	state.config_hash = ComputeConfigHash(vu);
+	if (!LoadFile(state, vu))
+		return false;
+
+	*programs = std::move(state.programs);
+	return true;
+}
+
+bool mVUProgCache::IsOpen(u32 vu)
+{
+	return !s_state[vu].path.empty();
+}
+
+const std::vector<mVUProgCache::Program>& mVUProgCache::GetPrograms(u32 vu)
+{
+	return s_state[vu].programs;
+}
+
+void mVUProgCache::Record(u32 vu, Program program, u64 prev_hash)
+{
+	State& state = s_state[vu];
+	if (state.path.empty())
+		return;
+
+	program.last_used = state.session;
+
+	auto it = std::find_if(state.programs.begin(), state.programs.end(), [&program, prev_hash](const Program& p) {
+		return p.hash == program.hash || (prev_hash != 0 && p.hash == prev_hash);
+	});
+	if (it != state.programs.end())
+	{
+		// Nothing new if it's the same program, and it's already been marked as used this session.
+		if (it->hash == program.hash && it->last_used == state.session && it->blocks.size() == program.blocks.size())
+			return;
+
+		*it = std::move(program);
+	}
+	else
+	{
+		state.programs.push_back(std::move(program));
+	}
+
+	state.stats.recorded++;
+	state.dirty = true;
+}
+
+void mVUProgCache::AddPrecompiled(u32 vu, u32 blocks, u64 ticks)
+{
+	Stats& stats = s_state[vu].stats;
+	stats.precompiled++;
+	stats.precompiled_blocks += blocks;
+	stats.precompile_ticks += ticks;
+}
+
+void mVUProgCache::AddSkipped(u32 vu)
+{
+	s_state[vu].stats.skipped++;
+}
+
+bool mVUProgCache::LoadFile(State& state, u32 vu)
+{
+	std::optional<std::vector<u8>> data = FileSystem::ReadBinaryFile(state.path.c_str());
+	if (!data.has_value())
+		return false;
+
+	const u8* ptr = data->data();
+	const u8* end = ptr + data->size();
+	const auto read = [&ptr, end](void* dest, size_t size) {
+		if (static_cast<size_t>(end - ptr) < size)
+			return false;
+		std::memcpy(dest, ptr, size);
+		ptr += size;
+		return true;
+	};
+	const auto read_vector = [&read, &ptr, end](auto& vec, u32 count) {
+		// Don't trust the count with an allocation before checking there's that much data left.
+		const size_t size = static_cast<size_t>(count) * sizeof(vec[0]);
+		if (static_cast<size_t>(end - ptr) < size)
+			return false;
+		vec.resize(count);
+		return read(vec.data(), size);
+	};
+
+	CacheHeader header;
+	if (!read(&header, sizeof(header)) || header.signature != CACHE_SIGNATURE || header.version != CACHE_VERSION ||
+		header.config_hash != state.config_hash)
+	{
+		Console.Warning("microVU program cache: '%s' is stale or corrupted, discarding.", Path::GetFileName(state.path).data());
+		return false;
+	}
+
+	state.session = header.session;
+	state.programs.reserve(std::min<size_t>(header.num_programs, (end - ptr) / sizeof(ProgramHeader)));
+	for (u32 i = 0; i < header.num_programs; i++)
+	{
+		ProgramHeader pheader;
+		Program program;
+		if (!read(&pheader, sizeof(pheader)) ||
+			!read_vector(program.ranges, pheader.num_ranges) ||
+			!read_vector(program.data, pheader.data_size) ||
+			!read_vector(program.blocks, pheader.num_blocks))
+		{
+			Console.Warning("microVU program cache: '%s' is truncated, discarding.", Path::GetFileName(state.path).data());
+			return false;
+		}
+
+		program.start_pc = pheader.start_pc;
+		program.last_used = pheader.last_used;
+		program.hash = pheader.hash;
+		if (!IsValid(program, GetMicroMemSize(vu)) ||
+			ComputeHash(program.start_pc, program.ranges, program.data) != program.hash)
+		{
+			Console.Warning("microVU program cache: '%s' is corrupted, discarding.", Path::GetFileName(state.path).data());
+			return false;
+		}
+
+		state.programs.push_back(std::move(program));
+	}
+
+	if (ptr != end)
+	{
+		Console.Warning("microVU program cache: '%s' has trailing data, discarding.", Path::GetFileName(state.path).data());
+		return false;
+	}
+
+	// Programs are precompiled in this order until the code buffer fills up.
+	std::stable_sort(state.programs.begin(), state.programs.end(),
+		[](const Program& a, const Program& b) { return a.last_used > b.last_used; });
+	return true;
+}
+
+bool mVUProgCache::SaveFile(State& state)
+{
+	std::stable_sort(state.programs.begin(), state.programs.end(),
+		[](const Program& a, const Program& b) { return a.last_used > b.last_used; });
+
+	size_t size = sizeof(CacheHeader);
+	u32 num_programs = 0;
+	for (const Program& program : state.programs)
+	{
+		const size_t program_size = GetProgramSize(program);
+		if ((size + program_size) > MAX_CACHE_SIZE)
+			break;
+		size += program_size;
+		num_programs++;
+	}
+	state.stats.evicted += static_cast<u32>(state.programs.size()) - num_programs;
+
+	std::vector<u8> data;
+	data.reserve(size);
+	const auto write = [&data](const void* src, size_t size) {
+		const u8* bytes = static_cast<const u8*>(src);
+		data.insert(data.end(), bytes, bytes + size);
+	};
+
+	CacheHeader header = {};
+	header.signature = CACHE_SIGNATURE;
+	header.version = CACHE_VERSION;
+	header.config_hash = state.config_hash;
+	header.session = state.session;
+	header.num_programs = num_programs;
+	write(&header, sizeof(header));
+
+	for (u32 i = 0; i < num_programs; i++)
+	{
+		const Program& program = state.programs[i];
+		ProgramHeader pheader = {};
+		pheader.start_pc = program.start_pc;
+		pheader.last_used = program.last_used;
+		pheader.hash = program.hash;
+		pheader.num_ranges = static_cast<u32>(program.ranges.size());
+		pheader.data_size = static_cast<u32>(program.data.size());
+		pheader.num_blocks = static_cast<u32>(program.blocks.size());
+		write(&pheader, sizeof(pheader));
+		write(program.ranges.data(), program.ranges.size() * sizeof(Range));
+		write(program.data.data(), program.data.size());
+		write(program.blocks.data(), program.blocks.size() * sizeof(Block));
+	}
+
+	return FileSystem::WriteBinaryFile(state.path.c_str(), data.data(), data.size());
+}
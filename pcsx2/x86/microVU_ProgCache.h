@@ -0,0 +1,80 @@
+// SPDX-FileCopyrightText: 2002-2024 PCSX2 Dev Team
+// SPDX-License-Identifier: GPL-3.0+
+
+#pragma once
+
+#include "common/Pcsx2Types.h"
+
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------------------------------------
+//  mVUProgCache
+// --------------------------------------------------------------------------------------
+// Persistent, per-game cache of the microprograms each VU has run. microVU code refers to
+// its block and program structures through absolute heap pointers, so machine code can't
+// be moved between sessions; instead, the program contents are stored together with the
+// pipeline states each block was entered with, and the programs are recompiled ahead of
+// time when the game boots. The cache is only valid for a given build and VU configuration;
+// the file is discarded if either changes.
+//
+namespace mVUProgCache
+{
+	static constexpr u32 PIPELINE_STATE_SIZE = 96; // sizeof(microRegInfo)
+
+	struct Range
+	{
+		s32 start; // byte offset of the first instruction
+		s32 end; // byte offset past the last instruction
+	};
+
+	struct Block
+	{
+		u32 pc; // byte offset of the block's first instruction
+		u8 state[PIPELINE_STATE_SIZE]; // pipeline state the block was compiled for
+	};
+
+	struct Program
+	{
+		u32 start_pc;
+		u32 last_used; // session the program last ran in, for eviction
+		u64 hash; // of ranges and data
+		std::vector<Range> ranges; // sorted, non-overlapping
+		std::vector<u8> data; // micro memory contents of each range, concatenated
+		std::vector<Block> blocks;
+	};
+
+	/// Opens (or keeps open) the cache of the specified VU for a game. Any previously open
+	/// cache for a different game or configuration is written back first.
+	void Open(u32 vu, const std::string& serial, u32 crc);
+
+	/// Writes the cache back to disk if it has changed, logs statistics, and releases it.
+	void Close(u32 vu);
+
+	/// Reads the programs of a cache file recorded with this build and configuration, without opening it,
+	/// so they can be replayed outside of a game. Returns false if the file is missing, stale or corrupted.
+	bool ReadFile(u32 vu, std::string path, std::vector<Program>* programs);
+
+	bool IsOpen(u32 vu);
+
+	/// Programs to recompile, most recently used first.
+	const std::vector<Program>& GetPrograms(u32 vu);
+
+	/// Returns the size of the micro memory of the specified VU, which every range and block has to fit in.
+	u32 GetMicroMemSize(u32 vu);
+
+	/// Checks that a program's ranges are sorted, non-overlapping, inside micro memory and add up to its
+	/// data, and that its start and blocks are instructions in micro memory.
+	bool IsValid(const Program& program, u32 micro_mem_size);
+
+	/// Computes the hash identifying a program, from its ranges and data.
+	u64 ComputeHash(u32 start_pc, const std::vector<Range>& ranges, const std::vector<u8>& data);
+
+	/// Adds a program which ran this session, replacing the entry it was precompiled from
+	/// (if any, identified by prev_hash) since it may have grown since.
+	void Record(u32 vu, Program program, u64 prev_hash);
+
+	/// Statistics, reported when the cache is closed.
+	void AddPrecompiled(u32 vu, u32 blocks, u64 ticks);
+	void AddSkipped(u32 vu);
+} // namespace mVUProgCache
@@ -148,6 +148,19 @@ enum clampModes
 	cACC = 0x04, // Clamp ACC
 };
 
+// With VEX encodings, FMAC results can be written to a new register instead of a clone of Fs (or ACC),
+// which saves the movaps allocReg() emits when the source is cached. Registers read through
+// allocReg(vfLoadReg) are the cached ones, so this isn't possible if they'd have to be clamped in place.
+static bool mVUuseVEX(microVU& mVU, int opType, int clampType)
+{
+	if (!mVU.useVEX || isCOP2 || clampE || _XYZW_SS2)
+		return false;
+	if ((clampType & (cFs | cACC)) && (CHECK_VU_OVERFLOW(mVU.index) || CHECK_VU_SIGN_OVERFLOW(mVU.index)))
+		return false;
+	// Min/Max and the tri-ace ADDi hack work on their operands in place
+	return (opType <= 2) || (opType == 5 && !(_XYZW_SS && CHECK_VUADDSUBHACK));
+}
+
 // Prints Opcode to MicroProgram Logs
 static void mVU_printOP(microVU& mVU, int opCase, microOpcode opEnum, bool isACC)
 {
@@ -240,6 +253,22 @@ static void mVU_FMACa(microVU& mVU, int recPass, int opCase, int opType, bool is
 		xmm Fs, Ft, ACC, tempFt;
 		setupFtReg(mVU, Ft, tempFt, opCase, clampType);
 
+		if (!isACC && mVUuseVEX(mVU, opType, clampType))
+		{
+			Fs = mVU.regAlloc->allocReg(_Fs_);
+			const xmm& Fd = mVU.regAlloc->allocReg(-1, _Fd_, _X_Y_Z_W);
+
+			if (clampType & cFt) mVUclamp2(mVU, Ft, xEmptyReg, _X_Y_Z_W);
+			VEX_FMAC(Fd, Fs, Ft, opType, _XYZW_SS);
+			mVUupdateFlags(mVU, Fd, tempFt);
+
+			mVU.regAlloc->clearNeeded(Fd); // Always Clear Written Reg First
+			mVU.regAlloc->clearNeeded(Fs);
+			mVU.regAlloc->clearNeeded(Ft);
+			mVU.profiler.EmitOp(opEnum);
+			return;
+		}
+
 		if (isACC)
 		{
 			Fs = mVU.regAlloc->allocReg(_Fs_, 0, _X_Y_Z_W);
@@ -316,8 +345,15 @@ static void mVU_FMACb(microVU& mVU, int recPass, int opCase, int opType, microOp
 		else
 		{
 			const xmm& tempACC = mVU.regAlloc->allocReg();
-			xMOVAPS(tempACC, ACC);
-			SSE_PS[opType](mVU, tempACC, Fs, tempFt, xEmptyReg);
+			if (mVUuseVEX(mVU, opType, 0))
+			{
+				VEX_FMAC(tempACC, ACC, Fs, opType, false);
+			}
+			else
+			{
+				xMOVAPS(tempACC, ACC);
+				SSE_PS[opType](mVU, tempACC, Fs, tempFt, xEmptyReg);
+			}
 			mVUmergeRegs(ACC, tempACC, _X_Y_Z_W);
 			mVUupdateFlags(mVU, ACC, Fs, tempFt);
 			mVU.regAlloc->clearNeeded(tempACC);
@@ -341,6 +377,25 @@ static void mVU_FMACc(microVU& mVU, int recPass, int opCase, microOpcode opEnum,
 		xmm Fs, Ft, ACC, tempFt;
 		setupFtReg(mVU, Ft, tempFt, opCase, clampType);
 
+		if (mVUuseVEX(mVU, 0, clampType))
+		{
+			ACC = mVU.regAlloc->allocReg(32);
+			Fs = mVU.regAlloc->allocReg(_Fs_);
+			const xmm& Fd = mVU.regAlloc->allocReg(-1, _Fd_, _X_Y_Z_W);
+
+			if (clampType & cFt) mVUclamp2(mVU, Ft, xEmptyReg, _X_Y_Z_W);
+			VEX_FMAC(Fd, Fs, Ft, 2, _XYZW_SS);
+			VEX_FMAC(Fd, Fd, ACC, 0, _XYZW_SS);
+			mVUupdateFlags(mVU, Fd, tempFt);
+
+			mVU.regAlloc->clearNeeded(Fd); // Always Clear Written Reg First
+			mVU.regAlloc->clearNeeded(Fs);
+			mVU.regAlloc->clearNeeded(Ft);
+			mVU.regAlloc->clearNeeded(ACC);
+			mVU.profiler.EmitOp(opEnum);
+			return;
+		}
+
 		ACC = mVU.regAlloc->allocReg(32);
 		Fs = mVU.regAlloc->allocReg(_Fs_, _Fd_, _X_Y_Z_W);
 
@@ -378,6 +433,27 @@ static void mVU_FMACd(microVU& mVU, int recPass, int opCase, microOpcode opEnum,
 		xmm Fs, Ft, Fd, tempFt;
 		setupFtReg(mVU, Ft, tempFt, opCase, clampType);
 
+		if (mVUuseVEX(mVU, 1, clampType))
+		{
+			const xmm& ACC = mVU.regAlloc->allocReg(32);
+			Fs = mVU.regAlloc->allocReg(_Fs_);
+			Fd = mVU.regAlloc->allocReg(-1, _Fd_, _X_Y_Z_W);
+			const xmm& t1 = mVU.regAlloc->allocReg();
+
+			if (clampType & cFt) mVUclamp2(mVU, Ft, xEmptyReg, _X_Y_Z_W);
+			VEX_FMAC(t1, Fs, Ft, 2, _XYZW_SS);
+			VEX_FMAC(Fd, ACC, t1, 1, _XYZW_SS);
+			mVUupdateFlags(mVU, Fd, t1, tempFt);
+
+			mVU.regAlloc->clearNeeded(Fd); // Always Clear Written Reg First
+			mVU.regAlloc->clearNeeded(t1);
+			mVU.regAlloc->clearNeeded(Ft);
+			mVU.regAlloc->clearNeeded(Fs);
+			mVU.regAlloc->clearNeeded(ACC);
+			mVU.profiler.EmitOp(opEnum);
+			return;
+		}
+
 		Fs = mVU.regAlloc->allocReg(_Fs_,  0, _X_Y_Z_W);
 		Fd = mVU.regAlloc->allocReg(32, _Fd_, _X_Y_Z_W);
 
@@ -550,8 +626,15 @@ mVUop(mVU_CLIP)
 		xSHL(gprT1, 6);
 
 		xAND.PS(Ft, ptr128[mVUglob.absclip]);
-		xMOVAPS(t1, Ft);
-		xPOR(t1, ptr128[mVUglob.signbit]);
+		if (mVU.useVEX)
+		{
+			xVPOR(t1, Ft, ptr128[mVUglob.signbit]);
+		}
+		else
+		{
+			xMOVAPS(t1, Ft);
+			xPOR(t1, ptr128[mVUglob.signbit]);
+		}
 
 		xCMPNLE.PS(t1, Fs); // -w, -z, -y, -x
 		xCMPLT.PS(Ft, Fs);  // +w, +z, +y, +x
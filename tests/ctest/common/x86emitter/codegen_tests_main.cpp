@@ -217,6 +217,10 @@ TEST(CodegenTests, AVXTest)
 	CODEGEN_TEST(xVPANDN(xmm0, xmm1, xmm2), "c5 f1 df c2");
 	CODEGEN_TEST(xVPOR(xmm0, xmm1, xmm2), "c5 f1 eb c2");
 	CODEGEN_TEST(xVPXOR(xmm0, xmm1, xmm2), "c5 f1 ef c2");
+	CODEGEN_TEST(xVPADDD(xmm0, xmm1, xmm2), "c5 f1 fe c2");
+
+	CODEGEN_TEST(xVPMOVSX.BD(xmm0, ptr32[rdi]), "c4 e2 79 21 07");
+	CODEGEN_TEST(xVPBLENDD(xmm0, xmm1, xmm10, 1), "c4 c3 71 02 c2 01");
 
 	CODEGEN_TEST(xVMOVMSKPS(eax, xmm1), "c5 f8 50 c1");
 	CODEGEN_TEST(xVMOVMSKPD(eax, xmm1), "c5 f9 50 c1");
@@ -257,6 +261,18 @@ TEST(CodegenTests, AVX256Test)
 	CODEGEN_TEST(xVPANDN(ymm0, ymm1, ymm2), "c5 f5 df c2");
 	CODEGEN_TEST(xVPOR(ymm0, ymm1, ymm2), "c5 f5 eb c2");
 	CODEGEN_TEST(xVPXOR(ymm0, ymm1, ymm2), "c5 f5 ef c2");
+	CODEGEN_TEST(xVPADDD(ymm0, ymm1, ymm2), "c5 f5 fe c2");
+
+	CODEGEN_TEST(xVPMOVSX.BD(ymm0, ptr64[rdi]), "c4 e2 7d 21 07");
+	CODEGEN_TEST(xVPMOVZX.BD(ymm0, ptr64[rdi]), "c4 e2 7d 31 07");
+	CODEGEN_TEST(xVPMOVSX.WD(ymm0, ptr128[rdi]), "c4 e2 7d 23 07");
+	CODEGEN_TEST(xVPMOVZX.WD(ymm0, ptr128[rdi]), "c4 e2 7d 33 07");
+
+	CODEGEN_TEST(xVPBLENDD(ymm0, ymm1, ymm2, 1), "c4 e3 75 02 c2 01");
+	CODEGEN_TEST(xVPERM2I128(ymm0, ymm1, ymm2, 8), "c4 e3 75 46 c2 08");
+	CODEGEN_TEST(xVINSERTI128(ymm0, ymm1, xmm2, 1), "c4 e3 75 38 c2 01");
+	CODEGEN_TEST(xVEXTRACTI128(xmm0, ymm1, 1), "c4 e3 7d 39 c8 01");
+	CODEGEN_TEST(xVEXTRACTI128(xmm10, ymm1, 1), "c4 c3 7d 39 ca 01");
 
 	CODEGEN_TEST(xVMOVMSKPS(eax, ymm1), "c5 fc 50 c1");
 	CODEGEN_TEST(xVMOVMSKPD(eax, ymm1), "c5 fd 50 c1");
@@ -0,0 +1,96 @@
+// SPDX-FileCopyrightText: 2002-2024 PCSX2 Dev Team
+// SPDX-License-Identifier: GPL-3.0+
+
+#include "pcsx2/EventQueue.h"
+
+#include <gtest/gtest.h>
+#include <optional>
+#include <random>
+
+TEST(EventQueue, PopsInDueOrder)
+{
+	EventQueue queue;
+	queue.Schedule(3, 300);
+	queue.Schedule(1, 100);
+	queue.Schedule(7, 700);
+	queue.Schedule(2, 200);
+
+	EXPECT_FALSE(queue.HasDue(99));
+	EXPECT_TRUE(queue.HasDue(100));
+	EXPECT_EQ(queue.GetNextDue(), 100u);
+	EXPECT_EQ(queue.Pop(), 1u);
+	EXPECT_EQ(queue.Pop(), 2u);
+	EXPECT_EQ(queue.Pop(), 3u);
+	EXPECT_EQ(queue.Pop(), 7u);
+	EXPECT_TRUE(queue.IsEmpty());
+	EXPECT_FALSE(queue.HasDue(1000));
+}
+
+TEST(EventQueue, RescheduleMovesEvent)
+{
+	EventQueue queue;
+	queue.Schedule(0, 100);
+	queue.Schedule(1, 200);
+	queue.Schedule(2, 300);
+
+	// Later, then earlier again; each event is only queued once.
+	queue.Schedule(0, 400);
+	queue.Schedule(2, 50);
+
+	EXPECT_EQ(queue.Pop(), 2u);
+	EXPECT_EQ(queue.Pop(), 1u);
+	EXPECT_EQ(queue.Pop(), 0u);
+	EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(EventQueue, HandlesCycleWrap)
+{
+	EventQueue queue;
+	queue.Schedule(0, 0x10);
+	queue.Schedule(1, 0xFFFFFFF0);
+
+	EXPECT_TRUE(queue.HasDue(0xFFFFFFF0));
+	EXPECT_EQ(queue.Pop(), 1u);
+	EXPECT_FALSE(queue.HasDue(0xFFFFFFFF));
+	EXPECT_TRUE(queue.HasDue(0x10));
+	EXPECT_EQ(queue.Pop(), 0u);
+}
+
+TEST(EventQueue, MatchesLinearScan)
+{
+	// Random schedules and pops against the linear scan the event tests used to do.
+	std::mt19937 rng(1234);
+	EventQueue queue;
+	std::optional<u32> due[EventQueue::MAX_EVENTS];
+	u32 cycle = 0xFFFF0000; // so the cycle counter wraps during the test
+
+	for (u32 i = 0; i < 100000; i++)
+	{
+		if (rng() % 3 != 0)
+		{
+			const u32 id = rng() % EventQueue::MAX_EVENTS;
+			due[id] = cycle + rng() % 0x2000;
+			queue.Schedule(id, due[id].value());
+			continue;
+		}
+
+		cycle += rng() % 0x800;
+
+		while (queue.HasDue(cycle))
+		{
+			const u32 next = queue.GetNextDue();
+			const u32 id = queue.Pop();
+			ASSERT_TRUE(due[id].has_value());
+			ASSERT_EQ(due[id].value(), next);
+
+			// Nothing else may be due earlier.
+			for (const std::optional<u32>& other : due)
+				ASSERT_FALSE(other.has_value() && static_cast<s32>(other.value() - next) < 0);
+
+			due[id].reset();
+		}
+
+		for (const std::optional<u32>& other : due)
+			ASSERT_FALSE(other.has_value() && static_cast<s32>(cycle - other.value()) >= 0);
+	}
+}
@@ -0,0 +1,361 @@
+// SPDX-FileCopyrightText: 2002-2024 PCSX2 Dev Team
+// SPDX-License-Identifier: GPL-3.0+
+
+#include "pcsx2/x86/BaseblockEx.h"
+
+#include "common/Timer.h"
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct LinkEvent
+	{
+		enum class Type : u8
+		{
+			New,
+			Link,
+			Clear,
+			Reset,
+		};
+
+		Type type;
+		u32 pc; // New: block start, Link: target, Clear: first pc of the range
+		u32 arg; // New: code offset, Link: jump slot, Clear: number of instructions
+	};
+
+	static constexpr u32 CODE_SIZE = 0x100000;
+	static constexpr u32 JUMP_SLOTS = 0x40000;
+
+	// Builds an event stream shaped like what the EE recompiler sees: blocks clustered in a few
+	// hot pages which link to their neighbours, with overlay loads clearing whole pages at a time
+	// and the occasional full reset.
+	static std::vector<LinkEvent> GenerateEvents(u32 seed, u32 count)
+	{
+		std::mt19937 rng(seed);
+		std::vector<LinkEvent> events;
+		events.reserve(count);
+
+		u32 code_offset = 0;
+		u32 next_slot = 0;
+		while (events.size() < count)
+		{
+			const u32 page = 0x100000 + (rng() % 64) * 0x1000;
+			const u32 roll = rng() % 1000;
+			if (roll < 2)
+			{
+				events.push_back({LinkEvent::Type::Reset, 0, 0});
+				code_offset = 0;
+				next_slot = 0;
+			}
+			else if (roll < 40)
+			{
+				events.push_back({LinkEvent::Type::Clear, page, 0x400});
+			}
+			else
+			{
+				const u32 pc = page + (rng() % 0x400) * 4;
+				events.push_back({LinkEvent::Type::New, pc, code_offset});
+				code_offset = (code_offset + 64) % CODE_SIZE;
+
+				const u32 num_links = 1 + (rng() % 3);
+				for (u32 i = 0; i < num_links; i++)
+				{
+					const u32 target = (rng() % 4 == 0) ? (0x100000 + (rng() % 0x10000) * 4) : (pc + 4 * (1 + rng() % 32));
+					events.push_back({LinkEvent::Type::Link, target, next_slot});
+					next_slot = (next_slot + 1) % JUMP_SLOTS;
+				}
+			}
+		}
+
+		return events;
+	}
+
+	// Same operations as BaseBlocks, on top of the multimap it used to use.
+	class MultimapBlocks
+	{
+	public:
+		explicit MultimapBlocks(uptr recompiler)
+			: m_recompiler(recompiler)
+		{
+		}
+
+		void New(u32 startpc, uptr fnptr)
+		{
+			const auto range = m_links.equal_range(startpc);
+			for (auto i = range.first; i != range.second; ++i)
+				*(u32*)i->second = fnptr - (i->second + 4);
+			m_blocks[startpc] = fnptr;
+		}
+
+		void Link(u32 pc, s32* jumpptr)
+		{
+			const auto it = m_blocks.find(pc);
+			const uptr target = (it != m_blocks.end()) ? it->second : m_recompiler;
+			*jumpptr = (s32)(target - (sptr)(jumpptr + 1));
+			m_links.emplace(pc, (uptr)jumpptr);
+		}
+
+		void Clear(u32 startpc, u32 size)
+		{
+			const auto first = m_blocks.lower_bound(startpc);
+			const auto last = m_blocks.lower_bound(startpc + size * 4);
+			for (auto it = first; it != last; ++it)
+			{
+				const auto range = m_links.equal_range(it->first);
+				for (auto i = range.first; i != range.second; ++i)
+					*(u32*)i->second = m_recompiler - (i->second + 4);
+			}
+			m_blocks.erase(first, last);
+		}
+
+		void Reset()
+		{
+			m_blocks.clear();
+			m_links.clear();
+		}
+
+	private:
+		uptr m_recompiler;
+		std::map<u32, uptr> m_blocks;
+		std::multimap<u32, uptr> m_links;
+	};
+
+	struct ReplayBuffers
+	{
+		std::unique_ptr<u8[]> code = std::make_unique<u8[]>(CODE_SIZE);
+		std::unique_ptr<s32[]> slots = std::make_unique<s32[]>(JUMP_SLOTS);
+	};
+
+	static void Replay(BaseBlocks& blocks, ReplayBuffers& buffers, const std::vector<LinkEvent>& events)
+	{
+		for (const LinkEvent& ev : events)
+		{
+			switch (ev.type)
+			{
+				case LinkEvent::Type::New:
+				{
+					// Mirrors recRecompile(), which never compiles over an existing block start.
+					const BASEBLOCKEX* existing = blocks.Get(ev.pc);
+					if (existing && existing->startpc == ev.pc)
+						break;
+
+					BASEBLOCKEX* block = blocks.New(ev.pc, (uptr)&buffers.code[ev.arg]);
+					block->size = 1;
+				}
+				break;
+
+				case LinkEvent::Type::Link:
+					blocks.Link(ev.pc, &buffers.slots[ev.arg]);
+					break;
+
+				case LinkEvent::Type::Clear:
+				{
+					// Mirrors recClear(), minus the LUT updates.
+					const int last = blocks.LastIndex(ev.pc + ev.arg * 4 - 4);
+					if (last < 0 || blocks[last]->startpc < ev.pc)
+						break;
+
+					int first = last;
+					while (first > 0 && blocks[first - 1]->startpc >= ev.pc)
+						first--;
+
+					blocks.Remove(first, last);
+				}
+				break;
+
+				case LinkEvent::Type::Reset:
+					blocks.Reset();
+					break;
+			}
+		}
+	}
+
+	static void Replay(MultimapBlocks& blocks, ReplayBuffers& buffers, const std::vector<LinkEvent>& events)
+	{
+		std::map<u32, bool> compiled;
+		for (const LinkEvent& ev : events)
+		{
+			switch (ev.type)
+			{
+				case LinkEvent::Type::New:
+					if (!compiled.emplace(ev.pc, true).second)
+						break;
+					blocks.New(ev.pc, (uptr)&buffers.code[ev.arg]);
+					break;
+
+				case LinkEvent::Type::Link:
+					blocks.Link(ev.pc, &buffers.slots[ev.arg]);
+					break;
+
+				case LinkEvent::Type::Clear:
+					blocks.Clear(ev.pc, ev.arg);
+					compiled.erase(compiled.lower_bound(ev.pc), compiled.lower_bound(ev.pc + ev.arg * 4));
+					break;
+
+				case LinkEvent::Type::Reset:
+					blocks.Reset();
+					compiled.clear();
+					break;
+			}
+		}
+	}
+} // namespace
+
+TEST(BaseBlockLinks, MatchesMultimap)
+{
+	const std::vector<LinkEvent> events = GenerateEvents(1234, 200000);
+
+	ReplayBuffers flat_buffers, tree_buffers;
+	BaseBlocks flat_blocks;
+	flat_blocks.SetJITCompile(&flat_buffers.code[CODE_SIZE - 16]);
+	MultimapBlocks tree_blocks((uptr)&tree_buffers.code[CODE_SIZE - 16]);
+
+	Replay(flat_blocks, flat_buffers, events);
+	Replay(tree_blocks, tree_buffers, events);
+
+	// Slots hold displacements, so convert them back to offsets within each code buffer.
+	for (u32 i = 0; i < JUMP_SLOTS; i++)
+	{
+		if (flat_buffers.slots[i] == 0 && tree_buffers.slots[i] == 0)
+			continue;
+
+		const sptr flat_target = (sptr)&flat_buffers.slots[i + 1] + flat_buffers.slots[i] - (sptr)flat_buffers.code.get();
+		const sptr tree_target = (sptr)&tree_buffers.slots[i + 1] + tree_buffers.slots[i] - (sptr)tree_buffers.code.get();
+		ASSERT_EQ(flat_target, tree_target) << "slot " << i;
+	}
+}
+
+// Timing only, run with --gtest_also_run_disabled_tests.
+TEST(BaseBlockLinks, DISABLED_ReplayBenchmark)
+{
+	static constexpr u32 ITERATIONS = 5;
+	const std::vector<LinkEvent> events = GenerateEvents(5678, 500000);
+
+	ReplayBuffers buffers;
+
+	Common::Timer::Value flat_ticks = 0;
+	{
+		BaseBlocks blocks;
+		blocks.SetJITCompile(&buffers.code[CODE_SIZE - 16]);
+		for (u32 i = 0; i < ITERATIONS; i++)
+		{
+			blocks.Reset();
+			const Common::Timer::Value start = Common::Timer::GetCurrentValue();
+			Replay(blocks, buffers, events);
+			flat_ticks += Common::Timer::GetCurrentValue() - start;
+		}
+	}
+
+	Common::Timer::Value tree_ticks = 0;
+	{
+		MultimapBlocks blocks((uptr)&buffers.code[CODE_SIZE - 16]);
+		for (u32 i = 0; i < ITERATIONS; i++)
+		{
+			blocks.Reset();
+			const Common::Timer::Value start = Common::Timer::GetCurrentValue();
+			Replay(blocks, buffers, events);
+			tree_ticks += Common::Timer::GetCurrentValue() - start;
+		}
+	}
+
+	std::printf("Replayed %zu link events x%u: flat index %.2f ms, multimap %.2f ms\n", events.size(), ITERATIONS,
+		Common::Timer::ConvertValueToMilliseconds(flat_ticks), Common::Timer::ConvertValueToMilliseconds(tree_ticks));
+}
+
+TEST(BaseBlockLinks, RemoveCodeRange)
+{
+	ReplayBuffers buffers;
+	BaseBlocks blocks;
+	const uptr recompiler = (uptr)&buffers.code[CODE_SIZE - 16];
+	blocks.SetJITCompile(&buffers.code[CODE_SIZE - 16]);
+
+	// Two blocks in the first half of the buffer, one in the second, each jumping to the next.
+	const uptr half = (uptr)&buffers.code[CODE_SIZE / 2];
+	blocks.New(0x1000, (uptr)&buffers.code[0])->size = 1;
+	blocks.New(0x2000, (uptr)&buffers.code[64])->size = 1;
+	blocks.New(0x3000, half)->size = 1;
+
+	// The first block's jump lives in its code, so it belongs to the evicted range.
+	s32* from_first = reinterpret_cast<s32*>(&buffers.code[16]);
+	s32* from_third = reinterpret_cast<s32*>(half + 16);
+	ASSERT_EQ(blocks.Link(0x2000, from_first)->startpc, 0x2000u);
+	ASSERT_EQ(blocks.Link(0x1000, from_third)->startpc, 0x1000u);
+
+	std::vector<u32> removed;
+	const u32 count = blocks.RemoveCodeRange((uptr)&buffers.code[0], half, [&](const BASEBLOCKEX& block) {
+		removed.push_back(block.startpc);
+	});
+	EXPECT_EQ(count, 2u);
+	EXPECT_EQ(removed, (std::vector<u32>{0x1000, 0x2000}));
+	EXPECT_EQ(blocks.Get(0x1000), nullptr);
+	ASSERT_NE(blocks.Get(0x3000), nullptr);
+
+	// The surviving block's jump goes back to the recompiler.
+	EXPECT_EQ((uptr)(from_third + 1) + *from_third, recompiler);
+
+	// Jumps in the evicted range aren't patched again when their target comes back.
+	*from_first = 0;
+	blocks.New(0x2000, (uptr)&buffers.code[128]);
+	EXPECT_EQ(*from_first, 0);
+}
+
+TEST(RecCodeRegions, EvictsUnreferencedRegions)
+{
+	static constexpr u32 REGION_SIZE = 0x1000;
+	static constexpr u32 MAX_BLOCK_SIZE = 0x100;
+	std::vector<u8> buffer(REGION_SIZE * RecCodeRegions::NUM_REGIONS);
+	u8* const start = buffer.data();
+
+	RecCodeRegions regions;
+	regions.Reset(start, start + buffer.size(), MAX_BLOCK_SIZE);
+	EXPECT_FALSE(regions.IsFull(start));
+	EXPECT_TRUE(regions.IsFull(start + REGION_SIZE - MAX_BLOCK_SIZE));
+
+	// The first lap only fills empty regions.
+	u8* ptr = start;
+	u8* evict_start;
+	u8* evict_end;
+	for (u32 i = 1; i < RecCodeRegions::NUM_REGIONS; i++)
+	{
+		ptr = regions.Advance(start + i * REGION_SIZE - MAX_BLOCK_SIZE, &evict_start, &evict_end);
+		EXPECT_EQ(ptr, start + i * REGION_SIZE);
+		EXPECT_EQ(evict_start, evict_end);
+	}
+	EXPECT_EQ(regions.GetStats().evictions, 0u);
+
+	// Everything is referenced after filling it, so the oldest region goes first. Code in region 2 gets linked
+	// to in the meantime, so it survives the next pass.
+	ptr = regions.Advance(ptr + REGION_SIZE - MAX_BLOCK_SIZE, &evict_start, &evict_end);
+	EXPECT_EQ(ptr, start);
+	EXPECT_EQ(evict_start, start);
+	EXPECT_EQ(evict_end, start + REGION_SIZE - MAX_BLOCK_SIZE);
+
+	ptr = regions.Advance(ptr + 16, &evict_start, &evict_end);
+	EXPECT_EQ(ptr, start + REGION_SIZE);
+
+	regions.Touch((uptr)start + 2 * REGION_SIZE + 64);
+	ptr = regions.Advance(ptr + 16, &evict_start, &evict_end);
+	EXPECT_EQ(ptr, start + 3 * REGION_SIZE);
+	EXPECT_EQ(regions.GetCurrentRegion(), 3u);
+	EXPECT_EQ(regions.GetStats().evictions, 3u);
+
+	// Regions can also be marked by index.
+	regions.TouchRegion(4);
+	ptr = regions.Advance(ptr + 16, &evict_start, &evict_end);
+	EXPECT_EQ(ptr, start + 5 * REGION_SIZE);
+	EXPECT_EQ(regions.GetCurrentRegion(), 5u);
+
+	// Blocks compiled again after being evicted are counted.
+	regions.NoteEvicted(0x1000, 100);
+	regions.NoteCompiled(0x1000, 120);
+	regions.NoteCompiled(0x2000, 50);
+	EXPECT_EQ(regions.GetStats().evicted_bytes, 100u);
+	EXPECT_EQ(regions.GetStats().recompiled_blocks, 1u);
+	EXPECT_EQ(regions.GetStats().recompiled_bytes, 120u);
+}
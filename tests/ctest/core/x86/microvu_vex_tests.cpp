@@ -0,0 +1,532 @@
+// SPDX-FileCopyrightText: 2002-2024 PCSX2 Dev Team
+// SPDX-License-Identifier: GPL-3.0+
+
+#include "pcsx2/Config.h"
+#include "pcsx2/Memory.h"
+#include "pcsx2/MTVU.h"
+#include "pcsx2/VUmicro.h"
+#include "pcsx2/x86/microVU_ProgCache.h"
+
+#include "common/Timer.h"
+
+#include "cpuinfo.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	static constexpr u32 VU1_MEM_SIZE = 0x4000;
+	static constexpr u32 MAX_CYCLES = 0x40000; // bounds recorded loops whose counts come from the random starting state
+	static constexpr u32 NUM_RANDOM_PROGRAMS = 64;
+	static constexpr u32 RANDOM_PROGRAM_LENGTH = 48;
+
+	// Set to a microVU1 program cache file (cache/mvu1_*.bin) recorded by this build with the default VU
+	// settings, to also run the programs a game used.
+	static constexpr const char* RECORDED_PROGRAMS_VAR = "PCSX2_MVU1_PROGRAM_CACHE";
+
+	//------------------------------------------------------------------
+	// Instruction encodings
+	//------------------------------------------------------------------
+
+	static constexpr u32 UPPER_I_BIT = 1u << 31;
+	static constexpr u32 UPPER_E_BIT = 1u << 30;
+	static constexpr u32 UPPER_NOP = 0x000002ff;
+	static constexpr u32 LOWER_NOP = 0x8000033c;
+	static constexpr u32 LOWER_XGKICK_MASK = 0xfe0007ff;
+	static constexpr u32 LOWER_XGKICK = 0x800006fc;
+	static constexpr u32 DEST_XYZW = 0xf;
+	static constexpr u32 DEST_XYZ = 0xe;
+
+	static constexpr u64 Instr(u32 upper, u32 lower)
+	{
+		return (static_cast<u64>(upper) << 32) | lower;
+	}
+
+	static constexpr u32 Upper(u32 op, u32 dest, u32 ft, u32 fs, u32 fd)
+	{
+		return (dest << 21) | (ft << 16) | (fs << 11) | (fd << 6) | op;
+	}
+
+	// Ops in the 0x3C-0x3F tables, which write ACC (or ft) instead of fd.
+	static constexpr u32 UpperACC(u32 table, u32 index, u32 dest, u32 ft, u32 fs)
+	{
+		return Upper(0x3c | table, dest, ft, fs, index);
+	}
+
+	static constexpr u32 LowerT3(u32 table, u32 index, u32 dest, u32 ft, u32 fs)
+	{
+		return (0x40u << 25) | (dest << 21) | (ft << 16) | (fs << 11) | (index << 6) | (0x3c | table);
+	}
+
+	static constexpr u32 LQ(u32 dest, u32 ft, u32 is, s32 imm) { return (0x00u << 25) | (dest << 21) | (ft << 16) | (is << 11) | (imm & 0x7ff); }
+	static constexpr u32 SQ(u32 dest, u32 fs, u32 it, s32 imm) { return (0x01u << 25) | (dest << 21) | (it << 16) | (fs << 11) | (imm & 0x7ff); }
+	static constexpr u32 IADDIU(u32 it, u32 is, u32 imm) { return (0x08u << 25) | (((imm >> 11) & 0xf) << 21) | (it << 16) | (is << 11) | (imm & 0x7ff); }
+	static constexpr u32 ISUBIU(u32 it, u32 is, u32 imm) { return (0x09u << 25) | (((imm >> 11) & 0xf) << 21) | (it << 16) | (is << 11) | (imm & 0x7ff); }
+	static constexpr u32 FMAND(u32 it, u32 is) { return (0x1au << 25) | (it << 16) | (is << 11); }
+	static constexpr u32 FCGET(u32 it) { return (0x1cu << 25) | (it << 16); }
+	static constexpr u32 IBNE(u32 it, u32 is, s32 imm) { return (0x29u << 25) | (it << 16) | (is << 11) | (imm & 0x7ff); }
+	static constexpr u32 LQI(u32 dest, u32 ft, u32 is) { return LowerT3(0, 0x0d, dest, ft, is); }
+	static constexpr u32 SQI(u32 dest, u32 fs, u32 it) { return LowerT3(1, 0x0d, dest, it, fs); }
+	static constexpr u32 DIV(u32 fs, u32 fsf, u32 ft, u32 ftf) { return LowerT3(0, 0x0e, (ftf << 2) | fsf, ft, fs); }
+	static constexpr u32 SQRT(u32 ft, u32 ftf) { return LowerT3(1, 0x0e, ftf << 2, ft, 0); }
+	static constexpr u32 RSQRT(u32 fs, u32 fsf, u32 ft, u32 ftf) { return LowerT3(2, 0x0e, (ftf << 2) | fsf, ft, fs); }
+	static constexpr u32 WAITQ() { return LowerT3(3, 0x0e, 0, 0, 0); }
+
+	static_assert(LowerT3(0, 0x0c, 0, 0, 0) == LOWER_NOP);
+	static_assert(LowerT3(0, 0x1b, 0, 0, 0) == LOWER_XGKICK);
+
+	static mVUProgCache::Program MakeProgram(const std::vector<u64>& code)
+	{
+		mVUProgCache::Program program = {};
+		program.start_pc = 0;
+		program.ranges.push_back({0, static_cast<s32>(code.size() * sizeof(u64))});
+		program.data.resize(code.size() * sizeof(u64));
+		std::memcpy(program.data.data(), code.data(), program.data.size());
+		return program;
+	}
+
+	// Transforms 32 vertices by a matrix and projects them, the usual shape of a VU1 rendering kernel.
+	static mVUProgCache::Program MakeTransformProgram()
+	{
+		return MakeProgram({
+			Instr(UPPER_NOP, IADDIU(1, 0, 0)), // vi1 = input
+			Instr(UPPER_NOP, IADDIU(2, 0, 0x200)), // vi2 = output
+			Instr(UPPER_NOP, IADDIU(3, 0, 32)), // vi3 = count
+			Instr(UPPER_NOP, LQI(DEST_XYZW, 4, 1)),
+			Instr(UPPER_NOP, LQI(DEST_XYZW, 5, 1)),
+			Instr(UPPER_NOP, LQI(DEST_XYZW, 6, 1)),
+			Instr(UPPER_NOP, LQI(DEST_XYZW, 7, 1)),
+			// loop:
+			Instr(UPPER_NOP, LQI(DEST_XYZW, 8, 1)),
+			Instr(UpperACC(0, 6, DEST_XYZW, 8, 4), LOWER_NOP), // MULAx ACC, vf4, vf8x
+			Instr(UpperACC(1, 2, DEST_XYZW, 8, 5), LOWER_NOP), // MADDAy ACC, vf5, vf8y
+			Instr(UpperACC(2, 2, DEST_XYZW, 8, 6), LOWER_NOP), // MADDAz ACC, vf6, vf8z
+			Instr(Upper(0x0b, DEST_XYZW, 8, 7, 9), LOWER_NOP), // MADDw vf9, vf7, vf8w
+			Instr(UPPER_NOP, DIV(0, 3, 9, 3)), // Q = vf0w / vf9w
+			Instr(UpperACC(3, 7, DEST_XYZ, 9, 9), WAITQ()), // CLIPw vf9, vf9w
+			Instr(Upper(0x1c, DEST_XYZ, 0, 9, 10), ISUBIU(3, 3, 1)), // MULq.xyz vf10, vf9, Q
+			Instr(Upper(0x2b, DEST_XYZW, 10, 10, 11), SQI(DEST_XYZW, 10, 2)), // MAX vf11, vf10, vf10
+			Instr(UPPER_NOP, IBNE(3, 0, -10)),
+			Instr(UPPER_NOP, FCGET(4)),
+			Instr(UPPER_NOP | UPPER_E_BIT, LOWER_NOP),
+			Instr(UPPER_NOP, LOWER_NOP),
+		});
+	}
+
+	// Straight-line FMAC code: every upper op with random operands and dest masks, next to divides, loads,
+	// stores, flag reads and I immediates in the lower slot.
+	static mVUProgCache::Program MakeRandomProgram(std::mt19937& rng)
+	{
+		std::vector<u64> code;
+		for (u32 i = 0; i < RANDOM_PROGRAM_LENGTH; i++)
+		{
+			const u32 dest = 1 + rng() % 15;
+			const u32 ft = rng() % 32;
+			const u32 fs = rng() % 32;
+			u32 upper;
+			u32 written;
+			const u32 op = rng() % (0x30 + 46);
+			if (op < 0x30)
+			{
+				written = 1 + rng() % 31;
+				upper = Upper(op, dest, ft, fs, written);
+			}
+			else
+			{
+				// 12 ops in each table, minus the unknown op and NOP at the end of the last one.
+				const u32 table = (op - 0x30) / 12;
+				const u32 index = (op - 0x30) % 12;
+				const bool writes_ft = (index == 4 || index == 5 || (table == 1 && index == 7)); // ITOF, FTOI, ABS
+				const bool clip = (table == 3 && index == 7);
+				written = writes_ft ? (1 + ft % 31) : 0;
+				upper = UpperACC(table, index, clip ? DEST_XYZ : dest, writes_ft ? written : ft, fs);
+			}
+
+			// Lower ops mustn't write the register the upper op does, that's only defined for a few cases.
+			u32 reg = 1 + rng() % 31;
+			if (reg == written)
+				reg = (reg % 31) + 1;
+			u32 lower;
+			switch (rng() % 10)
+			{
+				case 0: lower = DIV(fs, rng() % 4, reg, rng() % 4); break;
+				case 1: lower = (rng() & 1) ? SQRT(reg, rng() % 4) : RSQRT(fs, rng() % 4, reg, rng() % 4); break;
+				case 2: lower = WAITQ(); break;
+				case 3: lower = LQ(1 + rng() % 15, reg, rng() % 16, static_cast<s32>(rng())); break;
+				case 4: lower = SQ(1 + rng() % 15, reg, rng() % 16, static_cast<s32>(rng())); break;
+				case 5: lower = FMAND(1 + rng() % 15, rng() % 16); break;
+				case 6: lower = FCGET(1 + rng() % 15); break;
+				case 7:
+					upper |= UPPER_I_BIT;
+					lower = std::bit_cast<u32>(std::uniform_real_distribution<float>(-4.0f, 4.0f)(rng));
+					break;
+				default: lower = LOWER_NOP; break;
+			}
+			code.push_back(Instr(upper, lower));
+		}
+		code.push_back(Instr(UPPER_NOP | UPPER_E_BIT, LOWER_NOP));
+		code.push_back(Instr(UPPER_NOP, LOWER_NOP));
+		return MakeProgram(code);
+	}
+
+	//------------------------------------------------------------------
+	// VU1 state
+	//------------------------------------------------------------------
+
+	struct VUState
+	{
+		VECTOR VF[32];
+		REG_VI VI[32];
+		VECTOR ACC;
+		u32 cycle;
+		alignas(16) u32 macflags[4];
+		alignas(16) u32 clipflags[4];
+		alignas(16) u32 statusflags[4];
+		alignas(16) u8 mem[VU1_MEM_SIZE];
+	};
+
+	static float RandomFloat(std::mt19937& rng)
+	{
+		// Now and then raw bits, so the clamping paths see infinities, NaNs and denormals.
+		if ((rng() & 63) == 0)
+			return std::bit_cast<float>(static_cast<u32>(rng()));
+		return std::uniform_real_distribution<float>(-8.0f, 8.0f)(rng);
+	}
+
+	static void RandomizeState(u32 seed, VUState& state)
+	{
+		std::mt19937 rng(seed);
+		std::memset(&state, 0, sizeof(state));
+		for (u32 i = 1; i < 32; i++)
+		{
+			for (float& f : state.VF[i].F)
+				f = RandomFloat(rng);
+		}
+		state.VF[0].F[3] = 1.0f;
+		for (float& f : state.ACC.F)
+			f = RandomFloat(rng);
+		for (u32 i = 1; i < 16; i++)
+			state.VI[i].UL = rng() & 0x3ff;
+		state.VI[REG_R].UL = 0x3f800000 | (rng() & 0x7fffff);
+		state.VI[REG_I].F = RandomFloat(rng);
+		state.VI[REG_Q].F = RandomFloat(rng);
+		state.VI[REG_P].F = RandomFloat(rng);
+		for (u32 i = 0; i < VU1_MEM_SIZE; i += sizeof(float))
+		{
+			const float f = RandomFloat(rng);
+			std::memcpy(&state.mem[i], &f, sizeof(f));
+		}
+	}
+
+	static void LoadState(const VUState& state)
+	{
+		std::memcpy(VU1.VF, state.VF, sizeof(state.VF));
+		std::memcpy(VU1.VI, state.VI, sizeof(state.VI));
+		VU1.ACC = state.ACC;
+		VU1.cycle = state.cycle;
+		std::memcpy(VU1.micro_macflags, state.macflags, sizeof(state.macflags));
+		std::memcpy(VU1.micro_clipflags, state.clipflags, sizeof(state.clipflags));
+		std::memcpy(VU1.micro_statusflags, state.statusflags, sizeof(state.statusflags));
+		std::memcpy(VU1.Mem, state.mem, sizeof(state.mem));
+	}
+
+	static void SaveState(VUState& state)
+	{
+		std::memcpy(state.VF, VU1.VF, sizeof(state.VF));
+		std::memcpy(state.VI, VU1.VI, sizeof(state.VI));
+		state.ACC = VU1.ACC;
+		state.cycle = VU1.cycle;
+		std::memcpy(state.macflags, VU1.micro_macflags, sizeof(state.macflags));
+		std::memcpy(state.clipflags, VU1.micro_clipflags, sizeof(state.clipflags));
+		std::memcpy(state.statusflags, VU1.micro_statusflags, sizeof(state.statusflags));
+		std::memcpy(state.mem, VU1.Mem, sizeof(state.mem));
+	}
+
+	static std::string DescribeDifference(const VUState& sse, const VUState& vex)
+	{
+		char buf[256];
+		const auto vector = [&buf](const std::string& name, const VECTOR& a, const VECTOR& b) {
+			std::snprintf(buf, sizeof(buf), "%s: SSE %08x %08x %08x %08x, VEX %08x %08x %08x %08x", name.c_str(),
+				a.UL[0], a.UL[1], a.UL[2], a.UL[3], b.UL[0], b.UL[1], b.UL[2], b.UL[3]);
+			return std::string(buf);
+		};
+
+		for (u32 i = 0; i < 32; i++)
+		{
+			if (std::memcmp(&sse.VF[i], &vex.VF[i], sizeof(VECTOR)) != 0)
+				return vector("VF" + std::to_string(i), sse.VF[i], vex.VF[i]);
+		}
+		for (u32 i = 0; i < 32; i++)
+		{
+			if (sse.VI[i].UL != vex.VI[i].UL)
+			{
+				std::snprintf(buf, sizeof(buf), "VI%u: SSE %08x, VEX %08x", i, sse.VI[i].UL, vex.VI[i].UL);
+				return buf;
+			}
+		}
+		if (std::memcmp(&sse.ACC, &vex.ACC, sizeof(VECTOR)) != 0)
+			return vector("ACC", sse.ACC, vex.ACC);
+		if (sse.cycle != vex.cycle)
+		{
+			std::snprintf(buf, sizeof(buf), "cycle: SSE %u, VEX %u", sse.cycle, vex.cycle);
+			return buf;
+		}
+		if (std::memcmp(sse.macflags, vex.macflags, sizeof(sse.macflags)) != 0 ||
+			std::memcmp(sse.clipflags, vex.clipflags, sizeof(sse.clipflags)) != 0 ||
+			std::memcmp(sse.statusflags, vex.statusflags, sizeof(sse.statusflags)) != 0)
+		{
+			return "flag instances";
+		}
+		for (u32 i = 0; i < VU1_MEM_SIZE; i += sizeof(VECTOR))
+		{
+			if (std::memcmp(&sse.mem[i], &vex.mem[i], sizeof(VECTOR)) != 0)
+			{
+				VECTOR a, b;
+				std::memcpy(&a, &sse.mem[i], sizeof(a));
+				std::memcpy(&b, &vex.mem[i], sizeof(b));
+				return vector("mem qword " + std::to_string(i / sizeof(VECTOR)), a, b);
+			}
+		}
+		return {};
+	}
+
+	//------------------------------------------------------------------
+	// Execution
+	//------------------------------------------------------------------
+
+	// Recompiles everything from here on with or without VEX encodings.
+	static void SelectPath(bool vex)
+	{
+		EmuConfig.Cpu.Recompiler.EnableVUVexEncoding = vex;
+		CpuMicroVU1.Reset();
+	}
+
+	static void LoadProgram(const mVUProgCache::Program& program)
+	{
+		std::memset(VU1.Micro, 0, VU1_MEM_SIZE);
+		const u8* data = program.data.data();
+		for (const mVUProgCache::Range& range : program.ranges)
+		{
+			std::memcpy(VU1.Micro + range.start, data, range.end - range.start);
+			data += range.end - range.start;
+		}
+
+		// There's no GS to kick packets to.
+		for (u32 pc = 0; pc < VU1_MEM_SIZE; pc += sizeof(u64))
+		{
+			u32 lower, upper;
+			std::memcpy(&lower, VU1.Micro + pc, sizeof(lower));
+			std::memcpy(&upper, VU1.Micro + pc + sizeof(lower), sizeof(upper));
+			if (!(upper & UPPER_I_BIT) && (lower & LOWER_XGKICK_MASK) == LOWER_XGKICK)
+				std::memcpy(VU1.Micro + pc, &LOWER_NOP, sizeof(LOWER_NOP));
+		}
+
+		CpuMicroVU1.Clear(0, VU1_MEM_SIZE);
+	}
+
+	static void RunProgram(const mVUProgCache::Program& program)
+	{
+		VU0.VI[REG_VPU_STAT].UL |= 0x100;
+		VU1.VI[REG_TPC].UL = program.start_pc / 8;
+		CpuMicroVU1.SetStartPC(program.start_pc);
+		CpuMicroVU1.Execute(MAX_CYCLES);
+	}
+
+	// Runs each program on both paths from the same random state, and returns the first difference.
+	static std::string RunOnBothPaths(const std::vector<mVUProgCache::Program>& programs, u32 seed)
+	{
+		std::vector<std::unique_ptr<VUState>> results[2];
+		for (int path = 0; path < 2; path++)
+		{
+			SelectPath(path != 0);
+			for (u32 i = 0; i < programs.size(); i++)
+			{
+				auto state = std::make_unique<VUState>();
+				RandomizeState(seed + i, *state);
+				LoadProgram(programs[i]);
+				LoadState(*state);
+				RunProgram(programs[i]);
+				SaveState(*state);
+				results[path].push_back(std::move(state));
+			}
+		}
+
+		for (u32 i = 0; i < programs.size(); i++)
+		{
+			const std::string diff = DescribeDifference(*results[0][i], *results[1][i]);
+			if (!diff.empty())
+			{
+				char buf[64];
+				std::snprintf(buf, sizeof(buf), "program %u (start %04x, seed %u): ", i, programs[i].start_pc, seed + i);
+				return buf + diff;
+			}
+		}
+		return {};
+	}
+
+	static std::vector<mVUProgCache::Program> MakeBuiltinPrograms()
+	{
+		std::vector<mVUProgCache::Program> programs;
+		programs.push_back(MakeTransformProgram());
+		std::mt19937 rng(1234);
+		for (u32 i = 0; i < NUM_RANDOM_PROGRAMS; i++)
+			programs.push_back(MakeRandomProgram(rng));
+		return programs;
+	}
+
+	static bool ReadRecordedPrograms(std::vector<mVUProgCache::Program>* programs)
+	{
+		const char* path = std::getenv(RECORDED_PROGRAMS_VAR);
+		return path && mVUProgCache::ReadFile(1, path, programs);
+	}
+
+	class MicroVUVexTest : public ::testing::Test
+	{
+	protected:
+		static void SetUpTestSuite()
+		{
+			cpuinfo_initialize();
+			if (!cpuinfo_has_x86_avx())
+				return;
+
+			s_allocated = SysMemory::Allocate();
+			if (s_allocated)
+				CpuMicroVU1.Reserve();
+		}
+
+		static void TearDownTestSuite()
+		{
+			if (!s_allocated)
+				return;
+
+			CpuMicroVU1.Shutdown();
+			vu1Thread.Close();
+			SysMemory::Release();
+			s_allocated = false;
+		}
+
+		void SetUp() override
+		{
+			m_config = EmuConfig.Cpu.Recompiler;
+			if (!cpuinfo_has_x86_avx())
+				GTEST_SKIP() << "Host CPU does not support AVX";
+			if (!s_allocated)
+				GTEST_SKIP() << "Failed to allocate VM memory";
+		}
+
+		void TearDown() override
+		{
+			EmuConfig.Cpu.Recompiler = m_config;
+		}
+
+		Pcsx2Config::RecompilerOptions m_config;
+		static inline bool s_allocated = false;
+	};
+} // namespace
+
+TEST_F(MicroVUVexTest, MatchesSSE)
+{
+	static constexpr struct
+	{
+		bool overflow;
+		bool extra_overflow;
+		bool sign_overflow;
+		const char* name;
+	} clamp_modes[] = {
+		{false, false, false, "none"},
+		{true, false, false, "normal"},
+		{true, true, false, "extra"},
+		{true, true, true, "extra + preserve sign"},
+	};
+
+	const std::vector<mVUProgCache::Program> programs = MakeBuiltinPrograms();
+	for (const auto& mode : clamp_modes)
+	{
+		EmuConfig.Cpu.Recompiler.vu1Overflow = mode.overflow;
+		EmuConfig.Cpu.Recompiler.vu1ExtraOverflow = mode.extra_overflow;
+		EmuConfig.Cpu.Recompiler.vu1SignOverflow = mode.sign_overflow;
+		for (const u32 seed : {1u, 1000u})
+		{
+			const std::string diff = RunOnBothPaths(programs, seed);
+			ASSERT_TRUE(diff.empty()) << "clamping " << mode.name << ", " << diff;
+		}
+	}
+}
+
+TEST_F(MicroVUVexTest, RecordedProgramsMatchSSE)
+{
+	std::vector<mVUProgCache::Program> programs;
+	if (!ReadRecordedPrograms(&programs))
+		GTEST_SKIP() << RECORDED_PROGRAMS_VAR << " doesn't name a program cache recorded by this build";
+
+	const std::string diff = RunOnBothPaths(programs, 1);
+	ASSERT_TRUE(diff.empty()) << diff;
+}
+
+// Timing only, run with --gtest_also_run_disabled_tests.
+TEST_F(MicroVUVexTest, DISABLED_Throughput)
+{
+	static constexpr u32 ITERATIONS = 2000;
+	static constexpr u32 RUNS = 5;
+
+	const std::vector<mVUProgCache::Program> builtin = MakeBuiltinPrograms();
+	std::vector<mVUProgCache::Program> recorded;
+	ReadRecordedPrograms(&recorded);
+
+	const struct
+	{
+		const char* name;
+		const mVUProgCache::Program* programs;
+		size_t count;
+	} sets[] = {
+		{"transform", builtin.data(), 1},
+		{"random FMAC", builtin.data() + 1, builtin.size() - 1},
+		{"recorded", recorded.data(), recorded.size()},
+	};
+
+	auto state = std::make_unique<VUState>();
+	for (const auto& set : sets)
+	{
+		if (set.count == 0)
+			continue;
+
+		double ms[2] = {};
+		for (int path = 0; path < 2; path++)
+		{
+			SelectPath(path != 0);
+			for (size_t i = 0; i < set.count; i++)
+			{
+				// Compile outside of the timed runs.
+				RandomizeState(static_cast<u32>(i), *state);
+				LoadProgram(set.programs[i]);
+				LoadState(*state);
+				RunProgram(set.programs[i]);
+
+				// Best of several runs, to filter out the noise of whatever else is running on the machine.
+				double best = std::numeric_limits<double>::max();
+				for (u32 run = 0; run < RUNS; run++)
+				{
+					LoadState(*state);
+					const Common::Timer::Value start = Common::Timer::GetCurrentValue();
+					for (u32 j = 0; j < ITERATIONS; j++)
+						RunProgram(set.programs[i]);
+					best = std::min(best, Common::Timer::ConvertValueToMilliseconds(Common::Timer::GetCurrentValue() - start));
+				}
+				ms[path] += best;
+			}
+		}
+
+		std::printf("%-12s (%zu programs x%u): SSE %8.2f ms, VEX %8.2f ms (%+.1f%%)\n", set.name, set.count, ITERATIONS,
+			ms[0], ms[1], (ms[1] / ms[0] - 1.0) * 100.0);
+	}
+}
@@ -0,0 +1,233 @@
+// SPDX-FileCopyrightText: 2002-2024 PCSX2 Dev Team
+// SPDX-License-Identifier: GPL-3.0+
+
+#include "pcsx2/x86/Vif_UnpackSSE.h"
+
+#include "common/HostSys.h"
+#include "common/Timer.h"
+
+#include "cpuinfo.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	static constexpr u32 CODE_SIZE = 0x100000;
+	static constexpr u32 SRC_SIZE = 256 * 16 + 64; // largest packet, plus what the unpacks read past the end
+	static constexpr u32 DST_SIZE = 0x4000; // VU1 memory
+
+	// Part of the image, so the generated code can reach vif0's row/col registers rip-relative.
+	alignas(__pagesize) static u8 s_code[CODE_SIZE];
+
+	struct UnpackCase
+	{
+		u8 upk;
+		bool usn;
+		bool mask;
+		u32 mask_value;
+		u8 mode;
+		u8 cl;
+		u8 wl;
+		u8 num;
+		u8 aligned;
+	};
+
+	struct UnpackBuffers
+	{
+		alignas(32) u32 src[SRC_SIZE / 4];
+		alignas(32) u32 dst[DST_SIZE / 4];
+	};
+
+	struct UnpackResult
+	{
+		std::unique_ptr<UnpackBuffers> buffers = std::make_unique<UnpackBuffers>();
+		u128 row;
+	};
+
+	static bool IsValidUnpack(u32 upk)
+	{
+		return (upk & 3) != 3 || upk == 15;
+	}
+
+	static nVifrecCall CompileUnpack(const nVifStruct& v, const UnpackCase& uc, bool avx2, u8* code)
+	{
+		nVifBlock block = {};
+		block.num = uc.num;
+		block.upkType = uc.upk | (uc.mask << 4) | (uc.usn << 5);
+		block.mask = uc.mask_value;
+		block.mode = uc.mode;
+		block.aligned = uc.aligned;
+		block.cl = uc.cl;
+		block.wl = uc.wl;
+
+		xSetPtr(code);
+		const nVifrecCall func = reinterpret_cast<nVifrecCall>(xGetAlignedCallTarget());
+		VifUnpackSSE_Dynarec dynarec(v, block);
+		dynarec.useAVX2 = avx2;
+		dynarec.CompileRoutine();
+		pxAssert(xGetPtr() < (s_code + CODE_SIZE));
+		return func;
+	}
+
+	// Runs a case with the row/col registers and destination seeded from seed, so both paths see the same state.
+	static void RunUnpack(nVifrecCall func, u32 seed, UnpackResult& result)
+	{
+		std::mt19937 rng(seed);
+		for (u32& w : result.buffers->src)
+			w = rng();
+		for (u32& w : result.buffers->dst)
+			w = rng();
+		for (u32& w : vif0.MaskRow._u32)
+			w = rng();
+		for (u32& w : vif0.MaskCol._u32)
+			w = rng();
+
+		func(reinterpret_cast<uptr>(result.buffers->dst), reinterpret_cast<uptr>(result.buffers->src));
+		result.row = vif0.MaskRow;
+	}
+
+	static std::string DescribeCase(const UnpackCase& uc)
+	{
+		char buf[128];
+		std::snprintf(buf, sizeof(buf), "upk=%u usn=%d mask=%d(%08x) mode=%u cl=%u wl=%u num=%u aligned=%u", uc.upk, uc.usn,
+			uc.mask, uc.mask_value, uc.mode, uc.cl, uc.wl, uc.num, uc.aligned);
+		return buf;
+	}
+
+	class VifUnpackTest : public ::testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			cpuinfo_initialize();
+			if (!cpuinfo_has_x86_avx2())
+				GTEST_SKIP() << "Host CPU does not support AVX2";
+
+			HostSys::MemProtect(s_code, sizeof(s_code), PageAccess_Any());
+			m_vif = std::make_unique<nVifStruct>();
+			m_vif->idx = 0;
+		}
+
+		std::unique_ptr<nVifStruct> m_vif;
+	};
+} // namespace
+
+TEST_F(VifUnpackTest, MatchesSSE)
+{
+	static constexpr u8 cycles[][2] = {{4, 4}, {1, 1}, {4, 3}, {2, 4}, {3, 5}};
+	std::vector<u32> masks = {0x00000000, 0x55555555, 0xAAAAAAAA, 0xFFFFFFFF, 0xE4E4E4E4, 0x1B1B1B1B, 0xE41B00FF,
+		0x03020100, 0x30C0C030};
+	std::mt19937 rng(1234);
+	for (int i = 0; i < 4; i++)
+		masks.push_back(rng());
+
+	UnpackResult sse, avx2;
+	u32 seed = 0;
+	for (u8 upk = 0; upk < 16; upk++)
+	{
+		if (!IsValidUnpack(upk))
+			continue;
+
+		for (const bool usn : {false, true})
+		{
+			for (u32 mask_idx = 0; mask_idx <= masks.size(); mask_idx++)
+			{
+				for (u8 mode = 0; mode < 4; mode++)
+				{
+					for (const auto& cycle : cycles)
+					{
+						// Packet alignment only affects the V3 unpacks.
+						const u8 alignments = (upk >= 8 && upk <= 10) ? 4 : 1;
+						for (u8 aligned = 0; aligned < alignments; aligned++)
+						{
+							UnpackCase uc;
+							uc.upk = upk;
+							uc.usn = usn;
+							uc.mask = (mask_idx != 0);
+							uc.mask_value = uc.mask ? masks[mask_idx - 1] : 0;
+							uc.mode = mode;
+							uc.cl = cycle[0];
+							uc.wl = cycle[1];
+							uc.num = 31; // odd, so the AVX2 path has to finish with a single vector
+							uc.aligned = aligned;
+
+							seed++;
+							RunUnpack(CompileUnpack(*m_vif, uc, false, s_code), seed, sse);
+							RunUnpack(CompileUnpack(*m_vif, uc, true, s_code), seed, avx2);
+
+							ASSERT_EQ(std::memcmp(sse.buffers->dst, avx2.buffers->dst, DST_SIZE), 0) << DescribeCase(uc);
+							ASSERT_EQ(std::memcmp(&sse.row, &avx2.row, sizeof(u128)), 0) << DescribeCase(uc);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+// Timing only, run with --gtest_also_run_disabled_tests.
+TEST_F(VifUnpackTest, DISABLED_Throughput)
+{
+	static constexpr u32 ITERATIONS = 50000;
+	static constexpr u32 RUNS = 5;
+	static constexpr u8 formats[] = {10, 12, 13, 14};
+	static constexpr const char* format_names[] = {"V3-8", "V4-32", "V4-16", "V4-8"};
+	static constexpr struct
+	{
+		bool mask;
+		u32 mask_value;
+		u8 mode;
+		const char* name;
+	} variants[] = {
+		{false, 0, 0, "plain"},
+		{true, 0xE4E4E4E4, 0, "masked"},
+		{false, 0, 1, "offset"},
+		{false, 0, 2, "difference"},
+	};
+
+	UnpackResult result;
+	for (u32 i = 0; i < std::size(formats); i++)
+	{
+		for (const auto& variant : variants)
+		{
+			UnpackCase uc = {};
+			uc.upk = formats[i];
+			uc.mask = variant.mask;
+			uc.mask_value = variant.mask_value;
+			uc.mode = variant.mode;
+			uc.cl = 4;
+			uc.wl = 4;
+			uc.num = 0; // 256
+
+			double ms[2];
+			for (int path = 0; path < 2; path++)
+			{
+				const nVifrecCall func = CompileUnpack(*m_vif, uc, path != 0, s_code);
+				RunUnpack(func, 1, result);
+
+				// Best of several runs, to filter out the noise of whatever else is running on the machine.
+				ms[path] = std::numeric_limits<double>::max();
+				for (u32 run = 0; run < RUNS; run++)
+				{
+					const Common::Timer::Value start = Common::Timer::GetCurrentValue();
+					for (u32 j = 0; j < ITERATIONS; j++)
+						func(reinterpret_cast<uptr>(result.buffers->dst), reinterpret_cast<uptr>(result.buffers->src));
+					ms[path] = std::min(ms[path], Common::Timer::ConvertValueToMilliseconds(Common::Timer::GetCurrentValue() - start));
+				}
+			}
+
+			const double bytes = static_cast<double>(ITERATIONS) * 256 * 16;
+			std::printf("%-5s %-10s: SSE %7.2f GB/s, AVX2 %7.2f GB/s\n", format_names[i], variant.name,
+				bytes / (ms[0] * 1e6), bytes / (ms[1] * 1e6));
+		}
+	}
+}